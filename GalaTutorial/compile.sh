@@ -1,2 +1,5 @@
 /Applications/Development/VulkanSDK/macOS/bin/glslc shaders/simple_shader.vert -o shaders/simple_shader.vert.spv
 /Applications/Development/VulkanSDK/macOS/bin/glslc shaders/simple_shader.frag -o shaders/simple_shader.frag.spv
+/Applications/Development/VulkanSDK/macOS/bin/glslc shaders/simple_shader_object_ubo.vert -o shaders/simple_shader_object_ubo.vert.spv
+/Applications/Development/VulkanSDK/macOS/bin/glslc shaders/simple_shader_bindless.vert -o shaders/simple_shader_bindless.vert.spv
+/Applications/Development/VulkanSDK/macOS/bin/glslc shaders/simple_shader_bindless.frag -o shaders/simple_shader_bindless.frag.spv
@@ -3,6 +3,8 @@
 #include "lve_camera.hpp"
 #include "keyboard_movement_controller.hpp"
 #include "lve_buffer.hpp"
+#include "lve_frame_allocator.hpp"
+#include "lve_memory_statistics.hpp"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -11,6 +13,7 @@
 #include <array>
 #include <chrono>
 #include <cassert>
+#include <iostream>
 #include <stdexcept>
 #include <glm/gtc/constants.hpp>
 //
@@ -27,11 +30,31 @@ namespace lve
     
     FirstApp::FirstApp()
     {
-        globalPool = LveDescriptorPool::Builder(_lveDevice)
-            .setMaxSets(LveSwapChain::MAX_FRAMES_IN_FLIGHT)
-            .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, LveSwapChain::MAX_FRAMES_IN_FLIGHT)
+        globalDescriptorAllocator = LveDescriptorAllocator::Builder(_lveDevice)
+            .setInitialSetsPerPool(4)
+            .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1.f)
+            .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.f)
+            .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1.f)
+            .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1.f)
             .build();
+        _descriptorCache = std::make_unique<LveDescriptorCache>(_lveDevice, *globalDescriptorAllocator);
         
+        for (auto& frameDescriptorAllocator : frameDescriptorAllocators)
+        {
+            frameDescriptorAllocator = LveDescriptorAllocator::Builder(_lveDevice)
+                .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1.f)
+                .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.f)
+                .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1.f)
+                .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1.f)
+                .build();
+        }
+        
+        if (_lveDevice.supportsBindless())
+        {
+            _bindlessDescriptors = std::make_unique<LveBindlessDescriptors>(_lveDevice);
+        }
+        
+        _assetStreamer = std::make_unique<LveAssetStreamer>(_lveDevice, &_modelRegistry);
         loadGameObjects();
     }
 
@@ -40,43 +63,40 @@ namespace lve
 
     void FirstApp::run()
     {
-        std::vector<std::unique_ptr<LveBuffer>> uboBuffers(LveSwapChain::MAX_FRAMES_IN_FLIGHT);
-        for(int i=0; i<uboBuffers.size(); i++)
-        {
-            uboBuffers[i] = std::make_unique<LveBuffer>(
-                _lveDevice,
-                sizeof(GlobalUbo),
-                1,
-                VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
-            uboBuffers[i]->map();
-        }
+        // The GlobalUbo is pushed into the frame allocator every frame. Its descriptor is dynamic, so one
+        // set serves every frame; the frame's offset is given when binding it.
+        LveFrameAllocator frameAllocator{_lveDevice};
         
         LveDescriptorSetLayout::Builder builder{_lveDevice};
         
         builder.addBinding(
             0,
-            VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+            VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
             VK_SHADER_STAGE_VERTEX_BIT);
 
         std::unique_ptr<LveDescriptorSetLayout> globalSetLayout = builder.build();
         
-        std::vector<VkDescriptorSet> globalDescriptorSets (LveSwapChain::MAX_FRAMES_IN_FLIGHT);
-        
-        for(int i=0; i<globalDescriptorSets.size(); i++)
+        VkDescriptorSet globalDescriptorSet;
         {
-            VkDescriptorBufferInfo bufferInfo = uboBuffers[i]->descriptorInfo();
+            VkDescriptorBufferInfo bufferInfo{frameAllocator.getBuffer(), 0, sizeof(GlobalUbo)};
             
-            LveDescriptorWriter lveDescWriter{*globalSetLayout, *globalPool};
+            LveDescriptorWriter lveDescWriter{*globalSetLayout, *globalDescriptorAllocator};
             
             lveDescWriter.writeBuffer(0, &bufferInfo);
-            lveDescWriter.build(globalDescriptorSets[i]);
+            lveDescWriter.build(globalDescriptorSet);
         }
         
         SimpleRenderSystem simpleRenderSystem(
           _lveDevice,
           _lveRenderer.getSwapChainRenderPass(),
-          globalSetLayout->getVkDescriptorSetLayout());
+          globalSetLayout->getVkDescriptorSetLayout(),
+          _bindlessDescriptors.get());
+        
+        // One descriptor bind for the whole scene where descriptor indexing is supported.
+        if (_bindlessDescriptors)
+        {
+            simpleRenderSystem.setObjectDataPath(SimpleRenderSystem::ObjectDataPath::Bindless);
+        }
         LveCamera camera{};
         //camera.setViewDirection(glm::vec3(0.f), glm::vec3(0.5f, 0.f, 1.f));
         camera.setViewTarget(glm::vec3(-1.f, -2.f, 2.f), glm::vec3(0.f, 0.f, 2.5f));
@@ -87,10 +107,22 @@ namespace lve
         //
         auto currentTime = std::chrono::high_resolution_clock::now();
         
+        bool memoryKeyWasPressed = false;
+        
         while(!_lveWindow.shouldClose())
         {
             glfwPollEvents();
             
+            bool memoryKeyPressed = glfwGetKey(_lveWindow.getGLFWwindow(), GLFW_KEY_M) == GLFW_PRESS;
+            if (LOG_MEMORY_STATISTICS || (memoryKeyPressed && !memoryKeyWasPressed))
+            {
+                std::cout << _lveDevice.getMemoryStatistics().toJson() << std::endl;
+            }
+            memoryKeyWasPressed = memoryKeyPressed;
+            
+            // Hands over models whose upload finished; never waits for one.
+            _assetStreamer->update();
+            
             auto newTime = std::chrono::high_resolution_clock::now();
             
             float frameTime = std::chrono::duration<float, std::chrono::seconds::period>(newTime - currentTime).count();
@@ -115,21 +147,28 @@ namespace lve
             {
                 int frameIndex = _lveRenderer.getFrameIndex();
                 
+                // beginFrame() waited for this frame index's previous submission, so its data can be overwritten.
+                frameAllocator.beginFrame(frameIndex);
+                frameDescriptorAllocators[frameIndex]->reset();
+                
+                // update
+                GlobalUbo ubo{};
+                ubo.projectionView = camera.getProjection() * camera.getView();
+                LveFrameAllocator::Slice uboSlice = frameAllocator.pushUniform(ubo);
+                
                 FrameInfo frameInfo
                 {
                     frameIndex,
                     frameTime,
                     commandBuffer,
                     camera,
-                    globalDescriptorSets[frameIndex]
+                    globalDescriptorSet,
+                    uboSlice.dynamicOffset(),
+                    frameAllocator,
+                    *frameDescriptorAllocators[frameIndex],
+                    *_descriptorCache
                 };
                 
-                // update
-                GlobalUbo ubo{};
-                ubo.projectionView = camera.getProjection() * camera.getView();
-                uboBuffers[frameIndex]->writeToBuffer(&ubo);
-                uboBuffers[frameIndex]->flush();
-                
                 // Render
                 
                 //   Record to vkCommandBuffer to begin this render pass vkCmdRenderPass(...).
@@ -141,9 +180,14 @@ namespace lve
                 //   vkCmdEndRenderPass(...)
                 _lveRenderer.endSwapChainRenderPass(commandBuffer);
                 
+                // Render systems may have pushed more data; all of it must be visible before the submit.
+                frameAllocator.flush();
+                
                 //   vkEndCommandBuffer(...), vkQueueSubmit(..., submitInfo containing buffer, ...)
                 _lveRenderer.endFrame();
             }
+            
+            _modelRegistry.endFrame();
         }
         
         vkDeviceWaitIdle(_lveDevice.device());
@@ -151,27 +195,58 @@ namespace lve
 
     void FirstApp::loadGameObjects()
     {
-        std::shared_ptr<LveModel> lveModel = LveModel::createModelFromFile(_lveDevice, "/Users/flo/LocalDocuments/Projects/VulkanLearning/GalaTutorial/GalaTutorial/models/flat_vase.obj");
-        
+        // Objects are drawn once their model is resident; until then their _model is null.
         auto flatVase = LveGameObject::createGameObject();
-        flatVase._model = lveModel;
         flatVase._transformComp._translation = {-.5f, .5f, 0.f};
         flatVase._transformComp._scale = glm::vec3(3.f, 1.5f, 3.f);
         gameObjects.push_back(std::move(flatVase));
         
-        lveModel = LveModel::createModelFromFile(_lveDevice, "/Users/flo/LocalDocuments/Projects/VulkanLearning/GalaTutorial/GalaTutorial/models/smooth_vase.obj");
         auto smoothVase = LveGameObject::createGameObject();
-        smoothVase._model = lveModel;
         smoothVase._transformComp._translation = {.5f, .5f, 0.f};
         smoothVase._transformComp._scale = glm::vec3(3.f, 1.5f, 3.f);
         gameObjects.push_back(std::move(smoothVase));
         
-        lveModel = LveModel::createModelFromFile(_lveDevice, "/Users/flo/LocalDocuments/Projects/VulkanLearning/GalaTutorial/GalaTutorial/models/quad.obj");
         auto floor = LveGameObject::createGameObject();
-        floor._model = lveModel;
         floor._transformComp._translation = {0.f, .5f, 0.f};
         floor._transformComp._scale = glm::vec3(3.f, 1.0f, 3.f);
         gameObjects.push_back(std::move(floor));
+        
+        // Callbacks run in update() on this thread, so they can write to gameObjects directly.
+        auto setModel = [this](size_t index)
+        {
+            return [this, index](std::shared_ptr<LveModel> model)
+            {
+                if (LOG_MODEL_STATISTICS)
+                {
+                    model->writeStatistics(std::cout);
+                }
+                gameObjects[index]._model = std::move(model);
+            };
+        };
+        
+        // Optimized for the vertex cache, with levels of detail; the vases are closed, so their
+        // meshlets can be culled.
+        LveModel::LoadOptions vaseOptions{};
+        vaseOptions.vertexLayout = LveModel::VertexLayout::CompactNormalizedPosition;
+        vaseOptions.optimizeMesh = true;
+        vaseOptions.lodCount = 4;
+        vaseOptions.buildMeshlets = true;
+        LveModel::LoadOptions floorOptions{};
+        floorOptions.optimizeMesh = true;
+        floorOptions.lodCount = 4;
+        
+        _assetStreamer->load(
+            "/Users/flo/LocalDocuments/Projects/VulkanLearning/GalaTutorial/GalaTutorial/models/flat_vase.obj",
+            setModel(0),
+            vaseOptions);
+        _assetStreamer->load(
+            "/Users/flo/LocalDocuments/Projects/VulkanLearning/GalaTutorial/GalaTutorial/models/smooth_vase.obj",
+            setModel(1),
+            vaseOptions);
+        _assetStreamer->load(
+            "/Users/flo/LocalDocuments/Projects/VulkanLearning/GalaTutorial/GalaTutorial/models/quad.obj",
+            setModel(2),
+            floorOptions);
     }
 
 }// namespace lve
@@ -2,11 +2,15 @@
 #define first_app_hpp
 
 #include <stdio.h>
+#include "lve_bindless_descriptors.hpp"
 #include "lve_descriptors.hpp"
 #include "lve_game_object.hpp"
 #include "lve_window.hpp"
 #include "lve_renderer.hpp"
 #include "lve_model.hpp"
+#include "lve_asset_streamer.hpp"
+#include "lve_model_registry.hpp"
+#include <array>
 #include <memory>
 #include <vector>
 
@@ -25,6 +29,13 @@ namespace lve
         static constexpr int WIDTH = 800;
         static constexpr int HEIGHT = 600;
         
+        // Writes LveDevice::getMemoryStatistics() as a JSON line to std::cout every frame. Pressing M
+        // writes it once.
+        static constexpr bool LOG_MEMORY_STATISTICS = false;
+        
+        // Writes LveModel::writeStatistics() of each model as it becomes resident.
+        static constexpr bool LOG_MODEL_STATISTICS = false;
+        
         void run();
         
         private:
@@ -33,10 +44,26 @@ namespace lve
         LveDevice                    _lveDevice{_lveWindow};
         LveRenderer                  _lveRenderer{_lveWindow, _lveDevice};
         
-        // note: order of declaration matters. Pool needs a device.
-        std::unique_ptr<LveDescriptorPool> globalPool{};
+        // note: order of declaration matters. Allocators need a device.
+        std::unique_ptr<LveDescriptorAllocator> globalDescriptorAllocator{};
+        
+        // Long-lived sets, allocated from globalDescriptorAllocator.
+        std::unique_ptr<LveDescriptorCache> _descriptorCache{};
+        
+        // One per frame in flight, reset when the frame begins.
+        std::array<std::unique_ptr<LveDescriptorAllocator>, LveSwapChain::MAX_FRAMES_IN_FLIGHT> frameDescriptorAllocators{};
+        
+        // Scene wide storage buffers and textures, if the device supports descriptor indexing.
+        // Declared before gameObjects, which may hold indices into it.
+        std::unique_ptr<LveBindlessDescriptors> _bindlessDescriptors{};
+        
+        // Declared before gameObjects, so the models they hold are released before the registry.
+        LveModelRegistry             _modelRegistry{_lveDevice};
         std::vector<LveGameObject>   gameObjects;
         
+        // Declared after gameObjects: its callbacks write into them, and it must stop first.
+        std::unique_ptr<LveAssetStreamer> _assetStreamer{};
+        
         void loadGameObjects();
     };
 }
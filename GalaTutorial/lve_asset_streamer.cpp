@@ -0,0 +1,150 @@
+#include "lve_asset_streamer.hpp"
+
+// std
+#include <utility>
+
+namespace lve
+{
+    LveAssetStreamer::LveAssetStreamer(LveDevice& device, LveModelRegistry* registry)
+    :   _lveDevice{device},
+        _registry{registry},
+        _worker{&LveAssetStreamer::work, this}
+    {}
+
+    LveAssetStreamer::~LveAssetStreamer()
+    {
+        {
+            std::lock_guard<std::mutex> lock{_mutex};
+            _stopping = true;
+            _requests.clear();
+        }
+        _requestAdded.notify_all();
+        _worker.join();
+
+        // Destroying the models waits for their uploads, submitting those update() has not seen yet.
+        _built.clear();
+        _uploading.clear();
+    }
+
+    void LveAssetStreamer::load(
+        const std::string& filepath,
+        ResidentCallback onResident,
+        const LveModel::LoadOptions& options)
+    {
+        {
+            std::lock_guard<std::mutex> lock{_mutex};
+            _requests.push_back({filepath, std::move(onResident), options});
+        }
+        _requestAdded.notify_one();
+    }
+
+    void LveAssetStreamer::update()
+    {
+        std::vector<Upload> built{};
+        {
+            std::lock_guard<std::mutex> lock{_mutex};
+            if (_error)
+            {
+                std::exception_ptr error = _error;
+                _error = nullptr;
+                std::rethrow_exception(error);
+            }
+            built.swap(_built);
+        }
+
+        for (Upload& upload : built)
+        {
+            upload.uploadBatch->submit();
+            _uploading.push_back(std::move(upload));
+        }
+
+        for (size_t i = 0; i < _uploading.size();)
+        {
+            Upload& upload = _uploading[i];
+            if (!upload.uploadBatch->isComplete())
+            {
+                i++;
+                continue;
+            }
+            // On a registry hit the batch above is empty: the model is uploaded by the batch of
+            // whoever loaded it first, which may still be pending or not even submitted.
+            LveSubmission submission{};
+            bool sharedPending = upload.model->getUploadSubmission(submission)
+                ? !_lveDevice.isComplete(submission)
+                : !upload.model->isUploaded();
+            if (sharedPending)
+            {
+                i++;
+                continue;
+            }
+            // The model's first bind() finds the batch complete and does not wait.
+            Upload resident = std::move(upload);
+            _uploading.erase(_uploading.begin() + i);
+            resident.uploadBatch = nullptr;
+            resident.onResident(std::move(resident.model));
+        }
+    }
+
+    uint32_t LveAssetStreamer::pendingCount() const
+    {
+        std::lock_guard<std::mutex> lock{_mutex};
+        return static_cast<uint32_t>(_requests.size() + _built.size() + _uploading.size()) + _building;
+    }
+
+    void LveAssetStreamer::work()
+    {
+        while (true)
+        {
+            Request request{};
+            {
+                std::unique_lock<std::mutex> lock{_mutex};
+                _requestAdded.wait(lock, [this] { return _stopping || !_requests.empty(); });
+                if (_stopping)
+                {
+                    return;
+                }
+                request = std::move(_requests.front());
+                _requests.pop_front();
+                _building++;
+            }
+
+            Upload upload{};
+            std::exception_ptr error{};
+            try
+            {
+                upload.uploadBatch = std::make_shared<LveUploadBatch>(_lveDevice, true);
+                if (_registry != nullptr)
+                {
+                    upload.model = _registry->acquire(
+                        request.filepath,
+                        request.options,
+                        upload.uploadBatch);
+                }
+                else
+                {
+                    upload.model = LveModel::createModelFromFile(
+                        _lveDevice,
+                        request.filepath,
+                        request.options,
+                        upload.uploadBatch);
+                }
+                upload.onResident = std::move(request.onResident);
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+            }
+
+            std::lock_guard<std::mutex> lock{_mutex};
+            _building--;
+            if (error)
+            {
+                _error = error;
+            }
+            else
+            {
+                _built.push_back(std::move(upload));
+            }
+        }
+    }
+}
@@ -0,0 +1,93 @@
+#ifndef lve_asset_streamer_hpp
+#define lve_asset_streamer_hpp
+
+#pragma once
+
+#include "lve_device.hpp"
+#include "lve_model.hpp"
+#include "lve_model_registry.hpp"
+#include "lve_upload_batch.hpp"
+
+// std
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace lve
+{
+    // Loads models in the background. A worker thread parses and builds each model and writes its
+    // buffers into an LveUploadBatch on the dedicated transfer queue (see LveUploadBatch). The render
+    // loop calls update() once per frame: it submits what the worker finished and, once an upload
+    // has completed and the buffers are owned by the graphics queue, hands the model to its callback.
+    // Neither the worker nor update() waits for the GPU, so frames keep being presented meanwhile.
+    //
+    // With a registry, models are acquired from it, so a file streamed twice is loaded once.
+    class LveAssetStreamer
+    {
+        public:
+
+        using ResidentCallback = std::function<void(std::shared_ptr<LveModel>)>;
+
+        explicit LveAssetStreamer(LveDevice& device, LveModelRegistry* registry = nullptr);
+
+        // Stops the worker after the model it is building and waits for submitted uploads.
+        ~LveAssetStreamer();
+
+        LveAssetStreamer(const LveAssetStreamer&) = delete;
+        LveAssetStreamer& operator=(const LveAssetStreamer&) = delete;
+
+        // Queues a model; onResident runs on the thread that calls update().
+        void load(
+            const std::string& filepath,
+            ResidentCallback onResident,
+            const LveModel::LoadOptions& options = {});
+
+        // Rethrows, on the calling thread, an exception the worker hit while loading.
+        void update();
+
+        // Models queued, being built or being uploaded.
+        uint32_t pendingCount() const;
+
+        private:
+
+        struct Request
+        {
+            std::string filepath;
+            ResidentCallback onResident;
+            LveModel::LoadOptions options;
+        };
+
+        struct Upload
+        {
+            std::shared_ptr<LveModel> model;
+            std::shared_ptr<LveUploadBatch> uploadBatch;
+            ResidentCallback onResident;
+        };
+
+        void work();
+
+        LveDevice&                  _lveDevice;
+        LveModelRegistry*           _registry;
+
+        mutable std::mutex          _mutex;
+        std::condition_variable     _requestAdded;
+        std::deque<Request>         _requests{};
+        std::vector<Upload>         _built{};
+        std::exception_ptr          _error{};
+        uint32_t                    _building = 0;
+        bool                        _stopping = false;
+
+        // Only touched by update() and the destructor.
+        std::vector<Upload>         _uploading{};
+
+        std::thread                 _worker;
+    };
+}
+
+#endif /* lve_asset_streamer_hpp */
@@ -0,0 +1,1435 @@
+#include "lve_benchmarks.hpp"
+#include "lve_bindless_descriptors.hpp"
+#include "lve_buffer.hpp"
+#include "lve_camera.hpp"
+#include "lve_descriptors.hpp"
+#include "lve_device.hpp"
+#include "lve_frame_allocator.hpp"
+#include "lve_game_object.hpp"
+#include "lve_mesh_cache.hpp"
+#include "lve_mesh_optimizer.hpp"
+#include "lve_meshlets.hpp"
+#include "lve_model.hpp"
+#include "lve_obj_parser.hpp"
+#include "lve_renderer.hpp"
+#include "lve_upload_batch.hpp"
+#include "lve_vertex_format.hpp"
+#include "lve_vertex_weld_table.hpp"
+#include "lve_window.hpp"
+#include "simple_render_system.hpp"
+
+// std
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+
+namespace lve
+{
+    namespace
+    {
+        const std::string DEFAULT_MODEL_DIRECTORY =
+            "/Users/flo/LocalDocuments/Projects/VulkanLearning/GalaTutorial/GalaTutorial/models";
+
+        using Clock = std::chrono::high_resolution_clock;
+
+        double millisecondsSince(Clock::time_point start)
+        {
+            return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        }
+
+        // .obj files in directory, sorted by name so runs are comparable.
+        std::vector<std::string> objFilesIn(const std::string& directory)
+        {
+            std::vector<std::string> files{};
+            for (const auto& entry : std::filesystem::directory_iterator(directory))
+            {
+                if (entry.is_regular_file() && entry.path().extension() == ".obj")
+                {
+                    files.push_back(entry.path().string());
+                }
+            }
+            std::sort(files.begin(), files.end());
+            return files;
+        }
+
+        // Median of runs calls to task, in milliseconds.
+        template <typename Task>
+        double medianMilliseconds(int runs, Task task)
+        {
+            std::vector<double> times{};
+            for (int i = 0; i < runs; i++)
+            {
+                auto start = Clock::now();
+                task();
+                times.push_back(millisecondsSince(start));
+            }
+            std::sort(times.begin(), times.end());
+            return times[times.size() / 2];
+        }
+
+        // Triangles with each rotated to start at its smallest vertex, sorted, so two index buffers
+        // can be compared regardless of triangle order.
+        std::vector<std::array<LveModel::Vertex, 3>> canonicalTriangles(
+            const std::vector<LveModel::Vertex>& vertices,
+            const std::vector<uint32_t>& indices)
+        {
+            auto less = [](const LveModel::Vertex& a, const LveModel::Vertex& b)
+            {
+                return memcmp(&a, &b, sizeof(LveModel::Vertex)) < 0;
+            };
+
+            std::vector<std::array<LveModel::Vertex, 3>> triangles{};
+            for (size_t i = 0; i + 2 < indices.size(); i += 3)
+            {
+                std::array<LveModel::Vertex, 3> triangle{
+                    vertices[indices[i]], vertices[indices[i + 1]], vertices[indices[i + 2]]};
+                while (less(triangle[1], triangle[0]) || less(triangle[2], triangle[0]))
+                {
+                    std::rotate(triangle.begin(), triangle.begin() + 1, triangle.end());
+                }
+                triangles.push_back(triangle);
+            }
+            std::sort(triangles.begin(), triangles.end(), [&](const auto& a, const auto& b)
+            {
+                return memcmp(a.data(), b.data(), sizeof(a)) < 0;
+            });
+            return triangles;
+        }
+
+        // GlobalUbo of simple_shader.vert, as FirstApp writes it.
+        struct BenchmarkGlobalUbo
+        {
+            glm::mat4 projectionView{1.f};
+            glm::vec4 ambientLightColor{1.f, 1.f, 1.f, .02f};
+            glm::vec3 lightPosition{-1.f};
+            alignas(16) glm::vec4 lightColor{1.f};
+        };
+
+        std::string argOr(const std::vector<std::string>& args, size_t index, const std::string& fallback)
+        {
+            return index < args.size() ? args[index] : fallback;
+        }
+    }
+
+    void runBenchmark(const std::vector<std::string>& args)
+    {
+        const std::string name = argOr(args, 0, "");
+
+        if (name == "mesh-cache")
+        {
+            benchmarkMeshCache(argOr(args, 1, DEFAULT_MODEL_DIRECTORY));
+            return;
+        }
+        if (name == "obj-parse")
+        {
+            benchmarkObjParse(
+                argOr(args, 1, DEFAULT_MODEL_DIRECTORY),
+                static_cast<unsigned>(std::stoul(argOr(args, 2, "0"))));
+            return;
+        }
+        if (name == "weld")
+        {
+            benchmarkWeld(
+                argOr(args, 1, DEFAULT_MODEL_DIRECTORY),
+                std::stof(argOr(args, 2, "0.0001")));
+            return;
+        }
+
+        if (name == "mesh-optimize")
+        {
+            benchmarkMeshOptimize(argOr(args, 1, DEFAULT_MODEL_DIRECTORY));
+            return;
+        }
+        if (name == "vertex-format")
+        {
+            benchmarkVertexFormat(argOr(args, 1, DEFAULT_MODEL_DIRECTORY));
+            return;
+        }
+        if (name == "lod")
+        {
+            benchmarkLod(argOr(args, 1, DEFAULT_MODEL_DIRECTORY));
+            return;
+        }
+        if (name == "meshlets")
+        {
+            benchmarkMeshlets(argOr(args, 1, DEFAULT_MODEL_DIRECTORY));
+            return;
+        }
+        if (name == "object-data")
+        {
+            benchmarkObjectData(static_cast<uint32_t>(std::stoul(argOr(args, 1, "100000"))));
+            return;
+        }
+        if (name == "upload")
+        {
+            benchmarkUpload(
+                argOr(args, 1, DEFAULT_MODEL_DIRECTORY),
+                std::stoi(argOr(args, 2, "9")));
+            return;
+        }
+        if (name == "descriptor-allocator")
+        {
+            benchmarkDescriptorAllocator(static_cast<uint32_t>(std::stoul(argOr(args, 1, "10000"))));
+            return;
+        }
+        if (name == "descriptor-update")
+        {
+            benchmarkDescriptorUpdate(static_cast<uint32_t>(std::stoul(argOr(args, 1, "10000"))));
+            return;
+        }
+        if (name == "pipeline-cache")
+        {
+            benchmarkPipelineCache(argOr(args, 1, "lve_pipeline_cache_benchmark.bin"));
+            return;
+        }
+        if (name == "descriptor-cache")
+        {
+            benchmarkDescriptorCache(
+                static_cast<uint32_t>(std::stoul(argOr(args, 1, "10000"))),
+                static_cast<uint32_t>(std::stoul(argOr(args, 2, "64"))));
+            return;
+        }
+        if (name == "frame-pacing")
+        {
+            benchmarkFramePacing(
+                static_cast<uint32_t>(std::stoul(argOr(args, 1, "600"))),
+                std::stoull(argOr(args, 2, "4096")) * 1024);
+            return;
+        }
+
+        throw std::runtime_error(
+            "unknown benchmark '" + name + "'. Available: "
+            "mesh-cache [modelDirectory], "
+            "obj-parse [modelDirectory] [maxThreads], "
+            "weld [modelDirectory] [epsilon], "
+            "mesh-optimize [modelDirectory], "
+            "vertex-format [modelDirectory], "
+            "lod [modelDirectory], "
+            "meshlets [modelDirectory], "
+            "object-data [maxObjects], "
+            "upload [modelDirectory] [runs], "
+            "frame-pacing [frames] [uploadKiB], "
+            "descriptor-allocator [sets], "
+            "descriptor-cache [builds] [distinctSets], "
+            "descriptor-update [updates], "
+            "pipeline-cache [cacheFile]");
+    }
+
+    void benchmarkMeshCache(const std::string& modelDirectory)
+    {
+        std::cout << std::left << std::setw(24) << "model"
+                  << std::right << std::setw(10) << "vertices"
+                  << std::setw(10) << "indices"
+                  << std::setw(12) << "cold ms"
+                  << std::setw(12) << "warm ms"
+                  << std::setw(10) << "speedup" << "\n";
+
+        for (const std::string& path : objFilesIn(modelDirectory))
+        {
+            std::remove(LveMeshCache::cachePath(path).c_str());
+
+            auto start = Clock::now();
+            LveModel::Builder cold{};
+            cold.loadModel(path);
+            double coldMs = millisecondsSince(start);
+
+            start = Clock::now();
+            LveModel::Builder warm{};
+            warm.loadModel(path);
+            double warmMs = millisecondsSince(start);
+
+            if (warm._cacheFile == nullptr)
+            {
+                std::cout << path << ": cache was not written, warm load parsed the .obj again\n";
+            }
+
+            std::cout << std::left << std::setw(24) << std::filesystem::path(path).filename().string()
+                      << std::right << std::setw(10) << warm.vertexCount()
+                      << std::setw(10) << warm.indexCount()
+                      << std::fixed << std::setprecision(3)
+                      << std::setw(12) << coldMs
+                      << std::setw(12) << warmMs
+                      << std::setprecision(1)
+                      << std::setw(9) << (warmMs > 0.0 ? coldMs / warmMs : 0.0) << "x\n";
+        }
+    }
+
+    void benchmarkObjParse(const std::string& modelDirectory, unsigned maxThreads)
+    {
+        const int runs = 5;
+        if (maxThreads == 0)
+        {
+            maxThreads = std::max(1u, std::thread::hardware_concurrency());
+        }
+
+        for (const std::string& path : objFilesIn(modelDirectory))
+        {
+            std::shared_ptr<LveMappedFile> source = LveMappedFile::open(path);
+            if (source == nullptr)
+            {
+                throw std::runtime_error("failed to open file: " + path);
+            }
+
+            LveModel::Builder reference{};
+            double tinyobjMs = medianMilliseconds(runs, [&]() { reference.parseObj(path); });
+
+            std::cout << std::filesystem::path(path).filename().string()
+                      << " (" << source->size() / 1024 << " KiB, "
+                      << reference.vertexCount() << " vertices, "
+                      << reference.indexCount() << " indices)\n"
+                      << std::fixed << std::setprecision(3)
+                      << "  tinyobj    " << std::setw(10) << tinyobjMs << " ms\n";
+
+            double singleThreadMs = 0.0;
+            for (unsigned threads = 1; threads <= maxThreads; threads++)
+            {
+                std::vector<LveModel::Vertex> vertices{};
+                std::vector<uint32_t> indices{};
+                bool parsed = false;
+                double ms = medianMilliseconds(runs, [&]()
+                {
+                    parsed = LveObjParser::parse(source->data(), source->size(), threads, vertices, indices);
+                });
+
+                if (!parsed)
+                {
+                    std::cout << "  parallel parser not applicable, serial path is used\n";
+                    break;
+                }
+
+                bool identical =
+                    vertices == reference._vertices &&
+                    indices == reference._indices;
+
+                if (threads == 1)
+                {
+                    singleThreadMs = ms;
+                }
+
+                std::cout << "  " << std::setw(2) << threads << " thread" << (threads == 1 ? " " : "s")
+                          << std::setw(10) << ms << " ms"
+                          << std::setprecision(2)
+                          << "  scaling " << std::setw(5) << (ms > 0.0 ? singleThreadMs / ms : 0.0) << "x"
+                          << "  vs tinyobj " << std::setw(5) << (ms > 0.0 ? tinyobjMs / ms : 0.0) << "x"
+                          << std::setprecision(3)
+                          << (identical ? "" : "  MISMATCH") << "\n";
+            }
+        }
+    }
+
+    void benchmarkWeld(const std::string& modelDirectory, float weldEpsilon)
+    {
+        const int runs = 9;
+
+        for (const std::string& path : objFilesIn(modelDirectory))
+        {
+            // The loader sees one vertex per face corner.
+            LveModel::Builder reference{};
+            reference.parseObj(path);
+            std::vector<LveModel::Vertex> corners{};
+            corners.reserve(reference._indices.size());
+            for (uint32_t index : reference._indices)
+            {
+                corners.push_back(reference._vertices[index]);
+            }
+
+            std::vector<LveModel::Vertex> vertices{};
+            std::vector<uint32_t> indices{};
+            auto matchesReference = [&]()
+            {
+                return vertices == reference._vertices && indices == reference._indices;
+            };
+
+            double countMs = medianMilliseconds(runs, [&]()
+            {
+                vertices.clear();
+                indices.clear();
+                std::unordered_map<LveModel::Vertex, uint32_t> uniqueVertices{};
+                for (const LveModel::Vertex& vertex : corners)
+                {
+                    if (uniqueVertices.count(vertex) == 0)
+                    {
+                        uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
+                        vertices.push_back(vertex);
+                    }
+                    indices.push_back(uniqueVertices[vertex]);
+                }
+            });
+            bool countMatches = matchesReference();
+
+            double emplaceMs = medianMilliseconds(runs, [&]()
+            {
+                vertices.clear();
+                indices.clear();
+                std::unordered_map<LveModel::Vertex, uint32_t> uniqueVertices{};
+                uniqueVertices.reserve(corners.size());
+                for (const LveModel::Vertex& vertex : corners)
+                {
+                    auto inserted = uniqueVertices.emplace(vertex, static_cast<uint32_t>(vertices.size()));
+                    if (inserted.second)
+                    {
+                        vertices.push_back(vertex);
+                    }
+                    indices.push_back(inserted.first->second);
+                }
+            });
+            bool emplaceMatches = matchesReference();
+
+            double tableMs = medianMilliseconds(runs, [&]()
+            {
+                vertices.clear();
+                indices.clear();
+                LveVertexWeldTable uniqueVertices{vertices, corners.size()};
+                for (const LveModel::Vertex& vertex : corners)
+                {
+                    indices.push_back(uniqueVertices.findOrInsert(vertex));
+                }
+            });
+            bool tableMatches = matchesReference();
+
+            std::vector<LveModel::Vertex> welded = reference._vertices;
+            std::vector<uint32_t> weldedIndices = reference._indices;
+            double weldMs = medianMilliseconds(1, [&]()
+            {
+                LveVertexWeldTable::weld(welded, weldedIndices, weldEpsilon);
+            });
+
+            auto nsPerCorner = [&](double ms)
+            {
+                return corners.empty() ? 0.0 : ms * 1e6 / static_cast<double>(corners.size());
+            };
+
+            std::cout << std::filesystem::path(path).filename().string()
+                      << " (" << corners.size() << " corners, "
+                      << reference._vertices.size() << " unique vertices)\n"
+                      << std::fixed << std::setprecision(3)
+                      << "  unordered_map count+[] " << std::setw(9) << countMs << " ms "
+                      << std::setw(7) << nsPerCorner(countMs) << " ns/corner"
+                      << (countMatches ? "" : "  MISMATCH") << "\n"
+                      << "  unordered_map emplace  " << std::setw(9) << emplaceMs << " ms "
+                      << std::setw(7) << nsPerCorner(emplaceMs) << " ns/corner"
+                      << (emplaceMatches ? "" : "  MISMATCH") << "\n"
+                      << "  LveVertexWeldTable     " << std::setw(9) << tableMs << " ms "
+                      << std::setw(7) << nsPerCorner(tableMs) << " ns/corner"
+                      << (tableMatches ? "" : "  MISMATCH")
+                      << std::setprecision(2)
+                      << "  (" << (tableMs > 0.0 ? countMs / tableMs : 0.0) << "x)\n"
+                      << std::setprecision(3)
+                      << "  weld epsilon " << std::defaultfloat << weldEpsilon << std::fixed << ": "
+                      << welded.size() << " vertices, "
+                      << weldedIndices.size() / 3 << " triangles, "
+                      << weldMs << " ms\n";
+        }
+    }
+
+    void benchmarkMeshOptimize(const std::string& modelDirectory)
+    {
+        for (const std::string& path : objFilesIn(modelDirectory))
+        {
+            LveModel::Builder builder{};
+            builder.parseObj(path);
+            auto reference = canonicalTriangles(builder._vertices, builder._indices);
+
+            std::cout << std::filesystem::path(path).filename().string()
+                      << " (" << builder._vertices.size() << " vertices, "
+                      << builder._indices.size() / 3 << " triangles)\n"
+                      << "  pass            ACMR    ATVR        ms\n";
+
+            auto report = [&](const char* pass, double ms)
+            {
+                LveModel::VertexCacheStatistics statistics =
+                    LveMeshOptimizer::analyzeVertexCache(builder._indices, builder._vertices.size());
+                std::cout << "  " << std::left << std::setw(12) << pass << std::right
+                          << std::fixed << std::setprecision(3)
+                          << std::setw(8) << statistics.acmr
+                          << std::setw(8) << statistics.atvr
+                          << std::setw(10) << ms << "\n";
+            };
+
+            report("obj order", 0.0);
+
+            auto start = Clock::now();
+            LveMeshOptimizer::optimizeVertexCache(builder._indices, builder._vertices.size());
+            report("tipsify", millisecondsSince(start));
+
+            start = Clock::now();
+            LveMeshOptimizer::optimizeOverdraw(builder._indices, builder._vertices);
+            report("overdraw", millisecondsSince(start));
+
+            start = Clock::now();
+            LveMeshOptimizer::optimizeVertexFetch(builder._vertices, builder._indices);
+            report("fetch remap", millisecondsSince(start));
+
+            if (canonicalTriangles(builder._vertices, builder._indices) != reference)
+            {
+                std::cout << "  MISMATCH: the optimized mesh has different triangles\n";
+            }
+        }
+    }
+
+    void benchmarkVertexFormat(const std::string& modelDirectory)
+    {
+        const int runs = 9;
+        const std::pair<LveModel::VertexLayout, const char*> layouts[] =
+        {
+            {LveModel::VertexLayout::Full, "full"},
+            {LveModel::VertexLayout::CompactHalfPosition, "half pos"},
+            {LveModel::VertexLayout::CompactNormalizedPosition, "unorm pos"}
+        };
+
+        for (const std::string& path : objFilesIn(modelDirectory))
+        {
+            LveModel::Builder builder{};
+            builder.parseObj(path);
+            builder.optimizeMesh();
+            const std::vector<LveModel::Vertex>& vertices = builder._vertices;
+
+            glm::vec3 minimum{0.f};
+            glm::vec3 maximum{0.f};
+            if (!vertices.empty())
+            {
+                minimum = maximum = vertices[0].position;
+                for (const LveModel::Vertex& vertex : vertices)
+                {
+                    minimum = glm::min(minimum, vertex.position);
+                    maximum = glm::max(maximum, vertex.position);
+                }
+            }
+            float diagonal = glm::length(maximum - minimum);
+
+            // Vertices the GPU fetches per draw: one per post-transform cache miss.
+            float transformedVertices =
+                builder._cacheStatisticsAfter.acmr * static_cast<float>(builder._indices.size() / 3);
+
+            std::cout << std::filesystem::path(path).filename().string()
+                      << " (" << vertices.size() << " vertices)\n"
+                      << "  layout     stride    buffer KiB  fetched KiB/draw  encode ms"
+                      << "  pos err %diag  normal err deg  color err  uv err\n";
+
+            size_t fullBytes = vertices.size() * sizeof(LveModel::Vertex);
+            for (const auto& [layout, name] : layouts)
+            {
+                std::vector<char> encoded{};
+                glm::mat4 positionDecode{1.f};
+                double encodeMs = medianMilliseconds(runs, [&]()
+                {
+                    positionDecode = LveVertexFormat::encode(
+                        layout, vertices.data(), static_cast<uint32_t>(vertices.size()), encoded);
+                });
+
+                uint32_t stride = LveVertexFormat::stride(layout);
+                float positionError = 0.f;
+                float normalError = 0.f;
+                float colorError = 0.f;
+                float uvError = 0.f;
+                for (size_t i = 0; i < vertices.size(); i++)
+                {
+                    LveModel::Vertex decoded = LveVertexFormat::decode(
+                        layout, encoded.data() + i * stride, positionDecode);
+                    const LveModel::Vertex& vertex = vertices[i];
+
+                    positionError = std::max(positionError, glm::length(decoded.position - vertex.position));
+                    float normalLength = glm::length(vertex.normal);
+                    if (normalLength > 0.f)
+                    {
+                        // atan2 stays accurate for small angles, where acos of the dot product does not.
+                        glm::vec3 unit = vertex.normal / normalLength;
+                        glm::vec3 decodedUnit = glm::normalize(decoded.normal);
+                        float angle = std::atan2(glm::length(glm::cross(decodedUnit, unit)), glm::dot(decodedUnit, unit));
+                        normalError = std::max(normalError, glm::degrees(angle));
+                    }
+                    glm::vec3 colorDelta = glm::abs(decoded.color - vertex.color);
+                    colorError = std::max({colorError, colorDelta.x, colorDelta.y, colorDelta.z});
+                    glm::vec2 uvDelta = glm::abs(decoded.uv - vertex.uv);
+                    uvError = std::max({uvError, uvDelta.x, uvDelta.y});
+                }
+
+                std::cout << "  " << std::left << std::setw(10) << name << std::right
+                          << std::setw(7) << stride
+                          << std::fixed << std::setprecision(1)
+                          << std::setw(10) << encoded.size() / 1024.0
+                          << " (" << std::setw(3) << static_cast<int>(std::lround(100.0 * encoded.size() / std::max<size_t>(fullBytes, 1))) << "%)"
+                          << std::setw(12) << transformedVertices * stride / 1024.f
+                          << std::setprecision(3)
+                          << std::setw(17) << encodeMs
+                          << std::setprecision(4)
+                          << std::setw(15) << (diagonal > 0.f ? 100.f * positionError / diagonal : 0.f)
+                          << std::setw(16) << normalError
+                          << std::setw(11) << colorError
+                          << std::setw(8) << uvError << "\n";
+            }
+        }
+    }
+
+    void benchmarkLod(const std::string& modelDirectory)
+    {
+        for (const std::string& path : objFilesIn(modelDirectory))
+        {
+            LveModel::Builder builder{};
+            builder.parseObj(path);
+            builder.optimizeMesh();
+            builder._lodCount = LveModel::MAX_LOD_COUNT;
+
+            auto start = Clock::now();
+            builder.buildLods();
+            double ms = millisecondsSince(start);
+
+            std::cout << std::filesystem::path(path).filename().string()
+                      << " (" << builder.lodCount() << " levels in " << std::fixed << std::setprecision(3)
+                      << ms << " ms)\n"
+                      << "  lod  triangles   share       error\n";
+
+            const LveModel::Lod* lods = builder.lodData();
+            for (uint32_t level = 0; level < builder.lodCount(); level++)
+            {
+                std::cout << std::setw(5) << level
+                          << std::setw(11) << lods[level].indexCount / 3
+                          << std::setprecision(1)
+                          << std::setw(7) << 100.0 * lods[level].indexCount / lods[0].indexCount << "%"
+                          << std::setprecision(5)
+                          << std::setw(12) << lods[level].error << "\n";
+            }
+        }
+    }
+
+    void benchmarkMeshlets(const std::string& modelDirectory)
+    {
+        // Cameras on a sphere around each model, looking at its center: from three bounding sphere
+        // radii the whole model is in view, from 1.2 radii much of it is outside the frustum.
+        struct View
+        {
+            const char* name;
+            float distance;
+        };
+        const View views[] = {{"orbit", 3.f}, {"close", 1.2f}};
+        const int cameraCount = 64;
+
+        for (const std::string& path : objFilesIn(modelDirectory))
+        {
+            LveModel::Builder builder{};
+            builder.parseObj(path);
+            builder.optimizeMesh();
+
+            auto start = Clock::now();
+            builder.buildMeshlets();
+            double ms = millisecondsSince(start);
+
+            const std::vector<LveModel::Vertex>& vertices = builder._vertices;
+            const std::vector<uint32_t>& indices = builder._indices;
+            const std::vector<LveModel::Meshlet>& meshlets = builder._meshlets;
+
+            size_t meshletVertices = 0;
+            std::vector<uint32_t> seenIn(vertices.size(), UINT32_MAX);
+            for (uint32_t m = 0; m < meshlets.size(); m++)
+            {
+                for (uint32_t i = 0; i < meshlets[m].indexCount; i++)
+                {
+                    uint32_t vertex = indices[meshlets[m].firstIndex + i];
+                    if (seenIn[vertex] != m)
+                    {
+                        seenIn[vertex] = m;
+                        meshletVertices++;
+                    }
+                }
+            }
+
+            glm::vec3 minimum = vertices[0].position;
+            glm::vec3 maximum = minimum;
+            for (const LveModel::Vertex& vertex : vertices)
+            {
+                minimum = glm::min(minimum, vertex.position);
+                maximum = glm::max(maximum, vertex.position);
+            }
+            glm::vec3 center = (minimum + maximum) * 0.5f;
+            float radius = glm::length(maximum - center);
+
+            const size_t triangleCount = indices.size() / 3;
+            std::cout << std::filesystem::path(path).filename().string()
+                      << " (" << triangleCount << " triangles, " << meshlets.size() << " meshlets, "
+                      << std::fixed << std::setprecision(1)
+                      << static_cast<double>(triangleCount) / meshlets.size() << " triangles and "
+                      << static_cast<double>(meshletVertices) / meshlets.size() << " vertices per meshlet, "
+                      << std::setprecision(3) << ms << " ms)\n"
+                      << "  view     frustum  back facing    culled   per triangle   draws\n";
+
+            for (const View& view : views)
+            {
+                uint64_t frustumCulled = 0;
+                uint64_t backFacing = 0;
+                uint64_t backFacingTriangles = 0;
+                uint64_t draws = 0;
+
+                for (int c = 0; c < cameraCount; c++)
+                {
+                    // Fibonacci sphere; never exactly on the up axis.
+                    float z = 1.f - (2.f * c + 1.f) / cameraCount;
+                    float ring = std::sqrt(1.f - z * z);
+                    float angle = 2.39996323f * c;
+                    glm::vec3 direction{ring * std::cos(angle), z, ring * std::sin(angle)};
+                    glm::vec3 position = center + direction * radius * view.distance;
+
+                    LveCamera camera{};
+                    camera.setViewTarget(position, center);
+                    camera.setPerspectiveProjection(glm::radians(50.f), 16.f / 9.f, .01f * radius, 100.f * radius);
+                    LveMeshlets::Frustum frustum =
+                        LveMeshlets::Frustum::fromMatrix(camera.getProjection() * camera.getView());
+
+                    bool drawing = false;
+                    for (const LveModel::Meshlet& meshlet : meshlets)
+                    {
+                        bool visible = false;
+                        if (!frustum.intersectsSphere(meshlet.center, meshlet.radius))
+                        {
+                            frustumCulled += meshlet.indexCount / 3;
+                        }
+                        else if (LveMeshlets::isBackFacing(meshlet, position))
+                        {
+                            backFacing += meshlet.indexCount / 3;
+                        }
+                        else
+                        {
+                            visible = true;
+                        }
+                        draws += visible && !drawing;
+                        drawing = visible;
+                    }
+
+                    // Lower bound on what could be culled: every triangle that faces away.
+                    for (size_t t = 0; t < triangleCount; t++)
+                    {
+                        const glm::vec3& a = vertices[indices[3 * t + 0]].position;
+                        const glm::vec3& b = vertices[indices[3 * t + 1]].position;
+                        const glm::vec3& p = vertices[indices[3 * t + 2]].position;
+                        backFacingTriangles += glm::dot(a - position, glm::cross(b - a, p - a)) > 0.f;
+                    }
+                }
+
+                double total = static_cast<double>(triangleCount) * cameraCount;
+                std::cout << "  " << std::left << std::setw(6) << view.name << std::right
+                          << std::setprecision(1)
+                          << std::setw(10) << 100.0 * frustumCulled / total << "%"
+                          << std::setw(12) << 100.0 * backFacing / total << "%"
+                          << std::setw(9) << 100.0 * (frustumCulled + backFacing) / total << "%"
+                          << std::setw(14) << 100.0 * backFacingTriangles / total << "%"
+                          << std::setw(8) << static_cast<double>(draws) / cameraCount << "\n";
+            }
+        }
+    }
+
+    void benchmarkObjectData(uint32_t maxObjects)
+    {
+        const uint32_t warmupFrames = 10;
+        const uint32_t measuredFrames = 50;
+        const uint32_t queriesPerFrame = 2;
+
+        LveWindow window{320, 240, "object data benchmark"};
+        LveDevice device{window};
+        LveRenderer renderer{window, device};
+
+        // The global set, frame allocator and descriptor allocators as FirstApp sets them up.
+        LveFrameAllocator frameAllocator{device};
+        std::unique_ptr<LveDescriptorAllocator> globalDescriptorAllocator = LveDescriptorAllocator::Builder(device)
+            .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.f)
+            .build();
+        LveDescriptorCache descriptorCache{device, *globalDescriptorAllocator};
+        std::array<std::unique_ptr<LveDescriptorAllocator>, LveSwapChain::MAX_FRAMES_IN_FLIGHT> frameDescriptors{};
+        for (auto& frameDescriptorAllocator : frameDescriptors)
+        {
+            frameDescriptorAllocator = LveDescriptorAllocator::Builder(device)
+                .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.f)
+                .build();
+        }
+        std::unique_ptr<LveDescriptorSetLayout> globalSetLayout = LveDescriptorSetLayout::Builder(device)
+            .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT)
+            .build();
+        VkDescriptorSet globalDescriptorSet = VK_NULL_HANDLE;
+        VkDescriptorBufferInfo globalBufferInfo{frameAllocator.getBuffer(), 0, sizeof(BenchmarkGlobalUbo)};
+        LveDescriptorWriter{*globalSetLayout, *globalDescriptorAllocator}
+            .writeBuffer(0, &globalBufferInfo)
+            .build(globalDescriptorSet);
+
+        SimpleRenderSystem renderSystem{
+            device,
+            renderer.getSwapChainRenderPass(),
+            globalSetLayout->getVkDescriptorSetLayout()};
+
+        // Two timestamps around each frame's render pass, per frame in flight.
+        const bool timestamps = device.properties.limits.timestampComputeAndGraphics == VK_TRUE;
+        VkQueryPool queryPool = VK_NULL_HANDLE;
+        if (timestamps)
+        {
+            VkQueryPoolCreateInfo queryPoolInfo{};
+            queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+            queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+            queryPoolInfo.queryCount = queriesPerFrame * LveSwapChain::MAX_FRAMES_IN_FLIGHT;
+            if (vkCreateQueryPool(device.device(), &queryPoolInfo, nullptr, &queryPool) != VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to create query pool!");
+            }
+        }
+
+        // A quad facing the camera; objects are laid out on a grid that fills the view.
+        LveModel::Builder builder{};
+        builder._vertices = {
+            {{-.5f, -.5f, 0.f}, {1.f, 0.f, 0.f}, {0.f, 0.f, -1.f}, {0.f, 0.f}},
+            {{.5f, -.5f, 0.f}, {0.f, 1.f, 0.f}, {0.f, 0.f, -1.f}, {1.f, 0.f}},
+            {{.5f, .5f, 0.f}, {0.f, 0.f, 1.f}, {0.f, 0.f, -1.f}, {1.f, 1.f}},
+            {{-.5f, .5f, 0.f}, {1.f, 1.f, 1.f}, {0.f, 0.f, -1.f}, {0.f, 1.f}}};
+        builder._indices = {0, 1, 2, 2, 3, 0};
+        std::shared_ptr<LveModel> model = std::make_shared<LveModel>(device, builder);
+
+        LveCamera camera{};
+        camera.setOrthographicProjection(-1.f, 1.f, -1.f, 1.f, -1.f, 1.f);
+
+        const std::pair<SimpleRenderSystem::ObjectDataPath, const char*> paths[] = {
+            {SimpleRenderSystem::ObjectDataPath::PushConstants, "push constants"},
+            {SimpleRenderSystem::ObjectDataPath::DynamicUniform, "dynamic uniform"}};
+
+        std::cout << device.properties.deviceName << ", median of " << measuredFrames << " frames\n"
+                  << std::left << std::setw(10) << "objects"
+                  << std::setw(18) << "path"
+                  << std::right << std::setw(12) << "record ms"
+                  << std::setw(10) << "gpu ms"
+                  << std::setw(8) << "draws" << "\n";
+
+        for (uint32_t objectCount = 100; objectCount <= maxObjects; objectCount *= 10)
+        {
+            const uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(objectCount))));
+            const float spacing = 2.f / static_cast<float>(side);
+            std::vector<LveGameObject> gameObjects{};
+            gameObjects.reserve(objectCount);
+            for (uint32_t i = 0; i < objectCount; i++)
+            {
+                LveGameObject object = LveGameObject::createGameObject();
+                object._model = model;
+                object._transformComp._translation = {
+                    -1.f + spacing * (static_cast<float>(i % side) + .5f),
+                    -1.f + spacing * (static_cast<float>(i / side) + .5f),
+                    0.f};
+                object._transformComp._rotation = {0.f, 0.f, 0.01f * static_cast<float>(i)};
+                object._transformComp._scale = glm::vec3{.8f * spacing};
+                gameObjects.push_back(std::move(object));
+            }
+
+            for (const auto& [path, pathName] : paths)
+            {
+                renderSystem.setObjectDataPath(path);
+
+                std::vector<double> recordTimes{};
+                std::vector<double> gpuTimes{};
+
+                // Whether the frame index's last submission wrote timestamps that are to be measured.
+                std::array<bool, LveSwapChain::MAX_FRAMES_IN_FLIGHT> pendingQueries{};
+                auto readQueries = [&](int frameIndex)
+                {
+                    if (!pendingQueries[frameIndex])
+                    {
+                        return;
+                    }
+                    std::array<uint64_t, queriesPerFrame> ticks{};
+                    vkGetQueryPoolResults(
+                        device.device(),
+                        queryPool,
+                        queriesPerFrame * static_cast<uint32_t>(frameIndex),
+                        queriesPerFrame,
+                        sizeof(ticks),
+                        ticks.data(),
+                        sizeof(uint64_t),
+                        VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+                    gpuTimes.push_back(
+                        static_cast<double>(ticks[1] - ticks[0]) * device.properties.limits.timestampPeriod / 1e6);
+                    pendingQueries[frameIndex] = false;
+                };
+
+                for (uint32_t frame = 0; frame < warmupFrames + measuredFrames; frame++)
+                {
+                    glfwPollEvents();
+
+                    VkCommandBuffer commandBuffer = renderer.beginFrame();
+                    if (!commandBuffer)
+                    {
+                        continue;
+                    }
+                    int frameIndex = renderer.getFrameIndex();
+
+                    // beginFrame() waited for this frame index's previous submission.
+                    readQueries(frameIndex);
+                    frameAllocator.beginFrame(frameIndex);
+                    frameDescriptors[frameIndex]->reset();
+
+                    BenchmarkGlobalUbo ubo{};
+                    ubo.projectionView = camera.getProjection() * camera.getView();
+                    LveFrameAllocator::Slice uboSlice = frameAllocator.pushUniform(ubo);
+                    FrameInfo frameInfo{
+                        frameIndex,
+                        0.f,
+                        commandBuffer,
+                        camera,
+                        globalDescriptorSet,
+                        uboSlice.dynamicOffset(),
+                        frameAllocator,
+                        *frameDescriptors[frameIndex],
+                        descriptorCache};
+
+                    const uint32_t firstQuery = queriesPerFrame * static_cast<uint32_t>(frameIndex);
+                    if (timestamps)
+                    {
+                        vkCmdResetQueryPool(commandBuffer, queryPool, firstQuery, queriesPerFrame);
+                        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, firstQuery);
+                    }
+                    renderer.beginSwapChainRenderPass(commandBuffer);
+
+                    auto recordStart = Clock::now();
+                    renderSystem.renderGameObjects(frameInfo, gameObjects);
+                    double recordMs = millisecondsSince(recordStart);
+
+                    renderer.endSwapChainRenderPass(commandBuffer);
+                    if (timestamps)
+                    {
+                        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, firstQuery + 1);
+                    }
+                    frameAllocator.flush();
+                    renderer.endFrame();
+
+                    if (frame >= warmupFrames)
+                    {
+                        recordTimes.push_back(recordMs);
+                        pendingQueries[frameIndex] = timestamps;
+                    }
+                }
+                vkDeviceWaitIdle(device.device());
+                for (int frameIndex = 0; frameIndex < LveSwapChain::MAX_FRAMES_IN_FLIGHT; frameIndex++)
+                {
+                    readQueries(frameIndex);
+                }
+
+                std::sort(recordTimes.begin(), recordTimes.end());
+                std::sort(gpuTimes.begin(), gpuTimes.end());
+                std::cout << std::left << std::setw(10) << objectCount
+                          << std::setw(18) << pathName
+                          << std::right << std::fixed << std::setprecision(3)
+                          << std::setw(12) << recordTimes[recordTimes.size() / 2];
+                if (gpuTimes.empty())
+                {
+                    std::cout << std::setw(10) << "-";
+                }
+                else
+                {
+                    std::cout << std::setw(10) << gpuTimes[gpuTimes.size() / 2];
+                }
+                std::cout << std::setw(8) << renderSystem.getCullingStatistics().drawCalls << "\n";
+            }
+        }
+
+        if (queryPool != VK_NULL_HANDLE)
+        {
+            vkDestroyQueryPool(device.device(), queryPool, nullptr);
+        }
+    }
+
+    void benchmarkUpload(const std::string& modelDirectory, int runs)
+    {
+        LveWindow window{320, 240, "upload benchmark"};
+        LveDevice device{window};
+
+        const bool direct = device.supportsDirectUpload();
+        std::cout << device.properties.deviceName << ": "
+                  << (direct ? "direct uploads supported" : "no large DEVICE_LOCAL | HOST_VISIBLE heap, staging only")
+                  << "\n"
+                  << std::left << std::setw(24) << "model"
+                  << std::right << std::setw(12) << "bytes"
+                  << std::setw(14) << "staging ms"
+                  << std::setw(13) << "direct ms" << "\n";
+
+        for (const std::string& path : objFilesIn(modelDirectory))
+        {
+            LveModel::Builder builder{};
+            builder.parseObj(path);
+
+            // From creating the buffers until the GPU may read them.
+            auto load = [&](bool useDirect)
+            {
+                device.setDirectUploadEnabled(useDirect);
+                return medianMilliseconds(runs, [&]()
+                {
+                    auto uploadBatch = std::make_shared<LveUploadBatch>(device);
+                    LveModel model{device, builder, uploadBatch};
+                    uploadBatch->wait();
+                });
+            };
+
+            // A first load outside the timings creates the staging and device memory blocks.
+            device.setDirectUploadEnabled(false);
+            LveModel::Statistics statistics = LveModel{device, builder}.getStatistics();
+
+            double stagingMs = load(false);
+            double directMs = direct ? load(true) : 0.0;
+            device.setDirectUploadEnabled(true);
+
+            std::cout << std::left << std::setw(24) << std::filesystem::path(path).filename().string()
+                      << std::right << std::setw(12) << statistics.vertexBufferSize + statistics.indexBufferSize
+                      << std::fixed << std::setprecision(3)
+                      << std::setw(14) << stagingMs;
+            if (direct)
+            {
+                std::cout << std::setw(13) << directMs;
+            }
+            else
+            {
+                std::cout << std::setw(13) << "-";
+            }
+            std::cout << "\n";
+        }
+    }
+
+    void benchmarkFramePacing(uint32_t frameCount, uint64_t uploadSize)
+    {
+        const uint32_t warmupFrames = 60;
+        const uint32_t uploadSlots = LveSwapChain::MAX_FRAMES_IN_FLIGHT + 1;
+        const std::vector<char> uploadData(static_cast<size_t>(uploadSize), 1);
+
+        std::cout << frameCount << " frames, a " << uploadSize / 1024 << " KiB upload per frame\n"
+                  << std::left << std::setw(12) << "sync"
+                  << std::right << std::setw(10) << "mean ms"
+                  << std::setw(10) << "p50 ms"
+                  << std::setw(10) << "p99 ms"
+                  << std::setw(10) << "max ms"
+                  << std::setw(12) << "stddev ms"
+                  << std::setw(14) << "wait mean ms"
+                  << std::setw(13) << "wait max ms" << "\n";
+
+        for (bool timeline : {false, true})
+        {
+            LveWindow window{320, 240, "frame pacing benchmark"};
+            LveDevice device{window, timeline};
+            if (timeline && !device.usesTimelineSemaphores())
+            {
+                std::cout << std::left << std::setw(12) << "timeline" << "not supported by " << device.properties.deviceName << "\n";
+                continue;
+            }
+            LveRenderer renderer{window, device};
+
+            // Each upload gets its own destination, reused once the upload that last wrote it completed.
+            std::vector<std::unique_ptr<LveBuffer>> destinations{};
+            std::vector<std::unique_ptr<LveUploadBatch>> uploads(uploadSlots);
+            for (uint32_t i = 0; i < uploadSlots; i++)
+            {
+                destinations.push_back(std::make_unique<LveBuffer>(
+                    device,
+                    uploadSize,
+                    1,
+                    VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT));
+            }
+
+            std::vector<double> frameTimes{};
+            std::vector<double> waitTimes{};
+            auto frameStart = Clock::now();
+            for (uint32_t frame = 0; frame < warmupFrames + frameCount; frame++)
+            {
+                glfwPollEvents();
+
+                // A mid-frame upload that the frame does not wait for.
+                std::unique_ptr<LveUploadBatch>& upload = uploads[frame % uploadSlots];
+                upload.reset();
+                upload = std::make_unique<LveUploadBatch>(device);
+                upload->copy(uploadData.data(), uploadSize, destinations[frame % uploadSlots]->getBuffer());
+                upload->submit();
+
+                // Time blocked on the previous submission of this frame index.
+                auto waitStart = Clock::now();
+                VkCommandBuffer commandBuffer = renderer.beginFrame();
+                double waitMs = millisecondsSince(waitStart);
+                if (commandBuffer)
+                {
+                    renderer.beginSwapChainRenderPass(commandBuffer);
+                    renderer.endSwapChainRenderPass(commandBuffer);
+                    renderer.endFrame();
+                }
+
+                auto now = Clock::now();
+                if (frame >= warmupFrames)
+                {
+                    frameTimes.push_back(std::chrono::duration<double, std::milli>(now - frameStart).count());
+                    waitTimes.push_back(waitMs);
+                }
+                frameStart = now;
+            }
+            vkDeviceWaitIdle(device.device());
+            uploads.clear();
+
+            double mean = 0.0;
+            for (double ms : frameTimes)
+            {
+                mean += ms;
+            }
+            mean /= static_cast<double>(frameTimes.size());
+            double variance = 0.0;
+            for (double ms : frameTimes)
+            {
+                variance += (ms - mean) * (ms - mean);
+            }
+            variance /= static_cast<double>(frameTimes.size());
+            double waitMean = 0.0;
+            for (double ms : waitTimes)
+            {
+                waitMean += ms;
+            }
+            waitMean /= static_cast<double>(waitTimes.size());
+
+            std::vector<double> sorted = frameTimes;
+            std::sort(sorted.begin(), sorted.end());
+            std::cout << std::left << std::setw(12) << (timeline ? "timeline" : "fences")
+                      << std::right << std::fixed << std::setprecision(3)
+                      << std::setw(10) << mean
+                      << std::setw(10) << sorted[sorted.size() / 2]
+                      << std::setw(10) << sorted[sorted.size() * 99 / 100]
+                      << std::setw(10) << sorted.back()
+                      << std::setw(12) << std::sqrt(variance)
+                      << std::setw(14) << waitMean
+                      << std::setw(13) << *std::max_element(waitTimes.begin(), waitTimes.end()) << "\n";
+        }
+    }
+
+    void benchmarkDescriptorAllocator(uint32_t setCount)
+    {
+        const uint32_t frames = 100;
+        const uint32_t setsPerFrame = std::max(1u, setCount / frames);
+
+        LveWindow window{320, 240, "descriptor allocator benchmark"};
+        LveDevice device{window};
+        std::unique_ptr<LveDescriptorSetLayout> setLayout = LveDescriptorSetLayout::Builder(device)
+            .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT)
+            .build();
+        const VkDescriptorSetLayout layout = setLayout->getVkDescriptorSetLayout();
+        VkDescriptorSet set = VK_NULL_HANDLE;
+
+        // Growing from a small first pool.
+        {
+            std::unique_ptr<LveDescriptorAllocator> allocator = LveDescriptorAllocator::Builder(device)
+                .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.f)
+                .build();
+            auto start = Clock::now();
+            for (uint32_t i = 0; i < setCount; i++)
+            {
+                if (!allocator->allocateDescriptor(layout, set))
+                {
+                    throw std::runtime_error("failed to allocate descriptor set!");
+                }
+            }
+            double ms = millisecondsSince(start);
+            LveDescriptorAllocator::Statistics statistics = allocator->getStatistics();
+            std::cout << setCount << " sets from a growing allocator\n"
+                      << std::fixed << std::setprecision(3)
+                      << "  total          " << std::setw(10) << ms << " ms\n"
+                      << "  mean / max     " << std::setw(10) << statistics.meanAllocationMicroseconds
+                      << " / " << statistics.maxAllocationMicroseconds << " us\n"
+                      << "  pools in use   " << std::setw(10) << statistics.poolsInUse << "\n";
+        }
+
+        // Transient sets per frame: returned in bulk, or freed one by one.
+        std::cout << frames << " frames of " << setsPerFrame << " transient sets\n";
+        {
+            std::unique_ptr<LveDescriptorAllocator> allocator = LveDescriptorAllocator::Builder(device)
+                .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.f)
+                .build();
+            double ms = medianMilliseconds(static_cast<int>(frames), [&]()
+            {
+                allocator->reset();
+                for (uint32_t i = 0; i < setsPerFrame; i++)
+                {
+                    allocator->allocateDescriptor(layout, set);
+                }
+            });
+            LveDescriptorAllocator::Statistics statistics = allocator->getStatistics();
+            std::cout << std::fixed << std::setprecision(3)
+                      << "  reset pools    " << std::setw(10) << ms << " ms per frame, "
+                      << statistics.poolCount << " pools\n";
+        }
+        {
+            std::unique_ptr<LveDescriptorPool> pool = LveDescriptorPool::Builder(device)
+                .setMaxSets(setsPerFrame)
+                .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, setsPerFrame)
+                .setPoolFlags(VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT)
+                .build();
+            std::vector<VkDescriptorSet> sets(setsPerFrame);
+            std::vector<VkDescriptorSet> one(1);
+            double ms = medianMilliseconds(static_cast<int>(frames), [&]()
+            {
+                for (VkDescriptorSet& frameSet : sets)
+                {
+                    pool->allocateDescriptor(layout, frameSet);
+                }
+                for (VkDescriptorSet frameSet : sets)
+                {
+                    one[0] = frameSet;
+                    pool->freeDescriptors(one);
+                }
+            });
+            std::cout << std::fixed << std::setprecision(3)
+                      << "  free each set  " << std::setw(10) << ms << " ms per frame\n";
+        }
+    }
+
+    void benchmarkDescriptorCache(uint32_t buildCount, uint32_t distinctCount)
+    {
+        distinctCount = std::max(1u, distinctCount);
+
+        LveWindow window{320, 240, "descriptor cache benchmark"};
+        LveDevice device{window};
+        std::unique_ptr<LveDescriptorSetLayout> setLayout = LveDescriptorSetLayout::Builder(device)
+            .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
+            .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
+            .build();
+
+        // distinctCount material-like combinations of two buffers.
+        std::vector<std::unique_ptr<LveBuffer>> buffers{};
+        for (uint32_t i = 0; i < distinctCount + 1; i++)
+        {
+            buffers.push_back(std::make_unique<LveBuffer>(
+                device,
+                256,
+                1,
+                VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT));
+        }
+        std::vector<VkDescriptorBufferInfo> bufferInfos{};
+        for (const std::unique_ptr<LveBuffer>& buffer : buffers)
+        {
+            bufferInfos.push_back(buffer->descriptorInfo());
+        }
+
+        // Combination c writes buffers c and c + 1.
+        auto buildSets = [&](LveDescriptorWriter& writer, uint32_t build)
+        {
+            uint32_t c = build % distinctCount;
+            VkDescriptorSet set = VK_NULL_HANDLE;
+            writer.writeBuffer(0, &bufferInfos[c]).writeBuffer(1, &bufferInfos[c + 1]);
+            if (!writer.build(set))
+            {
+                throw std::runtime_error("failed to build descriptor set!");
+            }
+        };
+
+        std::cout << buildCount << " builds of " << distinctCount << " distinct sets\n";
+        {
+            std::unique_ptr<LveDescriptorAllocator> allocator = LveDescriptorAllocator::Builder(device)
+                .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1.f)
+                .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1.f)
+                .build();
+            auto start = Clock::now();
+            for (uint32_t i = 0; i < buildCount; i++)
+            {
+                LveDescriptorWriter writer{*setLayout, *allocator};
+                buildSets(writer, i);
+            }
+            double ms = millisecondsSince(start);
+            std::cout << std::fixed << std::setprecision(3)
+                      << "  allocate and update  " << std::setw(10) << ms << " ms, "
+                      << allocator->getStatistics().allocationCount << " sets\n";
+        }
+        {
+            std::unique_ptr<LveDescriptorAllocator> allocator = LveDescriptorAllocator::Builder(device)
+                .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1.f)
+                .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1.f)
+                .build();
+            LveDescriptorCache cache{device, *allocator};
+            auto start = Clock::now();
+            for (uint32_t i = 0; i < buildCount; i++)
+            {
+                LveDescriptorWriter writer{*setLayout, cache};
+                buildSets(writer, i);
+            }
+            double ms = millisecondsSince(start);
+            LveDescriptorCache::Statistics statistics = cache.getStatistics();
+            std::cout << std::fixed << std::setprecision(3)
+                      << "  cached               " << std::setw(10) << ms << " ms, "
+                      << statistics.setCount << " sets, hit rate " << statistics.hitRate << "\n";
+
+            // Buffer 1 is in combinations 0 and 1.
+            buffers[1].reset();
+            statistics = cache.getStatistics();
+            std::cout << "  after destroying one buffer: " << statistics.invalidatedCount << " invalidated, "
+                      << statistics.setCount << " sets, " << statistics.recycledSetCount << " to reuse\n";
+            cache.clear();
+        }
+    }
+
+    void benchmarkDescriptorUpdate(uint32_t updateCount)
+    {
+        const int runs = 9;
+
+        LveWindow window{320, 240, "descriptor update benchmark"};
+        LveDevice device{window};
+
+        LveBuffer uniformBuffer{device, 256, 64, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+            device.properties.limits.minUniformBufferOffsetAlignment};
+        LveBuffer storageBuffer{device, 256, 64, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+            device.properties.limits.minStorageBufferOffsetAlignment};
+
+        // Update i points both bindings at slot i % 64, like per-draw data.
+        std::vector<std::array<VkDescriptorBufferInfo, 2>> bufferInfos(64);
+        for (int i = 0; i < 64; i++)
+        {
+            bufferInfos[i] = {uniformBuffer.descriptorInfoForIndex(i), storageBuffer.descriptorInfoForIndex(i)};
+        }
+
+        auto report = [&](const char *name, double ms)
+        {
+            std::cout << std::fixed << std::setprecision(3)
+                      << "  " << std::left << std::setw(22) << name << std::right << std::setw(10) << ms << " ms, "
+                      << std::setw(8) << ms * 1e6 / updateCount << " ns per update\n";
+        };
+
+        std::cout << updateCount << " updates of a uniform and a storage buffer binding"
+                  << (device.supportsUpdateTemplates() ? "" : ", update templates emulated") << "\n";
+        {
+            std::unique_ptr<LveDescriptorSetLayout> setLayout = LveDescriptorSetLayout::Builder(device)
+                .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
+                .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
+                .build();
+            std::unique_ptr<LveDescriptorAllocator> allocator = LveDescriptorAllocator::Builder(device)
+                .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1.f)
+                .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1.f)
+                .build();
+
+            report("allocate and write", medianMilliseconds(runs, [&]()
+            {
+                allocator->reset();
+                for (uint32_t i = 0; i < updateCount; i++)
+                {
+                    std::array<VkDescriptorBufferInfo, 2>& infos = bufferInfos[i % 64];
+                    VkDescriptorSet set = VK_NULL_HANDLE;
+                    LveDescriptorWriter{*setLayout, *allocator}
+                        .writeBuffer(0, &infos[0])
+                        .writeBuffer(1, &infos[1])
+                        .build(set);
+                }
+            }));
+
+            allocator->reset();
+            VkDescriptorSet set = VK_NULL_HANDLE;
+            if (!allocator->allocateDescriptor(setLayout->getVkDescriptorSetLayout(), set))
+            {
+                throw std::runtime_error("failed to allocate descriptor set!");
+            }
+            report("writer overwrite", medianMilliseconds(runs, [&]()
+            {
+                for (uint32_t i = 0; i < updateCount; i++)
+                {
+                    std::array<VkDescriptorBufferInfo, 2>& infos = bufferInfos[i % 64];
+                    LveDescriptorWriter{*setLayout}
+                        .writeBuffer(0, &infos[0])
+                        .writeBuffer(1, &infos[1])
+                        .overwrite(set);
+                }
+            }));
+
+            // Bindings 0 and 1 are adjacent in the template's data, as in bufferInfos.
+            std::unique_ptr<LveDescriptorUpdateTemplate> updateTemplate = setLayout->createUpdateTemplate();
+            report("update template", medianMilliseconds(runs, [&]()
+            {
+                for (uint32_t i = 0; i < updateCount; i++)
+                {
+                    updateTemplate->update(set, bufferInfos[i % 64].data());
+                }
+            }));
+        }
+
+        if (!device.supportsPushDescriptors())
+        {
+            std::cout << "  push descriptors are not supported\n";
+            return;
+        }
+
+        std::unique_ptr<LveDescriptorSetLayout> pushSetLayout = LveDescriptorSetLayout::Builder(device)
+            .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
+            .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
+            .setLayoutFlags(VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR)
+            .build();
+        VkDescriptorSetLayout vkPushSetLayout = pushSetLayout->getVkDescriptorSetLayout();
+        VkPipelineLayoutCreateInfo pipelineLayoutCI{};
+        pipelineLayoutCI.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutCI.setLayoutCount = 1;
+        pipelineLayoutCI.pSetLayouts = &vkPushSetLayout;
+        VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+        if (vkCreatePipelineLayout(device.device(), &pipelineLayoutCI, nullptr, &pipelineLayout) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create pipeline layout!");
+        }
+        std::unique_ptr<LveDescriptorUpdateTemplate> pushTemplate = pushSetLayout->createUpdateTemplate(pipelineLayout, 0);
+
+        // Every run records into the same command buffer, which is submitted once at the end.
+        VkCommandBuffer commandBuffer = device.beginSingleTimeCommands();
+        report("writer push", medianMilliseconds(runs, [&]()
+        {
+            for (uint32_t i = 0; i < updateCount; i++)
+            {
+                std::array<VkDescriptorBufferInfo, 2>& infos = bufferInfos[i % 64];
+                LveDescriptorWriter{*pushSetLayout}
+                    .writeBuffer(0, &infos[0])
+                    .writeBuffer(1, &infos[1])
+                    .push(commandBuffer, pipelineLayout, 0);
+            }
+        }));
+        report("push template", medianMilliseconds(runs, [&]()
+        {
+            for (uint32_t i = 0; i < updateCount; i++)
+            {
+                pushTemplate->push(commandBuffer, bufferInfos[i % 64].data());
+            }
+        }));
+        device.endSingleTimeCommands(commandBuffer);
+
+        pushTemplate.reset();
+        vkDestroyPipelineLayout(device.device(), pipelineLayout, nullptr);
+    }
+
+    void benchmarkPipelineCache(const std::string& cachePath)
+    {
+        std::remove(cachePath.c_str());
+
+        std::cout << std::left << std::setw(8) << "cache"
+                  << std::setw(10) << "loaded"
+                  << std::right << std::setw(14) << "pipelines ms" << "\n";
+        for (const char *run : {"cold", "warm"})
+        {
+            LveWindow window{320, 240, "pipeline cache benchmark"};
+            LveDevice device{window, true, cachePath};
+            LveRenderer renderer{window, device};
+            std::unique_ptr<LveDescriptorSetLayout> globalSetLayout = LveDescriptorSetLayout::Builder(device)
+                .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT)
+                .build();
+            std::unique_ptr<LveBindlessDescriptors> bindlessDescriptors{};
+            if (device.supportsBindless())
+            {
+                bindlessDescriptors = std::make_unique<LveBindlessDescriptors>(device);
+            }
+
+            // Every object data path's pipelines for every vertex layout, including reading the shaders.
+            auto start = Clock::now();
+            {
+                SimpleRenderSystem simpleRenderSystem{
+                    device,
+                    renderer.getSwapChainRenderPass(),
+                    globalSetLayout->getVkDescriptorSetLayout(),
+                    bindlessDescriptors.get()};
+            }
+            double ms = millisecondsSince(start);
+
+            std::cout << std::left << std::setw(8) << run
+                      << std::setw(10) << (device.pipelineCacheLoaded() ? "yes" : "no")
+                      << std::right << std::fixed << std::setprecision(3) << std::setw(14) << ms << "\n";
+        }
+        std::remove(cachePath.c_str());
+    }
+}
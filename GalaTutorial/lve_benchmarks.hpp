@@ -0,0 +1,84 @@
+#ifndef lve_benchmarks_hpp
+#define lve_benchmarks_hpp
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace lve
+{
+    // Runs the benchmark named by args[0], passing it the remaining arguments.
+    // Throws if the name is unknown.
+    void runBenchmark(const std::vector<std::string>& args);
+
+    // Cold (parse .obj and write cache) versus warm (map cache) load time of every .obj file in modelDirectory.
+    void benchmarkMeshCache(const std::string& modelDirectory);
+
+    // Parallel .obj parse time for 1..maxThreads threads, checked against the serial tinyobj result.
+    // maxThreads 0 uses std::thread::hardware_concurrency().
+    void benchmarkObjParse(const std::string& modelDirectory, unsigned maxThreads);
+
+    // Vertex deduplication over every face corner of each model: std::unordered_map with count() and
+    // operator[] (the old loader), std::unordered_map with emplace(), and LveVertexWeldTable. Also
+    // reports how many vertices remain after welding positions within weldEpsilon.
+    void benchmarkWeld(const std::string& modelDirectory, float weldEpsilon);
+
+    // ACMR and ATVR of each model after each LveMeshOptimizer pass, and the time each pass takes.
+    void benchmarkMeshOptimize(const std::string& modelDirectory);
+
+    // Vertex buffer size, bytes fetched per draw, encode time and worst case encoding error of each
+    // LveModel::VertexLayout.
+    void benchmarkVertexFormat(const std::string& modelDirectory);
+
+    // Triangle count and error of every level of detail LveModel::Builder::buildLods() produces for
+    // each model, with up to LveModel::MAX_LOD_COUNT levels, and the time it takes.
+    void benchmarkLod(const std::string& modelDirectory);
+
+    // Meshlets built for each model, and the share of triangles meshlet frustum and cone culling
+    // rejects from cameras around it, next to the share of triangles that face away from the camera.
+    void benchmarkMeshlets(const std::string& modelDirectory);
+
+    // Frames of 100, 1000, ... up to maxObjects quads drawn by SimpleRenderSystem on a real device,
+    // with ObjectDataPath::PushConstants and ObjectDataPath::DynamicUniform: the CPU time
+    // renderGameObjects() takes to record them, and the GPU time of the render pass from
+    // timestamp queries where the graphics queue supports them.
+    void benchmarkObjectData(uint32_t maxObjects);
+
+    // Time from creating a model's buffers until the GPU may read them, median of runs loads, for
+    // each .obj file in modelDirectory: through staging memory and an upload batch, and written
+    // directly into DEVICE_LOCAL | HOST_VISIBLE memory where the device has a large enough heap of it.
+    // Opens a window to get a device. For the software driver, run with VK_ICD_FILENAMES set to
+    // lavapipe's ICD file; it exposes only host visible memory, so it takes the direct path.
+    void benchmarkUpload(const std::string& modelDirectory, int runs);
+
+    // Frame times over frameCount frames of an empty render pass, each frame also submitting an
+    // uploadSize byte upload it does not wait for, with every submission synchronized by fences and
+    // then by timeline semaphores. Also the time beginFrame() blocks. Opens a window.
+    void benchmarkFramePacing(uint32_t frameCount, uint64_t uploadSize);
+
+    // Allocation latency and pools in use when setCount sets come from an LveDescriptorAllocator
+    // that starts with a small pool, and the time per frame for transient sets over 100 frames:
+    // allocated from a per-frame allocator that is reset, and from one pool and freed one by one.
+    // Opens a window to get a device.
+    void benchmarkDescriptorAllocator(uint32_t setCount);
+
+    // buildCount descriptor set builds cycling through distinctCount combinations of two buffers,
+    // allocated and updated every time and through an LveDescriptorCache, with the cache's hit rate
+    // and the entries dropped when one of the buffers is destroyed. Opens a window to get a device.
+    void benchmarkDescriptorCache(uint32_t buildCount, uint32_t distinctCount);
+
+    // CPU time of updateCount updates of a two buffer set: allocated and written by
+    // LveDescriptorWriter, rewritten by it and by an update template, and pushed into a command
+    // buffer by it and by a push template where push descriptors are supported. Opens a window to
+    // get a device.
+    void benchmarkDescriptorUpdate(uint32_t updateCount);
+
+    // Time to create SimpleRenderSystem's pipelines with an empty pipeline cache, after deleting
+    // cachePath, and again with the cache the first device saved to cachePath. Drivers with their own
+    // shader cache make the cold run faster than a first launch. Opens a window.
+    void benchmarkPipelineCache(const std::string& cachePath);
+}
+
+#endif /* lve_benchmarks_hpp */
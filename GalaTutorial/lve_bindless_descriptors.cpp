@@ -0,0 +1,158 @@
+#include "lve_bindless_descriptors.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace lve
+{
+    LveBindlessDescriptors::LveBindlessDescriptors(
+        LveDevice& device,
+        uint32_t storageBufferCapacity,
+        uint32_t textureCapacity)
+    :   _lveDevice{device}
+    {
+        if (!device.supportsBindless())
+        {
+            throw std::runtime_error("failed to create bindless descriptors, descriptor indexing is not supported!");
+        }
+
+        // Both arrays are read from one stage each, so the per stage limits apply as well.
+        const VkPhysicalDeviceDescriptorIndexingProperties& limits = device.descriptorIndexingProperties;
+        _storageBuffers.capacity = std::min({
+            storageBufferCapacity,
+            limits.maxPerStageDescriptorUpdateAfterBindStorageBuffers,
+            limits.maxDescriptorSetUpdateAfterBindStorageBuffers});
+        const uint32_t maxTextures = std::min({
+            MAX_TEXTURE_CAPACITY,
+            limits.maxPerStageDescriptorUpdateAfterBindSampledImages,
+            limits.maxPerStageDescriptorUpdateAfterBindSamplers,
+            limits.maxDescriptorSetUpdateAfterBindSampledImages,
+            limits.maxDescriptorSetUpdateAfterBindSamplers});
+        _textures.capacity = std::min(textureCapacity, maxTextures);
+
+        const VkDescriptorBindingFlags bindingFlags =
+            VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+            VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+            VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+
+        _setLayout = LveDescriptorSetLayout::Builder(device)
+            .addBinding(
+                STORAGE_BUFFER_BINDING,
+                VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                VK_SHADER_STAGE_VERTEX_BIT,
+                _storageBuffers.capacity,
+                bindingFlags)
+            .addBinding(
+                TEXTURE_BINDING,
+                VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                VK_SHADER_STAGE_FRAGMENT_BIT,
+                maxTextures,
+                bindingFlags | VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT)
+            .setLayoutFlags(VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT)
+            .build();
+
+        _pool = LveDescriptorPool::Builder(device)
+            .setMaxSets(1)
+            .setPoolFlags(VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT)
+            .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, _storageBuffers.capacity)
+            .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, _textures.capacity)
+            .build();
+
+        if (!_pool->allocateDescriptor(_setLayout->getVkDescriptorSetLayout(), _set, _textures.capacity))
+        {
+            throw std::runtime_error("failed to allocate bindless descriptor set!");
+        }
+    }
+
+    uint32_t LveBindlessDescriptors::addStorageBuffer(const VkDescriptorBufferInfo& bufferInfo)
+    {
+        uint32_t index = allocateIndex(_storageBuffers);
+        updateStorageBuffer(index, bufferInfo);
+        return index;
+    }
+
+    void LveBindlessDescriptors::updateStorageBuffer(uint32_t index, const VkDescriptorBufferInfo& bufferInfo)
+    {
+        assert(index < _storageBuffers.next && "Storage buffer index was not handed out");
+        LveDescriptorWriter{*_setLayout, *_pool}
+            .writeBuffers(STORAGE_BUFFER_BINDING, index, 1, &bufferInfo)
+            .overwrite(_set);
+    }
+
+    void LveBindlessDescriptors::releaseStorageBuffer(uint32_t index)
+    {
+        release(STORAGE_BUFFER_BINDING, index);
+    }
+
+    uint32_t LveBindlessDescriptors::addTexture(const VkDescriptorImageInfo& imageInfo)
+    {
+        uint32_t index = allocateIndex(_textures);
+        LveDescriptorWriter{*_setLayout, *_pool}
+            .writeImages(TEXTURE_BINDING, index, 1, &imageInfo)
+            .overwrite(_set);
+        return index;
+    }
+
+    void LveBindlessDescriptors::releaseTexture(uint32_t index)
+    {
+        release(TEXTURE_BINDING, index);
+    }
+
+    VkDescriptorSetLayout LveBindlessDescriptors::getSetLayout() const
+    {
+        return _setLayout->getVkDescriptorSetLayout();
+    }
+
+    VkDescriptorSet LveBindlessDescriptors::getSet() const
+    {
+        return _set;
+    }
+
+    uint32_t LveBindlessDescriptors::getStorageBufferCapacity() const
+    {
+        return _storageBuffers.capacity;
+    }
+
+    uint32_t LveBindlessDescriptors::getTextureCapacity() const
+    {
+        return _textures.capacity;
+    }
+
+    uint32_t LveBindlessDescriptors::allocateIndex(IndexRange& range)
+    {
+        reclaim();
+        if (!range.free.empty())
+        {
+            uint32_t index = range.free.back();
+            range.free.pop_back();
+            return index;
+        }
+        if (range.next == range.capacity)
+        {
+            throw std::runtime_error("failed to allocate bindless descriptor, the array is full!");
+        }
+        return range.next++;
+    }
+
+    void LveBindlessDescriptors::release(uint32_t binding, uint32_t index)
+    {
+        if (index == INVALID_INDEX)
+        {
+            return;
+        }
+        _pendingReleases.push_back({_lveDevice.lastSubmission(), binding, index});
+    }
+
+    void LveBindlessDescriptors::reclaim()
+    {
+        while (!_pendingReleases.empty() && _lveDevice.isComplete(_pendingReleases.front().submission))
+        {
+            const PendingRelease& pending = _pendingReleases.front();
+            IndexRange& range = pending.binding == STORAGE_BUFFER_BINDING ? _storageBuffers : _textures;
+            range.free.push_back(pending.index);
+            _pendingReleases.pop_front();
+        }
+    }
+}
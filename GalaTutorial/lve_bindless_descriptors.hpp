@@ -0,0 +1,109 @@
+#ifndef lve_bindless_descriptors_hpp
+#define lve_bindless_descriptors_hpp
+
+#pragma once
+
+#include "lve_descriptors.hpp"
+#include "lve_device.hpp"
+
+// std
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+namespace lve
+{
+    // One update-after-bind descriptor set holding the storage buffers and textures of the whole
+    // scene in two partially bound arrays, which shaders index with the indices handed out here:
+    //
+    //   binding 0: buffer[]  STORAGE_BUFFER, e.g. per-object data
+    //   binding 1: sampler[] COMBINED_IMAGE_SAMPLER, the variable count binding
+    //
+    // The set is bound once per frame. Descriptors are written as soon as a resource is added, also
+    // while pending command buffers use the set; they only read the elements they are given indices
+    // of. A released index is handed out again once the submissions that may still read it completed.
+    //
+    // Needs LveDevice::supportsBindless(). Render thread only.
+    class LveBindlessDescriptors
+    {
+        public:
+
+        static constexpr uint32_t STORAGE_BUFFER_BINDING = 0;
+        static constexpr uint32_t TEXTURE_BINDING = 1;
+
+        // Never handed out; shaders read it as "no resource".
+        static constexpr uint32_t INVALID_INDEX = ~0u;
+
+        static constexpr uint32_t DEFAULT_STORAGE_BUFFER_CAPACITY = 1024;
+        static constexpr uint32_t DEFAULT_TEXTURE_CAPACITY = 4096;
+
+        // Most textures the layout admits; each set is allocated with textureCapacity of them.
+        static constexpr uint32_t MAX_TEXTURE_CAPACITY = 64 * 1024;
+
+        // Capacities are lowered to the device's update-after-bind limits.
+        LveBindlessDescriptors(
+            LveDevice& device,
+            uint32_t storageBufferCapacity = DEFAULT_STORAGE_BUFFER_CAPACITY,
+            uint32_t textureCapacity = DEFAULT_TEXTURE_CAPACITY);
+
+        LveBindlessDescriptors(const LveBindlessDescriptors&) = delete;
+        LveBindlessDescriptors& operator=(const LveBindlessDescriptors&) = delete;
+
+        // Index of the buffer in binding 0.
+        uint32_t addStorageBuffer(const VkDescriptorBufferInfo& bufferInfo);
+
+        // Points index at another buffer; pending command buffers indexing it must not be affected.
+        void updateStorageBuffer(uint32_t index, const VkDescriptorBufferInfo& bufferInfo);
+
+        // The index may still be read by submissions made so far.
+        void releaseStorageBuffer(uint32_t index);
+
+        // Index of the texture in binding 1.
+        uint32_t addTexture(const VkDescriptorImageInfo& imageInfo);
+
+        void releaseTexture(uint32_t index);
+
+        VkDescriptorSetLayout getSetLayout() const;
+        VkDescriptorSet getSet() const;
+
+        uint32_t getStorageBufferCapacity() const;
+        uint32_t getTextureCapacity() const;
+
+        private:
+
+        // Indices of one binding: never used ones from next on, and released ones.
+        struct IndexRange
+        {
+            uint32_t              capacity = 0;
+            uint32_t              next = 0;
+            std::vector<uint32_t> free{};
+        };
+
+        struct PendingRelease
+        {
+            LveSubmission submission{};
+            uint32_t      binding = 0;
+            uint32_t      index = 0;
+        };
+
+        uint32_t allocateIndex(IndexRange& range);
+        void release(uint32_t binding, uint32_t index);
+
+        // Frees the released indices whose submissions have completed.
+        void reclaim();
+
+        LveDevice&                              _lveDevice;
+        IndexRange                              _storageBuffers{};
+        IndexRange                              _textures{};
+
+        // Oldest first.
+        std::deque<PendingRelease>              _pendingReleases{};
+
+        std::unique_ptr<LveDescriptorSetLayout> _setLayout;
+        std::unique_ptr<LveDescriptorPool>      _pool;
+        VkDescriptorSet                         _set = VK_NULL_HANDLE;
+    };
+}
+
+#endif /* lve_bindless_descriptors_hpp */
@@ -8,6 +8,7 @@
 #include "lve_buffer.hpp"
  
 // std
+#include <algorithm>
 #include <cassert>
 #include <cstring>
  
@@ -39,7 +40,8 @@ LveBuffer::LveBuffer(
     uint32_t instanceCount,
     VkBufferUsageFlags usageFlags,
     VkMemoryPropertyFlags memoryPropertyFlags,
-    VkDeviceSize minOffsetAlignment
+    VkDeviceSize minOffsetAlignment,
+    LveMemoryCategory category
 ):  
     _lveDevice{device},
     _instanceSize{instanceSize},
@@ -49,51 +51,59 @@ LveBuffer::LveBuffer(
 {
     _alignmentSize = getAlignment(instanceSize, minOffsetAlignment);
     _bufferSize = _alignmentSize * instanceCount;
-    device.createBuffer(_bufferSize, usageFlags, memoryPropertyFlags, _buffer, _memory);
+    device.createBuffer(_bufferSize, usageFlags, memoryPropertyFlags, _buffer, _allocation, category);
+    _memoryPropertyFlags = device.memoryAllocator().getMemoryTypeFlags(_allocation.memoryType);
 }
  
 LveBuffer::~LveBuffer()
 {
     unmap();
+    _lveDevice.notifyDestroyed(LveDevice::handleValue(_buffer));
     vkDestroyBuffer(_lveDevice.device(), _buffer, nullptr);
-    vkFreeMemory(_lveDevice.device(), _memory, nullptr);
+    _lveDevice.memoryAllocator().free(_allocation);
 }
  
 /**
  * Map a memory range of this buffer. If successful, mapped points to the specified buffer range.
  *
+ * @note Host visible memory blocks stay mapped by LveMemoryAllocator, so this only computes the
+ * address; other buffers share the block's VkDeviceMemory and its single mapping.
+ *
  * @param size (Optional) Size of the memory range to map. Pass VK_WHOLE_SIZE to map the complete
  * buffer range.
  * @param offset (Optional) Byte offset from beginning
  *
- * @return VkResult of the buffer mapping call
+ * @return VK_ERROR_MEMORY_MAP_FAILED if the buffer's memory is not host visible
  */
 VkResult LveBuffer::map(VkDeviceSize size, VkDeviceSize offset)
 {
-    assert(_buffer && _memory && "Called map on buffer before create");
-    return vkMapMemory(_lveDevice.device(), _memory, offset, size, 0, &_mapped);
+    assert(_buffer && _allocation.memory && "Called map on buffer before create");
+    if (_allocation.mapped == nullptr)
+    {
+        return VK_ERROR_MEMORY_MAP_FAILED;
+    }
+    _mapped = static_cast<char*>(_allocation.mapped) + offset;
+    return VK_SUCCESS;
 }
  
 /**
  * Unmap a mapped memory range
  *
- * @note Does not return a result as vkUnmapMemory can't fail
+ * @note The block stays mapped; only this buffer's pointer is reset.
  */
 void LveBuffer::unmap()
 {
-    if (_mapped)
-    {
-        vkUnmapMemory(_lveDevice.device(), _memory);
-        _mapped = nullptr;
-    }
+    _mapped = nullptr;
 }
  
 /**
  * Copies the specified data to the mapped buffer. Default value writes whole buffer range
  *
+ * @note On non-coherent memory the written range is recorded for flushDirty()
+ *
  * @param data Pointer to the data to copy
- * @param size (Optional) Size of the data to copy. Pass VK_WHOLE_SIZE to flush the complete buffer
- * range.
+ * @param size (Optional) Size of the data to copy. Pass VK_WHOLE_SIZE to write from offset to the
+ * end of the buffer.
  * @param offset (Optional) Byte offset from beginning of mapped region
  *
  */
@@ -106,21 +116,20 @@ void LveBuffer::writeToBuffer(
 
     if (size == VK_WHOLE_SIZE)
     {
-        // memcpy is (dest, src, count)
-        memcpy(_mapped, data, _bufferSize);
-    }
-    else
-    {
-        char *memOffset = (char *)_mapped;
-        memOffset += offset;
-        memcpy(memOffset, data, size);
+        size = _bufferSize - offset;
     }
+    assert(offset + size <= _bufferSize && "Write past the end of the buffer");
+
+    // memcpy is (dest, src, count)
+    memcpy(static_cast<char*>(_mapped) + offset, data, size);
+    markDirty(size, offset);
 }
  
 /**
  * Flush a memory range of the buffer to make it visible to the device
  *
- * @note Only required for non-coherent memory
+ * @note Only required for non-coherent memory; returns VK_SUCCESS without a call on coherent memory.
+ * Dirty ranges within the flushed range are no longer flushed by flushDirty().
  *
  * @param size (Optional) Size of the memory range to flush. Pass VK_WHOLE_SIZE to flush the
  * complete buffer range.
@@ -130,18 +139,41 @@ void LveBuffer::writeToBuffer(
  */
 VkResult LveBuffer::flush(VkDeviceSize size, VkDeviceSize offset)
 {
-    VkMappedMemoryRange mappedRange = {};
-    mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-    mappedRange.memory = _memory;
-    mappedRange.offset = offset;
-    mappedRange.size = size;
-    return vkFlushMappedMemoryRanges(_lveDevice.device(), 1, &mappedRange);
+    if (isCoherent())
+    {
+        return VK_SUCCESS;
+    }
+    VkMappedMemoryRange range = mappedRange(size, offset);
+    clearDirty(range.offset, range.offset + range.size);
+    return vkFlushMappedMemoryRanges(_lveDevice.device(), 1, &range);
+}
+ 
+/**
+ * Flush the ranges written by writeToBuffer() and writeToIndex() since the last flush, widened to
+ * nonCoherentAtomSize, in one call
+ *
+ * @note Writes through getMappedMemory() are not tracked; flush those with flush().
+ *
+ * @return VkResult of the flush call, VK_SUCCESS if nothing was written or the memory is coherent
+ */
+VkResult LveBuffer::flushDirty()
+{
+    if (_dirtyRanges.empty())
+    {
+        return VK_SUCCESS;
+    }
+    VkResult result = vkFlushMappedMemoryRanges(
+        _lveDevice.device(),
+        static_cast<uint32_t>(_dirtyRanges.size()),
+        _dirtyRanges.data());
+    _dirtyRanges.clear();
+    return result;
 }
  
 /**
  * Invalidate a memory range of the buffer to make it visible to the host
  *
- * @note Only required for non-coherent memory
+ * @note Only required for non-coherent memory; returns VK_SUCCESS without a call on coherent memory.
  *
  * @param size (Optional) Size of the memory range to invalidate. Pass VK_WHOLE_SIZE to invalidate
  * the complete buffer range.
@@ -151,12 +183,121 @@ VkResult LveBuffer::flush(VkDeviceSize size, VkDeviceSize offset)
  */
 VkResult LveBuffer::invalidate(VkDeviceSize size, VkDeviceSize offset)
 {
+    if (isCoherent())
+    {
+        return VK_SUCCESS;
+    }
+    VkMappedMemoryRange range = mappedRange(size, offset);
+    return vkInvalidateMappedMemoryRanges(_lveDevice.device(), 1, &range);
+}
+ 
+/**
+ * Translates a range of this buffer to a range of its memory block for flush and invalidate
+ *
+ * @note The block is shared, so VK_WHOLE_SIZE is limited to this buffer's allocation. Both ends are
+ * widened to multiples of nonCoherentAtomSize, without leaving the allocation: allocations from
+ * blocks start and end on such multiples, dedicated ones end with their memory.
+ *
+ * @param size Size of the range in the buffer. VK_WHOLE_SIZE reaches to the end of the buffer.
+ * @param offset Byte offset from beginning of the buffer
+ *
+ * @return VkMappedMemoryRange for the range
+ */
+VkMappedMemoryRange LveBuffer::mappedRange(VkDeviceSize size, VkDeviceSize offset)
+{
+    const VkDeviceSize atomSize = _lveDevice.properties.limits.nonCoherentAtomSize;
+    const VkDeviceSize allocationEnd = _allocation.offset + _allocation.size;
+    VkDeviceSize begin = _allocation.offset + offset;
+    VkDeviceSize end = size == VK_WHOLE_SIZE ? allocationEnd : begin + size;
+    begin -= begin % atomSize;
+    end = std::min((end + atomSize - 1) / atomSize * atomSize, allocationEnd);
+
     VkMappedMemoryRange mappedRange = {};
     mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-    mappedRange.memory = _memory;
-    mappedRange.offset = offset;
-    mappedRange.size = size;
-    return vkInvalidateMappedMemoryRanges(_lveDevice.device(), 1, &mappedRange);
+    mappedRange.memory = _allocation.memory;
+    mappedRange.offset = begin;
+    mappedRange.size = end - begin;
+    return mappedRange;
+}
+ 
+/**
+ * Remove [begin, end) from the dirty ranges, trimming or splitting the ones it partly covers
+ *
+ * @param begin Memory block offset, a multiple of nonCoherentAtomSize
+ * @param end Memory block offset, a multiple of nonCoherentAtomSize or the end of the allocation
+ */
+void LveBuffer::clearDirty(VkDeviceSize begin, VkDeviceSize end)
+{
+    std::vector<VkMappedMemoryRange> remaining{};
+    remaining.reserve(_dirtyRanges.size() + 1);
+    for (const VkMappedMemoryRange& dirty : _dirtyRanges)
+    {
+        const VkDeviceSize dirtyEnd = dirty.offset + dirty.size;
+        if (dirtyEnd <= begin || dirty.offset >= end)
+        {
+            remaining.push_back(dirty);
+            continue;
+        }
+        if (dirty.offset < begin)
+        {
+            VkMappedMemoryRange before = dirty;
+            before.size = begin - dirty.offset;
+            remaining.push_back(before);
+        }
+        if (dirtyEnd > end)
+        {
+            VkMappedMemoryRange after = dirty;
+            after.offset = end;
+            after.size = dirtyEnd - end;
+            remaining.push_back(after);
+        }
+    }
+    _dirtyRanges = std::move(remaining);
+}
+ 
+/**
+ * Record a written range of the buffer for flushDirty(), merging it with the ranges it overlaps or
+ * touches once widened to nonCoherentAtomSize
+ *
+ * @note Nothing is recorded for coherent memory
+ *
+ * @param size Size of the written range
+ * @param offset Byte offset from beginning of the buffer
+ */
+void LveBuffer::markDirty(VkDeviceSize size, VkDeviceSize offset)
+{
+    if (isCoherent() || size == 0)
+    {
+        return;
+    }
+    VkMappedMemoryRange range = mappedRange(size, offset);
+    VkDeviceSize begin = range.offset;
+    VkDeviceSize end = range.offset + range.size;
+
+    // First range that ends at or after begin; it and the ones after it that start at or before end merge.
+    auto first = std::lower_bound(
+        _dirtyRanges.begin(),
+        _dirtyRanges.end(),
+        begin,
+        [](const VkMappedMemoryRange& r, VkDeviceSize value) { return r.offset + r.size < value; });
+    auto last = first;
+    while (last != _dirtyRanges.end() && last->offset <= end)
+    {
+        begin = std::min(begin, last->offset);
+        end = std::max(end, last->offset + last->size);
+        last++;
+    }
+    range.offset = begin;
+    range.size = end - begin;
+    if (first == last)
+    {
+        _dirtyRanges.insert(first, range);
+    }
+    else
+    {
+        *first = range;
+        _dirtyRanges.erase(first + 1, last);
+    }
 }
  
 /**
@@ -243,7 +384,7 @@ VkDeviceSize LveBuffer::getInstanceSize() const
 
 VkDeviceSize LveBuffer::getAlignmentSize() const
 {
-    return _instanceSize;
+    return _alignmentSize;
 }
 
 VkBufferUsageFlags LveBuffer::getUsageFlags() const
@@ -260,5 +401,10 @@ VkDeviceSize LveBuffer::getBufferSize() const
 {
     return _bufferSize;
 }
+
+bool LveBuffer::isCoherent() const
+{
+    return (_memoryPropertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+}
  
 }  // namespace lve
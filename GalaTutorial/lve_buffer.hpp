@@ -4,6 +4,9 @@
 #pragma once
  
 #include "lve_device.hpp"
+
+// std
+#include <vector>
  
 namespace lve {
  
@@ -17,7 +20,8 @@ namespace lve {
             uint32_t instanceCount,
             VkBufferUsageFlags usageFlags,
             VkMemoryPropertyFlags memoryPropertyFlags,
-            VkDeviceSize minOffsetAlignment = 1);
+            VkDeviceSize minOffsetAlignment = 1,
+            LveMemoryCategory category = LveMemoryCategory::Other);
         
         ~LveBuffer();
 
@@ -38,6 +42,8 @@ namespace lve {
             VkDeviceSize size = VK_WHOLE_SIZE,
             VkDeviceSize offset = 0);
         
+        VkResult flushDirty();
+        
         VkDescriptorBufferInfo descriptorInfo(
             VkDeviceSize size = VK_WHOLE_SIZE,
             VkDeviceSize offset = 0);
@@ -68,24 +74,41 @@ namespace lve {
         
         VkMemoryPropertyFlags getMemoryPropertyFlags() const;
         VkDeviceSize getBufferSize() const;
+        
+        bool isCoherent() const;
 
         private:
         
         static VkDeviceSize getAlignment(
             VkDeviceSize instanceSize,
             VkDeviceSize minOffsetAlignment);
+        
+        // Range of the memory block for size bytes at offset, widened to nonCoherentAtomSize.
+        VkMappedMemoryRange mappedRange(VkDeviceSize size, VkDeviceSize offset);
+        
+        // Adds the atom aligned range of size bytes at offset to _dirtyRanges.
+        void markDirty(VkDeviceSize size, VkDeviceSize offset);
+        
+        // Removes the memory block range [begin, end) from _dirtyRanges.
+        void clearDirty(VkDeviceSize begin, VkDeviceSize end);
 
         LveDevice&              _lveDevice;
         void*                   _mapped = nullptr;
         VkBuffer                _buffer = VK_NULL_HANDLE;
-        VkDeviceMemory          _memory = VK_NULL_HANDLE;
+        LveAllocation           _allocation{};
 
         VkDeviceSize            _bufferSize;
         uint32_t                _instanceCount;
         VkDeviceSize            _instanceSize;
         VkDeviceSize            _alignmentSize;
         VkBufferUsageFlags      _usageFlags;
+        
+        // Flags of the memory type the buffer got, which may have more than were asked for.
         VkMemoryPropertyFlags   _memoryPropertyFlags;
+        
+        // Written and not yet flushed ranges of non-coherent memory, in memory block offsets,
+        // sorted and disjoint.
+        std::vector<VkMappedMemoryRange> _dirtyRanges{};
     };
  
 }  // namespace lve
@@ -56,6 +56,7 @@ void LveCamera::setViewDirection(glm::vec3 position, glm::vec3 direction, glm::v
     _viewMatrix[3][0] = -glm::dot(u, position);
     _viewMatrix[3][1] = -glm::dot(v, position);
     _viewMatrix[3][2] = -glm::dot(w, position);
+    _position = position;
 }
 //
 void LveCamera::setViewTarget(
@@ -89,6 +90,7 @@ void LveCamera::setViewYXZ(glm::vec3 position, glm::vec3 rotation) {
     _viewMatrix[3][0] = -glm::dot(u, position);
     _viewMatrix[3][1] = -glm::dot(v, position);
     _viewMatrix[3][2] = -glm::dot(w, position);
+    _position = position;
 }
 
 }
@@ -50,10 +50,17 @@ namespace lve
             return _viewMatrix;
         }
         
+        // World space position from the last setView call.
+        const glm::vec3& getPosition() const
+        {
+            return _position;
+        }
+        
         private:
         
         glm::mat4 _projectionMatrix{1.f};
         glm::mat4 _viewMatrix{1.f};
+        glm::vec3 _position{0.f};
         
     };
     
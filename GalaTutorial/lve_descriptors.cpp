@@ -1,10 +1,24 @@
 #include "lve_descriptors.hpp"
 
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <cmath>
 #include <stdexcept>
 
 namespace lve
 {
+    namespace
+    {
+        bool isBufferDescriptor(VkDescriptorType type)
+        {
+            return type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER ||
+                   type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER ||
+                   type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC ||
+                   type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+        }
+    }
+    
     // LveDescriptorSetLayout methods:
     
     VkDescriptorSetLayout  LveDescriptorSetLayout::getVkDescriptorSetLayout() const
@@ -18,7 +32,8 @@ namespace lve
         uint32_t bindingKey,
         VkDescriptorType descriptorType,
         VkShaderStageFlags stageFlags,
-        uint32_t count)
+        uint32_t count,
+        VkDescriptorBindingFlags bindingFlags)
     {
         assert(_vkBindings.count(bindingKey) == 0 && "Binding already in use");
         VkDescriptorSetLayoutBinding vkDescSetLayoutBinding{};
@@ -27,12 +42,23 @@ namespace lve
         vkDescSetLayoutBinding.descriptorCount = count;
         vkDescSetLayoutBinding.stageFlags = stageFlags;
         _vkBindings[bindingKey] = vkDescSetLayoutBinding;
+        if (bindingFlags != 0)
+        {
+            _bindingFlags[bindingKey] = bindingFlags;
+        }
+        return *this;
+    }
+    
+    LveDescriptorSetLayout::Builder &LveDescriptorSetLayout::Builder::setLayoutFlags(
+        VkDescriptorSetLayoutCreateFlags flags)
+    {
+        _layoutFlags = flags;
         return *this;
     }
     
     std::unique_ptr<LveDescriptorSetLayout> LveDescriptorSetLayout::Builder::build() const
     {
-        return std::make_unique<LveDescriptorSetLayout>(lveDevice, _vkBindings);
+        return std::make_unique<LveDescriptorSetLayout>(lveDevice, _vkBindings, _bindingFlags, _layoutFlags);
     }
     
     // Descriptor Set Layout
@@ -40,20 +66,37 @@ namespace lve
     LveDescriptorSetLayout::LveDescriptorSetLayout(
         LveDevice &lveDevice,
         std::unordered_map<uint32_t,
-        VkDescriptorSetLayoutBinding> bindings)
+        VkDescriptorSetLayoutBinding> bindings,
+        std::unordered_map<uint32_t, VkDescriptorBindingFlags> bindingFlags,
+        VkDescriptorSetLayoutCreateFlags layoutFlags)
     :   _lveDevice{lveDevice},
-        _vkBindings{bindings}
+        _vkBindings{bindings},
+        _layoutFlags{layoutFlags}
     {
         std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings{};
+        std::vector<VkDescriptorBindingFlags> setLayoutBindingFlags{};
         for (auto kv : bindings)
         {
             setLayoutBindings.push_back(kv.second);
+            setLayoutBindingFlags.push_back(bindingFlags.count(kv.first) > 0 ? bindingFlags[kv.first] : 0);
         }
 
         VkDescriptorSetLayoutCreateInfo vkDescriptorSetLayoutCI{};
         
         vkDescriptorSetLayoutCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
         
+        vkDescriptorSetLayoutCI.flags = layoutFlags;
+        
+        // Parallel to pBindings.
+        VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsCI{};
+        bindingFlagsCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+        bindingFlagsCI.bindingCount = static_cast<uint32_t>(setLayoutBindingFlags.size());
+        bindingFlagsCI.pBindingFlags = setLayoutBindingFlags.data();
+        if (!bindingFlags.empty())
+        {
+            vkDescriptorSetLayoutCI.pNext = &bindingFlagsCI;
+        }
+        
         vkDescriptorSetLayoutCI.bindingCount = static_cast<uint32_t>(setLayoutBindings.size());
         
         vkDescriptorSetLayoutCI.pBindings = setLayoutBindings.data();
@@ -70,9 +113,177 @@ namespace lve
      
     LveDescriptorSetLayout::~LveDescriptorSetLayout()
     {
+        // Cached sets are keyed by the handle, which a new layout may get.
+        _lveDevice.notifyDestroyed(LveDevice::handleValue(_vkDescriptorSetLayout));
         vkDestroyDescriptorSetLayout(_lveDevice.device(), _vkDescriptorSetLayout, nullptr);
     }
     
+    std::unique_ptr<LveDescriptorUpdateTemplate> LveDescriptorSetLayout::createUpdateTemplate(
+        VkPipelineLayout pushPipelineLayout,
+        uint32_t pushSet,
+        VkPipelineBindPoint bindPoint) const
+    {
+        return std::make_unique<LveDescriptorUpdateTemplate>(*this, pushPipelineLayout, pushSet, bindPoint);
+    }
+    
+    // Descriptor Update Template
+    
+    LveDescriptorUpdateTemplate::LveDescriptorUpdateTemplate(
+        const LveDescriptorSetLayout &setLayout,
+        VkPipelineLayout pushPipelineLayout,
+        uint32_t pushSet,
+        VkPipelineBindPoint bindPoint)
+    :   _lveDevice{setLayout._lveDevice},
+        _pushPipelineLayout{pushPipelineLayout},
+        _pushSet{pushSet},
+        _bindPoint{bindPoint}
+    {
+        assert((pushPipelineLayout == VK_NULL_HANDLE ||
+                (setLayout._layoutFlags & VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR) != 0) &&
+               "Push templates need a push descriptor layout");
+        
+        std::vector<uint32_t> bindings{};
+        for (const auto &kv : setLayout._vkBindings)
+        {
+            bindings.push_back(kv.first);
+        }
+        std::sort(bindings.begin(), bindings.end());
+        
+        for (uint32_t binding : bindings)
+        {
+            const VkDescriptorSetLayoutBinding &layoutBinding = setLayout._vkBindings.at(binding);
+            const bool buffer = isBufferDescriptor(layoutBinding.descriptorType);
+            assert(layoutBinding.descriptorType != VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER &&
+                   layoutBinding.descriptorType != VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER &&
+                   "Texel buffer bindings are not supported");
+            
+            VkDescriptorUpdateTemplateEntry entry{};
+            entry.dstBinding = binding;
+            entry.dstArrayElement = 0;
+            entry.descriptorCount = layoutBinding.descriptorCount;
+            entry.descriptorType = layoutBinding.descriptorType;
+            entry.offset = _dataSize;
+            entry.stride = buffer ? sizeof(VkDescriptorBufferInfo) : sizeof(VkDescriptorImageInfo);
+            _entries.push_back(entry);
+            _dataSize += entry.stride * entry.descriptorCount;
+        }
+        
+        if (!_lveDevice.supportsUpdateTemplates())
+        {
+            return;
+        }
+        
+        VkDescriptorUpdateTemplateCreateInfo templateCI{};
+        templateCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+        templateCI.descriptorUpdateEntryCount = static_cast<uint32_t>(_entries.size());
+        templateCI.pDescriptorUpdateEntries = _entries.data();
+        if (pushPipelineLayout == VK_NULL_HANDLE)
+        {
+            templateCI.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+            templateCI.descriptorSetLayout = setLayout.getVkDescriptorSetLayout();
+        }
+        else
+        {
+            templateCI.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_PUSH_DESCRIPTORS_KHR;
+            templateCI.pipelineBindPoint = bindPoint;
+            templateCI.pipelineLayout = pushPipelineLayout;
+            templateCI.set = pushSet;
+        }
+        if (_lveDevice.createDescriptorUpdateTemplate(_lveDevice.device(), &templateCI, nullptr, &_vkTemplate) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create descriptor update template!");
+        }
+    }
+    
+    LveDescriptorUpdateTemplate::~LveDescriptorUpdateTemplate()
+    {
+        if (_vkTemplate != VK_NULL_HANDLE)
+        {
+            _lveDevice.destroyDescriptorUpdateTemplate(_lveDevice.device(), _vkTemplate, nullptr);
+        }
+    }
+    
+    size_t LveDescriptorUpdateTemplate::getOffset(uint32_t binding) const
+    {
+        for (const VkDescriptorUpdateTemplateEntry &entry : _entries)
+        {
+            if (entry.dstBinding == binding)
+            {
+                return entry.offset;
+            }
+        }
+        assert(false && "Layout does not contain specified binding");
+        return 0;
+    }
+    
+    size_t LveDescriptorUpdateTemplate::getDataSize() const
+    {
+        return _dataSize;
+    }
+    
+    void LveDescriptorUpdateTemplate::update(VkDescriptorSet set, const void *data) const
+    {
+        assert(_pushPipelineLayout == VK_NULL_HANDLE && "Push templates cannot update sets");
+        if (_vkTemplate != VK_NULL_HANDLE)
+        {
+            _lveDevice.updateDescriptorSetWithTemplate(_lveDevice.device(), set, _vkTemplate, data);
+            return;
+        }
+        
+        std::vector<VkWriteDescriptorSet> writes{};
+        writesFor(data, writes);
+        for (VkWriteDescriptorSet &write : writes)
+        {
+            write.dstSet = set;
+        }
+        vkUpdateDescriptorSets(_lveDevice.device(), static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+    }
+    
+    void LveDescriptorUpdateTemplate::push(VkCommandBuffer commandBuffer, const void *data) const
+    {
+        assert(_pushPipelineLayout != VK_NULL_HANDLE && "Template was not created for push descriptors");
+        assert(_lveDevice.supportsPushDescriptors() && "Push descriptors are not supported");
+        if (_vkTemplate != VK_NULL_HANDLE)
+        {
+            _lveDevice.cmdPushDescriptorSetWithTemplate(commandBuffer, _vkTemplate, _pushPipelineLayout, _pushSet, data);
+            return;
+        }
+        
+        std::vector<VkWriteDescriptorSet> writes{};
+        writesFor(data, writes);
+        _lveDevice.cmdPushDescriptorSet(
+            commandBuffer,
+            _bindPoint,
+            _pushPipelineLayout,
+            _pushSet,
+            static_cast<uint32_t>(writes.size()),
+            writes.data());
+    }
+    
+    void LveDescriptorUpdateTemplate::writesFor(const void *data, std::vector<VkWriteDescriptorSet> &writes) const
+    {
+        const char *bytes = static_cast<const char *>(data);
+        writes.reserve(_entries.size());
+        for (const VkDescriptorUpdateTemplateEntry &entry : _entries)
+        {
+            VkWriteDescriptorSet write{};
+            write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            write.dstBinding = entry.dstBinding;
+            write.dstArrayElement = entry.dstArrayElement;
+            write.descriptorCount = entry.descriptorCount;
+            write.descriptorType = entry.descriptorType;
+            if (isBufferDescriptor(entry.descriptorType))
+            {
+                write.pBufferInfo = reinterpret_cast<const VkDescriptorBufferInfo *>(bytes + entry.offset);
+            }
+            else
+            {
+                write.pImageInfo = reinterpret_cast<const VkDescriptorImageInfo *>(bytes + entry.offset);
+            }
+            writes.push_back(write);
+        }
+    }
+    
     // Descriptor Pool Builder
     
     LveDescriptorPool::Builder &LveDescriptorPool::Builder::addPoolSize(
@@ -130,16 +341,25 @@ namespace lve
     // allocates Descriptor Set
     bool LveDescriptorPool::allocateDescriptor(
         const VkDescriptorSetLayout descriptorSetLayout,
-        VkDescriptorSet &descriptor) const
+        VkDescriptorSet &descriptor,
+        uint32_t variableDescriptorCount) const
     {
         VkDescriptorSetAllocateInfo allocInfo{};
         allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
         allocInfo.descriptorPool = descriptorPool;
         allocInfo.pSetLayouts = &descriptorSetLayout;
         allocInfo.descriptorSetCount = 1;
+        
+        VkDescriptorSetVariableDescriptorCountAllocateInfo variableCountInfo{};
+        variableCountInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO;
+        variableCountInfo.descriptorSetCount = 1;
+        variableCountInfo.pDescriptorCounts = &variableDescriptorCount;
+        if (variableDescriptorCount > 0)
+        {
+            allocInfo.pNext = &variableCountInfo;
+        }
 
-        // Might want to create a "DescriptorPoolManager" class that handles this case, and builds
-        // a new pool whenever an old pool fills up. But this is beyond our current scope
+        // Fixed size; LveDescriptorAllocator chains pools instead of failing when one is full.
         if (vkAllocateDescriptorSets(lveDevice.device(), &allocInfo, &descriptor) != VK_SUCCESS)
         {
             return false;
@@ -161,13 +381,378 @@ namespace lve
         vkResetDescriptorPool(lveDevice.device(), descriptorPool, 0);
     }
     
+    // Descriptor Allocator Builder
+    
+    LveDescriptorAllocator::Builder &LveDescriptorAllocator::Builder::addPoolSize(
+        VkDescriptorType descriptorType,
+        float ratio)
+    {
+        ratios.push_back({descriptorType, ratio});
+        return *this;
+    }
+    
+    LveDescriptorAllocator::Builder &LveDescriptorAllocator::Builder::setInitialSetsPerPool(uint32_t count)
+    {
+        initialSetsPerPool = count;
+        return *this;
+    }
+    
+    LveDescriptorAllocator::Builder &LveDescriptorAllocator::Builder::setGrowthFactor(float factor)
+    {
+        growthFactor = factor;
+        return *this;
+    }
+    
+    LveDescriptorAllocator::Builder &LveDescriptorAllocator::Builder::setMaxSetsPerPool(uint32_t count)
+    {
+        maxSetsPerPool = count;
+        return *this;
+    }
+    
+    LveDescriptorAllocator::Builder &LveDescriptorAllocator::Builder::setPoolFlags(VkDescriptorPoolCreateFlags flags)
+    {
+        poolFlags = flags;
+        return *this;
+    }
+    
+    std::unique_ptr<LveDescriptorAllocator> LveDescriptorAllocator::Builder::build() const
+    {
+        return std::make_unique<LveDescriptorAllocator>(
+            lveDevice,
+            ratios,
+            initialSetsPerPool,
+            growthFactor,
+            maxSetsPerPool,
+            poolFlags);
+    }
+    
+    // Descriptor Allocator
+    
+    LveDescriptorAllocator::LveDescriptorAllocator(
+        LveDevice &lveDevice,
+        std::vector<std::pair<VkDescriptorType, float>> ratios,
+        uint32_t initialSetsPerPool,
+        float growthFactor,
+        uint32_t maxSetsPerPool,
+        VkDescriptorPoolCreateFlags poolFlags)
+    :   _lveDevice{lveDevice},
+        _ratios{std::move(ratios)},
+        _setsPerPool{std::max(1u, initialSetsPerPool)},
+        _growthFactor{std::max(1.f, growthFactor)},
+        _maxSetsPerPool{std::max(_setsPerPool, maxSetsPerPool)},
+        _poolFlags{poolFlags}
+    {}
+    
+    LveDescriptorAllocator::~LveDescriptorAllocator()
+    {
+        if (_currentPool != VK_NULL_HANDLE)
+        {
+            vkDestroyDescriptorPool(_lveDevice.device(), _currentPool, nullptr);
+        }
+        for (VkDescriptorPool pool : _fullPools)
+        {
+            vkDestroyDescriptorPool(_lveDevice.device(), pool, nullptr);
+        }
+        for (VkDescriptorPool pool : _freePools)
+        {
+            vkDestroyDescriptorPool(_lveDevice.device(), pool, nullptr);
+        }
+    }
+    
+    bool LveDescriptorAllocator::allocateDescriptor(
+        const VkDescriptorSetLayout descriptorSetLayout,
+        VkDescriptorSet &descriptorSet,
+        uint32_t variableDescriptorCount)
+    {
+        auto start = std::chrono::steady_clock::now();
+        
+        if (_currentPool == VK_NULL_HANDLE)
+        {
+            _currentPool = nextPool();
+        }
+        
+        VkDescriptorSetAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorPool = _currentPool;
+        allocInfo.pSetLayouts = &descriptorSetLayout;
+        allocInfo.descriptorSetCount = 1;
+        
+        VkDescriptorSetVariableDescriptorCountAllocateInfo variableCountInfo{};
+        variableCountInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO;
+        variableCountInfo.descriptorSetCount = 1;
+        variableCountInfo.pDescriptorCounts = &variableDescriptorCount;
+        if (variableDescriptorCount > 0)
+        {
+            allocInfo.pNext = &variableCountInfo;
+        }
+        
+        VkResult result = vkAllocateDescriptorSets(_lveDevice.device(), &allocInfo, &descriptorSet);
+        if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL)
+        {
+            _fullPools.push_back(_currentPool);
+            _currentPool = nextPool();
+            allocInfo.descriptorPool = _currentPool;
+            result = vkAllocateDescriptorSets(_lveDevice.device(), &allocInfo, &descriptorSet);
+        }
+        if (result != VK_SUCCESS)
+        {
+            return false;
+        }
+        
+        double microseconds = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        _statistics.allocationCount++;
+        _totalAllocationMicroseconds += microseconds;
+        _statistics.maxAllocationMicroseconds = std::max(_statistics.maxAllocationMicroseconds, microseconds);
+        return true;
+    }
+    
+    void LveDescriptorAllocator::reset()
+    {
+        if (_currentPool != VK_NULL_HANDLE)
+        {
+            _fullPools.push_back(_currentPool);
+            _currentPool = VK_NULL_HANDLE;
+        }
+        for (VkDescriptorPool pool : _fullPools)
+        {
+            vkResetDescriptorPool(_lveDevice.device(), pool, 0);
+            _freePools.push_back(pool);
+        }
+        _fullPools.clear();
+        _statistics.resetCount++;
+    }
+    
+    LveDescriptorAllocator::Statistics LveDescriptorAllocator::getStatistics() const
+    {
+        Statistics statistics = _statistics;
+        if (statistics.allocationCount > 0)
+        {
+            statistics.meanAllocationMicroseconds =
+                _totalAllocationMicroseconds / static_cast<double>(statistics.allocationCount);
+        }
+        statistics.poolsInUse = static_cast<uint32_t>(_fullPools.size()) + (_currentPool != VK_NULL_HANDLE ? 1 : 0);
+        statistics.poolCount = statistics.poolsInUse + static_cast<uint32_t>(_freePools.size());
+        return statistics;
+    }
+    
+    VkDescriptorPool LveDescriptorAllocator::nextPool()
+    {
+        if (!_freePools.empty())
+        {
+            VkDescriptorPool pool = _freePools.back();
+            _freePools.pop_back();
+            return pool;
+        }
+        
+        std::vector<VkDescriptorPoolSize> poolSizes{};
+        for (const auto &ratio : _ratios)
+        {
+            uint32_t count = static_cast<uint32_t>(std::ceil(ratio.second * static_cast<float>(_setsPerPool)));
+            poolSizes.push_back({ratio.first, std::max(1u, count)});
+        }
+        
+        VkDescriptorPoolCreateInfo descriptorPoolInfo{};
+        descriptorPoolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        descriptorPoolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+        descriptorPoolInfo.pPoolSizes = poolSizes.data();
+        descriptorPoolInfo.maxSets = _setsPerPool;
+        descriptorPoolInfo.flags = _poolFlags;
+        
+        VkDescriptorPool pool;
+        if (vkCreateDescriptorPool(_lveDevice.device(), &descriptorPoolInfo, nullptr, &pool) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create descriptor pool!");
+        }
+        
+        _setsPerPool = std::min(
+            _maxSetsPerPool,
+            static_cast<uint32_t>(std::ceil(static_cast<float>(_setsPerPool) * _growthFactor)));
+        return pool;
+    }
+    
+    // Descriptor Cache
+    
+    LveDescriptorCache::LveDescriptorCache(LveDevice &lveDevice, LveDescriptorAllocator &allocator)
+    :   _lveDevice{lveDevice},
+        _allocator{allocator}
+    {
+        _listenerId = _lveDevice.addDestructionListener([this](uint64_t handle)
+        {
+            std::lock_guard<std::mutex> lock{_mutex};
+            invalidate(handle);
+        });
+    }
+    
+    LveDescriptorCache::~LveDescriptorCache()
+    {
+        _lveDevice.removeDestructionListener(_listenerId);
+    }
+    
+    void LveDescriptorCache::clear()
+    {
+        std::lock_guard<std::mutex> lock{_mutex};
+        _entries.clear();
+        _keysByResource.clear();
+        _recycledSets.clear();
+        _statistics.setCount = 0;
+        _statistics.recycledSetCount = 0;
+    }
+    
+    LveDescriptorCache::Statistics LveDescriptorCache::getStatistics() const
+    {
+        std::lock_guard<std::mutex> lock{_mutex};
+        Statistics statistics = _statistics;
+        if (statistics.lookupCount > 0)
+        {
+            statistics.hitRate =
+                static_cast<float>(statistics.hitCount) / static_cast<float>(statistics.lookupCount);
+        }
+        return statistics;
+    }
+    
+    // FNV-1a over the words.
+    size_t LveDescriptorCache::KeyHash::operator()(const Key &key) const
+    {
+        uint64_t hash = 14695981039346656037ull;
+        for (uint64_t word : key)
+        {
+            hash = (hash ^ word) * 1099511628211ull;
+        }
+        return static_cast<size_t>(hash);
+    }
+    
+    VkDescriptorSet LveDescriptorCache::find(const Key &key)
+    {
+        std::lock_guard<std::mutex> lock{_mutex};
+        _statistics.lookupCount++;
+        auto entry = _entries.find(key);
+        if (entry == _entries.end())
+        {
+            return VK_NULL_HANDLE;
+        }
+        _statistics.hitCount++;
+        return entry->second.set;
+    }
+    
+    void LveDescriptorCache::insert(Key key, VkDescriptorSet set, std::vector<uint64_t> resources)
+    {
+        std::lock_guard<std::mutex> lock{_mutex};
+        auto inserted = _entries.emplace(std::move(key), Entry{set, std::move(resources)});
+        if (!inserted.second)
+        {
+            return;
+        }
+        const Key *insertedKey = &inserted.first->first;
+        for (uint64_t resource : inserted.first->second.resources)
+        {
+            _keysByResource[resource].push_back(insertedKey);
+        }
+        _statistics.setCount++;
+    }
+    
+    VkDescriptorSet LveDescriptorCache::takeRecycled(const Key &key)
+    {
+        std::lock_guard<std::mutex> lock{_mutex};
+        auto recycled = _recycledSets.find(recycleKey(key));
+        if (recycled == _recycledSets.end())
+        {
+            return VK_NULL_HANDLE;
+        }
+        VkDescriptorSet set = recycled->second.back();
+        recycled->second.pop_back();
+        if (recycled->second.empty())
+        {
+            _recycledSets.erase(recycled);
+        }
+        _statistics.recycledSetCount--;
+        return set;
+    }
+    
+    LveDescriptorCache::Key LveDescriptorCache::recycleKey(const Key &key)
+    {
+        return Key{key[0], key[1]};
+    }
+    
+    void LveDescriptorCache::invalidate(uint64_t resource)
+    {
+        auto keys = _keysByResource.find(resource);
+        if (keys == _keysByResource.end())
+        {
+            return;
+        }
+        std::vector<const Key*> invalidatedKeys = std::move(keys->second);
+        _keysByResource.erase(keys);
+        
+        for (const Key *key : invalidatedKeys)
+        {
+            auto entry = _entries.find(*key);
+            
+            // Unlink the entry from its other resources before the key it points to is erased.
+            for (uint64_t other : entry->second.resources)
+            {
+                auto otherKeys = _keysByResource.find(other);
+                if (otherKeys == _keysByResource.end())
+                {
+                    continue;
+                }
+                std::vector<const Key*> &list = otherKeys->second;
+                list.erase(std::remove(list.begin(), list.end(), key), list.end());
+                if (list.empty())
+                {
+                    _keysByResource.erase(otherKeys);
+                }
+            }
+            // The destroyed resource was not in use by pending command buffers, so neither is the
+            // set. Sets of a destroyed layout cannot be written any more and stay in the allocator.
+            if (entry->first[0] != resource)
+            {
+                _recycledSets[recycleKey(entry->first)].push_back(entry->second.set);
+                _statistics.recycledSetCount++;
+            }
+            _entries.erase(entry);
+            _statistics.invalidatedCount++;
+            _statistics.setCount--;
+        }
+        
+        for (auto recycled = _recycledSets.begin(); recycled != _recycledSets.end();)
+        {
+            if (recycled->first[0] == resource)
+            {
+                _statistics.recycledSetCount -= static_cast<uint32_t>(recycled->second.size());
+                recycled = _recycledSets.erase(recycled);
+            }
+            else
+            {
+                ++recycled;
+            }
+        }
+    }
+    
     // Descriptor Writer
     
     LveDescriptorWriter::LveDescriptorWriter(
         LveDescriptorSetLayout &setLayout,
         LveDescriptorPool &pool)
     :   _setLayout{setLayout},
-        _pool{pool}
+        _pool{&pool}
+    {}
+    
+    LveDescriptorWriter::LveDescriptorWriter(
+        LveDescriptorSetLayout &setLayout,
+        LveDescriptorAllocator &allocator)
+    :   _setLayout{setLayout},
+        _allocator{&allocator}
+    {}
+     
+    LveDescriptorWriter::LveDescriptorWriter(
+        LveDescriptorSetLayout &setLayout,
+        LveDescriptorCache &cache)
+    :   _setLayout{setLayout},
+        _cache{&cache}
+    {}
+    
+    LveDescriptorWriter::LveDescriptorWriter(LveDescriptorSetLayout &setLayout)
+    :   _setLayout{setLayout}
     {}
      
     LveDescriptorWriter &LveDescriptorWriter::writeBuffer(
@@ -193,9 +778,86 @@ namespace lve
         return *this;
     }
      
-    bool LveDescriptorWriter::build(VkDescriptorSet &set)
+    LveDescriptorWriter &LveDescriptorWriter::writeBuffers(
+        uint32_t bindingKey,
+        uint32_t firstElement,
+        uint32_t count,
+        const VkDescriptorBufferInfo *bufferInfos)
     {
-        bool success = _pool.allocateDescriptor(_setLayout.getVkDescriptorSetLayout(), set);
+        assert(_setLayout._vkBindings.count(bindingKey) == 1 &&
+               "Layout does not contain specified binding");
+
+        VkDescriptorSetLayoutBinding& bindingDescription = _setLayout._vkBindings[bindingKey];
+
+        assert(firstElement + count <= bindingDescription.descriptorCount &&
+               "Writing past the end of the binding's array");
+
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.descriptorType = bindingDescription.descriptorType;
+        write.dstBinding = bindingKey;
+        write.dstArrayElement = firstElement;
+        write.pBufferInfo = bufferInfos;
+        write.descriptorCount = count;
+
+        _writes.push_back(write);
+        return *this;
+    }
+    
+    LveDescriptorWriter &LveDescriptorWriter::writeImages(
+        uint32_t bindingKey,
+        uint32_t firstElement,
+        uint32_t count,
+        const VkDescriptorImageInfo *imageInfos)
+    {
+        assert(_setLayout._vkBindings.count(bindingKey) == 1 &&
+               "Layout does not contain specified binding");
+
+        VkDescriptorSetLayoutBinding& bindingDescription = _setLayout._vkBindings[bindingKey];
+
+        assert(firstElement + count <= bindingDescription.descriptorCount &&
+               "Writing past the end of the binding's array");
+
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.descriptorType = bindingDescription.descriptorType;
+        write.dstBinding = bindingKey;
+        write.dstArrayElement = firstElement;
+        write.pImageInfo = imageInfos;
+        write.descriptorCount = count;
+
+        _writes.push_back(write);
+        return *this;
+    }
+     
+    bool LveDescriptorWriter::build(VkDescriptorSet &set, uint32_t variableDescriptorCount)
+    {
+        if (_cache != nullptr)
+        {
+            std::vector<uint64_t> resources{};
+            LveDescriptorCache::Key key = cacheKey(variableDescriptorCount, resources);
+            VkDescriptorSet cachedSet = _cache->find(key);
+            if (cachedSet != VK_NULL_HANDLE)
+            {
+                set = cachedSet;
+                return true;
+            }
+            set = _cache->takeRecycled(key);
+            if (set == VK_NULL_HANDLE &&
+                !_cache->_allocator.allocateDescriptor(
+                    _setLayout.getVkDescriptorSetLayout(), set, variableDescriptorCount))
+            {
+                return false;
+            }
+            overwrite(set);
+            _cache->insert(std::move(key), set, std::move(resources));
+            return true;
+        }
+        
+        assert((_pool != nullptr || _allocator != nullptr) && "Writer has nothing to allocate from");
+        bool success = _pool != nullptr ?
+            _pool->allocateDescriptor(_setLayout.getVkDescriptorSetLayout(), set, variableDescriptorCount) :
+            _allocator->allocateDescriptor(_setLayout.getVkDescriptorSetLayout(), set, variableDescriptorCount);
         if (!success)
         {
             return false;
@@ -203,6 +865,66 @@ namespace lve
         overwrite(set);
         return true;
     }
+    
+    LveDescriptorCache::Key LveDescriptorWriter::cacheKey(
+        uint32_t variableDescriptorCount,
+        std::vector<uint64_t> &resources) const
+    {
+        // Writes in a different order produce the same set.
+        std::vector<const VkWriteDescriptorSet*> writes{};
+        writes.reserve(_writes.size());
+        for (const VkWriteDescriptorSet &write : _writes)
+        {
+            writes.push_back(&write);
+        }
+        std::sort(writes.begin(), writes.end(), [](const VkWriteDescriptorSet *a, const VkWriteDescriptorSet *b)
+        {
+            return a->dstBinding != b->dstBinding ?
+                a->dstBinding < b->dstBinding :
+                a->dstArrayElement < b->dstArrayElement;
+        });
+        
+        LveDescriptorCache::Key key{};
+        key.push_back(LveDevice::handleValue(_setLayout.getVkDescriptorSetLayout()));
+        key.push_back(variableDescriptorCount);
+        resources.push_back(LveDevice::handleValue(_setLayout.getVkDescriptorSetLayout()));
+        for (const VkWriteDescriptorSet *write : writes)
+        {
+            key.push_back(static_cast<uint64_t>(write->dstBinding) << 32 | write->dstArrayElement);
+            key.push_back(static_cast<uint64_t>(write->descriptorType) << 32 | write->descriptorCount);
+            for (uint32_t i = 0; i < write->descriptorCount; i++)
+            {
+                if (write->pBufferInfo != nullptr)
+                {
+                    const VkDescriptorBufferInfo &info = write->pBufferInfo[i];
+                    key.push_back(LveDevice::handleValue(info.buffer));
+                    key.push_back(info.offset);
+                    key.push_back(info.range);
+                    resources.push_back(LveDevice::handleValue(info.buffer));
+                }
+                else
+                {
+                    assert(write->pImageInfo != nullptr && "Only buffer and image writes can be cached");
+                    const VkDescriptorImageInfo &info = write->pImageInfo[i];
+                    key.push_back(LveDevice::handleValue(info.sampler));
+                    key.push_back(LveDevice::handleValue(info.imageView));
+                    key.push_back(info.imageLayout);
+                    if (info.sampler != VK_NULL_HANDLE)
+                    {
+                        resources.push_back(LveDevice::handleValue(info.sampler));
+                    }
+                    if (info.imageView != VK_NULL_HANDLE)
+                    {
+                        resources.push_back(LveDevice::handleValue(info.imageView));
+                    }
+                }
+            }
+        }
+        
+        std::sort(resources.begin(), resources.end());
+        resources.erase(std::unique(resources.begin(), resources.end()), resources.end());
+        return key;
+    }
      
     void LveDescriptorWriter::overwrite(VkDescriptorSet &set)
     {
@@ -210,7 +932,26 @@ namespace lve
         {
             write.dstSet = set;
         }
-        vkUpdateDescriptorSets(_pool.lveDevice.device(), _writes.size(), _writes.data(), 0, nullptr);
+        vkUpdateDescriptorSets(_setLayout._lveDevice.device(), _writes.size(), _writes.data(), 0, nullptr);
+    }
+    
+    void LveDescriptorWriter::push(
+        VkCommandBuffer commandBuffer,
+        VkPipelineLayout pipelineLayout,
+        uint32_t set,
+        VkPipelineBindPoint bindPoint)
+    {
+        LveDevice &lveDevice = _setLayout._lveDevice;
+        assert(lveDevice.supportsPushDescriptors() && "Push descriptors are not supported");
+        assert((_setLayout._layoutFlags & VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR) != 0 &&
+               "Pushing needs a push descriptor layout");
+        lveDevice.cmdPushDescriptorSet(
+            commandBuffer,
+            bindPoint,
+            pipelineLayout,
+            set,
+            static_cast<uint32_t>(_writes.size()),
+            _writes.data());
     }
     
    LveDescriptorWriter &LveDescriptorWriter::writeImage(
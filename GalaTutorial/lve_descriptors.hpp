@@ -4,12 +4,16 @@
 #pragma once
  
 #include "lve_device.hpp"
+#include <cstdint>
 #include <memory>
+#include <mutex>
 #include <unordered_map>
 #include <vector>
  
 namespace lve {
  
+    class LveDescriptorUpdateTemplate;
+ 
     // LveDescriptorSetLayout
     class LveDescriptorSetLayout {
         
@@ -20,11 +24,20 @@ namespace lve {
                 
                 Builder(LveDevice &lveDevice) : lveDevice{lveDevice} {}
                 
+                // bindingFlags need descriptor indexing, see LveDevice::supportsBindless(). With
+                // VARIABLE_DESCRIPTOR_COUNT_BIT, count is the most descriptors a set may have and the
+                // binding must be the highest one; sets choose their count when they are allocated.
                 Builder &addBinding(
                     uint32_t bindingKey,
                     VkDescriptorType descriptorType,
                     VkShaderStageFlags stageFlags,
-                    uint32_t count = 1);
+                    uint32_t count = 1,
+                    VkDescriptorBindingFlags bindingFlags = 0);
+                
+                // UPDATE_AFTER_BIND_POOL_BIT is needed for bindings with UPDATE_AFTER_BIND_BIT.
+                // PUSH_DESCRIPTOR_BIT_KHR makes a layout for LveDescriptorWriter::push() and push
+                // templates; it needs LveDevice::supportsPushDescriptors() and no dynamic bindings.
+                Builder &setLayoutFlags(VkDescriptorSetLayoutCreateFlags flags);
                 
                 std::unique_ptr<LveDescriptorSetLayout> build() const;
                 
@@ -34,12 +47,17 @@ namespace lve {
                 
                 std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding>
                     _vkBindings{};
+                std::unordered_map<uint32_t, VkDescriptorBindingFlags>
+                    _bindingFlags{};
+                VkDescriptorSetLayoutCreateFlags _layoutFlags = 0;
             }; // End Builder class
 
         public:
             LveDescriptorSetLayout(
                 LveDevice &lveDevice,
-                std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings);
+                std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings,
+                std::unordered_map<uint32_t, VkDescriptorBindingFlags> bindingFlags = {},
+                VkDescriptorSetLayoutCreateFlags layoutFlags = 0);
         
             ~LveDescriptorSetLayout();
         
@@ -47,14 +65,73 @@ namespace lve {
         
             LveDescriptorSetLayout &operator=(const LveDescriptorSetLayout &) = delete;
         VkDescriptorSetLayout getVkDescriptorSetLayout() const;
+        
+            // A template updating every binding of sets of this layout at once. With a pipeline
+            // layout, it pushes set pushSet of that layout instead, which must be this push
+            // descriptor layout.
+            std::unique_ptr<LveDescriptorUpdateTemplate> createUpdateTemplate(
+                VkPipelineLayout pushPipelineLayout = VK_NULL_HANDLE,
+                uint32_t pushSet = 0,
+                VkPipelineBindPoint bindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS) const;
 
         private:
             LveDevice&              _lveDevice;
             VkDescriptorSetLayout   _vkDescriptorSetLayout;
             std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding>
                                     _vkBindings;
+            VkDescriptorSetLayoutCreateFlags _layoutFlags;
 
             friend class LveDescriptorWriter;
+            friend class LveDescriptorUpdateTemplate;
+    };
+
+    // LveDescriptorUpdateTemplate
+    //
+    // Writes every binding of a layout from one block of data in a single call, instead of filling
+    // VkWriteDescriptorSet structures for vkUpdateDescriptorSets. The data holds the bindings in
+    // ascending order, each as descriptorCount tightly packed VkDescriptorBufferInfo or
+    // VkDescriptorImageInfo; getOffset() gives where a binding starts. Texel buffer bindings are not
+    // supported.
+    //
+    // Without VK_KHR_descriptor_update_template the same data is written with
+    // vkUpdateDescriptorSets or vkCmdPushDescriptorSetKHR.
+    class LveDescriptorUpdateTemplate {
+        
+        public:
+            // See LveDescriptorSetLayout::createUpdateTemplate().
+            LveDescriptorUpdateTemplate(
+                const LveDescriptorSetLayout &setLayout,
+                VkPipelineLayout pushPipelineLayout,
+                uint32_t pushSet,
+                VkPipelineBindPoint bindPoint);
+            ~LveDescriptorUpdateTemplate();
+            LveDescriptorUpdateTemplate(const LveDescriptorUpdateTemplate &) = delete;
+            LveDescriptorUpdateTemplate &operator=(const LveDescriptorUpdateTemplate &) = delete;
+        
+            // Byte offset of binding's first descriptor in the data, and the size of the data.
+            size_t getOffset(uint32_t binding) const;
+            size_t getDataSize() const;
+        
+            // Templates without a pipeline layout only.
+            void update(VkDescriptorSet set, const void *data) const;
+        
+            // Templates with a pipeline layout only; records into commandBuffer, so data may be
+            // reused right away.
+            void push(VkCommandBuffer commandBuffer, const void *data) const;
+        
+        private:
+            // The writes the template stands for, pointing into data.
+            void writesFor(const void *data, std::vector<VkWriteDescriptorSet> &writes) const;
+        
+            LveDevice&                                  _lveDevice;
+            VkDescriptorUpdateTemplate                  _vkTemplate = VK_NULL_HANDLE;
+            VkPipelineLayout                            _pushPipelineLayout;
+            uint32_t                                    _pushSet;
+            VkPipelineBindPoint                         _bindPoint;
+        
+            // In ascending binding order.
+            std::vector<VkDescriptorUpdateTemplateEntry> _entries{};
+            size_t                                      _dataSize = 0;
     };
 //
     // LveDescriptorPool
@@ -83,7 +160,12 @@ namespace lve {
             ~LveDescriptorPool();
             LveDescriptorPool(const LveDescriptorPool &) = delete;
             LveDescriptorPool &operator=(const LveDescriptorPool &) = delete;
-            bool allocateDescriptor (const VkDescriptorSetLayout descriptorSetLayout, VkDescriptorSet &vkescriptorSet) const;
+            
+            // variableDescriptorCount sizes the layout's variable count binding, if it has one.
+            bool allocateDescriptor (
+                const VkDescriptorSetLayout descriptorSetLayout,
+                VkDescriptorSet &vkescriptorSet,
+                uint32_t variableDescriptorCount = 0) const;
             void freeDescriptors(std::vector<VkDescriptorSet> &descriptors) const;
             void resetPool();
 
@@ -93,6 +175,184 @@ namespace lve {
             friend class LveDescriptorWriter;
     };
 
+    // LveDescriptorAllocator
+    //
+    // Allocates sets from a chain of pools. When the current pool is exhausted
+    // (VK_ERROR_OUT_OF_POOL_MEMORY or VK_ERROR_FRAGMENTED_POOL) the next one is taken from the pools
+    // freed by reset(), or created with growthFactor times as many sets as the previous, up to
+    // maxSetsPerPool. Each pool holds ratio descriptors of each added type per set.
+    //
+    // reset() returns every set at once with vkResetDescriptorPool and keeps the pools for reuse, so
+    // an allocator per frame in flight, reset once its frame's previous submission has completed,
+    // serves transient sets without freeing them one by one.
+    //
+    // Render thread only.
+    class LveDescriptorAllocator {
+        
+        public:
+            class Builder {
+                public:
+                Builder(LveDevice &lveDevice) : lveDevice{lveDevice} {}
+                Builder &addPoolSize(VkDescriptorType descriptorType, float ratio);
+                Builder &setInitialSetsPerPool(uint32_t count);
+                Builder &setGrowthFactor(float factor);
+                Builder &setMaxSetsPerPool(uint32_t count);
+                Builder &setPoolFlags(VkDescriptorPoolCreateFlags flags);
+                std::unique_ptr<LveDescriptorAllocator> build() const;
+                private:
+                LveDevice &lveDevice;
+                std::vector<std::pair<VkDescriptorType, float>> ratios{};
+                uint32_t initialSetsPerPool = 64;
+                float growthFactor = 2.f;
+                uint32_t maxSetsPerPool = 4096;
+                VkDescriptorPoolCreateFlags poolFlags = 0;
+            };
+        
+            struct Statistics
+            {
+                // Since creation.
+                uint64_t allocationCount = 0;
+                uint32_t resetCount = 0;
+                double   meanAllocationMicroseconds = 0.0;
+                double   maxAllocationMicroseconds = 0.0;
+                
+                // Pools holding sets since the last reset, and pools that exist.
+                uint32_t poolsInUse = 0;
+                uint32_t poolCount = 0;
+            };
+
+            LveDescriptorAllocator(
+                LveDevice &lveDevice,
+                std::vector<std::pair<VkDescriptorType, float>> ratios,
+                uint32_t initialSetsPerPool,
+                float growthFactor,
+                uint32_t maxSetsPerPool,
+                VkDescriptorPoolCreateFlags poolFlags);
+            ~LveDescriptorAllocator();
+            LveDescriptorAllocator(const LveDescriptorAllocator &) = delete;
+            LveDescriptorAllocator &operator=(const LveDescriptorAllocator &) = delete;
+        
+            // False only if a fresh pool cannot hold the set either, e.g. out of device memory.
+            bool allocateDescriptor(
+                const VkDescriptorSetLayout descriptorSetLayout,
+                VkDescriptorSet &descriptorSet,
+                uint32_t variableDescriptorCount = 0);
+        
+            // Every set allocated so far becomes invalid; none may be in use by pending command buffers.
+            void reset();
+        
+            Statistics getStatistics() const;
+
+        private:
+            // A pool reset() freed, or a new one.
+            VkDescriptorPool nextPool();
+        
+            LveDevice&                                      _lveDevice;
+            std::vector<std::pair<VkDescriptorType, float>> _ratios;
+            uint32_t                                        _setsPerPool;
+            float                                           _growthFactor;
+            uint32_t                                        _maxSetsPerPool;
+            VkDescriptorPoolCreateFlags                     _poolFlags;
+        
+            VkDescriptorPool                                _currentPool = VK_NULL_HANDLE;
+            std::vector<VkDescriptorPool>                   _fullPools{};
+            std::vector<VkDescriptorPool>                   _freePools{};
+        
+            Statistics                                      _statistics{};
+            double                                          _totalAllocationMicroseconds = 0.0;
+    };
+
+    // LveDescriptorCache
+    //
+    // Keeps the sets LveDescriptorWriter builds through it, keyed by the layout and the contents of
+    // every write: binding, array element and type, and buffer, offset and range or sampler, image
+    // view and image layout. Building an identical set again returns the cached one without
+    // allocating or updating. Cached sets are shared, so they must not be overwritten.
+    //
+    // Entries that refer to a layout, buffer, image view or sampler are dropped when LveDevice is
+    // notified of its destruction. Their sets are kept and overwritten by the next build with the
+    // same layout, so recreating resources does not allocate more; only the sets of destroyed layouts
+    // are left in allocator. It must not be reset while the cache holds sets; clear() first.
+    //
+    // Render thread only, except that resources may be destroyed on any thread.
+    class LveDescriptorCache {
+        
+        public:
+            struct Statistics
+            {
+                // Since creation.
+                uint64_t lookupCount = 0;
+                uint64_t hitCount = 0;
+                uint64_t invalidatedCount = 0;
+                
+                // Sets cached now, and sets of dropped entries waiting to be reused.
+                uint32_t setCount = 0;
+                uint32_t recycledSetCount = 0;
+                
+                // Share of lookups served by a cached set.
+                float    hitRate = 0.f;
+            };
+
+            LveDescriptorCache(LveDevice &lveDevice, LveDescriptorAllocator &allocator);
+            ~LveDescriptorCache();
+            LveDescriptorCache(const LveDescriptorCache &) = delete;
+            LveDescriptorCache &operator=(const LveDescriptorCache &) = delete;
+        
+            // Drops every entry; the allocator may be reset afterwards.
+            void clear();
+        
+            Statistics getStatistics() const;
+
+        private:
+            // The layout and the writes, sorted by binding and array element, as 64 bit words.
+            using Key = std::vector<uint64_t>;
+        
+            struct KeyHash
+            {
+                size_t operator()(const Key &key) const;
+            };
+        
+            struct Entry
+            {
+                VkDescriptorSet       set = VK_NULL_HANDLE;
+                
+                // LveDevice::handleValue() of the layout and every buffer, image view and sampler the
+                // set refers to.
+                std::vector<uint64_t> resources{};
+            };
+        
+            // VK_NULL_HANDLE on a miss.
+            VkDescriptorSet find(const Key &key);
+            void insert(Key key, VkDescriptorSet set, std::vector<uint64_t> resources);
+        
+            // A set of a dropped entry with key's layout and variable descriptor count, or
+            // VK_NULL_HANDLE.
+            VkDescriptorSet takeRecycled(const Key &key);
+        
+            // The layout and variable descriptor count words of key.
+            static Key recycleKey(const Key &key);
+        
+            // Called with _mutex held.
+            void invalidate(uint64_t resource);
+        
+            LveDevice&                                        _lveDevice;
+            LveDescriptorAllocator&                           _allocator;
+            uint32_t                                          _listenerId;
+        
+            mutable std::mutex                                _mutex;
+            std::unordered_map<Key, Entry, KeyHash>           _entries{};
+        
+            // Keys of the entries referring to each resource; keys of an unordered_map do not move.
+            std::unordered_map<uint64_t, std::vector<const Key*>> _keysByResource{};
+        
+            // Sets of dropped entries by recycleKey().
+            std::unordered_map<Key, std::vector<VkDescriptorSet>, KeyHash> _recycledSets{};
+        
+            Statistics                                        _statistics{};
+            
+            friend class LveDescriptorWriter;
+    };
+
     // LveDescriptorWriter
     class LveDescriptorWriter {
         
@@ -102,6 +362,20 @@ namespace lve {
                 LveDescriptorSetLayout &setLayout,
                 LveDescriptorPool &pool);
         
+            // build() allocates from allocator, growing it as needed.
+            LveDescriptorWriter(
+                LveDescriptorSetLayout &setLayout,
+                LveDescriptorAllocator &allocator);
+        
+            // build() returns the cache's set for identical writes, or allocates one from the cache's
+            // allocator and caches it.
+            LveDescriptorWriter(
+                LveDescriptorSetLayout &setLayout,
+                LveDescriptorCache &cache);
+        
+            // For overwrite() and push() only.
+            explicit LveDescriptorWriter(LveDescriptorSetLayout &setLayout);
+        
             LveDescriptorWriter &writeBuffer(
                 uint32_t binding,
                 VkDescriptorBufferInfo *bufferInfo);
@@ -110,15 +384,48 @@ namespace lve {
                 uint32_t binding,
                 VkDescriptorImageInfo *imageInfo);
         
-            bool build(VkDescriptorSet &set);
+            // count elements of an array binding from firstElement on. The infos must outlive build()
+            // or overwrite().
+            LveDescriptorWriter &writeBuffers(
+                uint32_t binding,
+                uint32_t firstElement,
+                uint32_t count,
+                const VkDescriptorBufferInfo *bufferInfos);
+        
+            LveDescriptorWriter &writeImages(
+                uint32_t binding,
+                uint32_t firstElement,
+                uint32_t count,
+                const VkDescriptorImageInfo *imageInfos);
+        
+            // variableDescriptorCount sizes the layout's variable count binding, if it has one.
+            bool build(VkDescriptorSet &set, uint32_t variableDescriptorCount = 0);
         
             void overwrite(VkDescriptorSet &set);
         
+            // Records the writes as set `set` of pipelineLayout into commandBuffer, without
+            // allocating a set. The layout must be a push descriptor layout, see
+            // LveDescriptorSetLayout::Builder::setLayoutFlags().
+            void push(
+                VkCommandBuffer commandBuffer,
+                VkPipelineLayout pipelineLayout,
+                uint32_t set,
+                VkPipelineBindPoint bindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS);
+        
         
         private:
         
+            // Key of the writes for LveDescriptorCache, and the resources they refer to.
+            LveDescriptorCache::Key cacheKey(
+                uint32_t variableDescriptorCount,
+                std::vector<uint64_t> &resources) const;
+        
             LveDescriptorSetLayout&             _setLayout;
-            LveDescriptorPool&                  _pool;
+            
+            // At most one of them is set; none for writers that only overwrite or push.
+            LveDescriptorPool*                  _pool = nullptr;
+            LveDescriptorAllocator*             _allocator = nullptr;
+            LveDescriptorCache*                 _cache = nullptr;
             std::vector<VkWriteDescriptorSet>   _writes;
         
     };
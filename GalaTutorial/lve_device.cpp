@@ -1,7 +1,12 @@
 #include "lve_device.hpp"
+#include "lve_memory_statistics.hpp"
+#include "lve_staging_pool.hpp"
 
 // std headers
+#include <cassert>
+#include <cstdio>
 #include <cstring>
+#include <fstream>
 #include <iostream>
 #include <set>
 #include <unordered_set>
@@ -56,8 +61,10 @@ void DestroyDebugUtilsMessengerEXT(
 }
 
 // class member functions
-LveDevice::LveDevice(LveWindow &window)
-:   window{window}
+LveDevice::LveDevice(LveWindow &window, bool useTimelineSemaphores, std::string pipelineCachePath)
+:   window{window},
+    useTimelineSemaphores_{useTimelineSemaphores},
+    pipelineCachePath_{std::move(pipelineCachePath)}
 {
     createInstance();
     setupDebugMessenger();
@@ -65,11 +72,35 @@ LveDevice::LveDevice(LveWindow &window)
     pickPhysicalDevice();
     createLogicalDevice();
     createCommandPool();
+    createTimelineSemaphore();
+    createPipelineCache();
+    stagingPool_ = std::make_unique<LveStagingPool>(*this);
 }
 
 LveDevice::~LveDevice()
 {
+    vkDeviceWaitIdle(device_);
+    retireSubmissions();
+    assert(pendingSubmissions_.empty() && deferredDestructions_.empty() && "Submissions outlive the idle device");
+    for (VkFence fence : freeFences_)
+    {
+        vkDestroyFence(device_, fence, nullptr);
+    }
+    if (timelineSemaphore_ != VK_NULL_HANDLE)
+    {
+        vkDestroySemaphore(device_, timelineSemaphore_, nullptr);
+    }
+    savePipelineCache();
+    vkDestroyPipelineCache(device_, pipelineCache_, nullptr);
+
+    // Destroying the pools frees their command buffers.
+    if (transferCommandPool != commandPool)
+    {
+        vkDestroyCommandPool(device_, transferCommandPool, nullptr);
+    }
     vkDestroyCommandPool(device_, commandPool, nullptr);
+    stagingPool_.reset();
+    memoryAllocator_.reset();
     vkDestroyDevice(device_, nullptr);
 
     if (enableValidationLayers)
@@ -171,6 +202,10 @@ void LveDevice::createLogicalDevice()
 
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
     std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily, indices.presentFamily};
+    if (indices.transferFamilyHasValue)
+    {
+        uniqueQueueFamilies.insert(indices.transferFamily);
+    }
 
     float queuePriority = 1.0f;
     for (uint32_t queueFamily : uniqueQueueFamilies)
@@ -192,9 +227,105 @@ void LveDevice::createLogicalDevice()
     createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
     createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
+    // Required extensions, and the optional ones the device supports.
+    std::vector<const char *> extensions = deviceExtensions;
+    {
+        uint32_t extensionCount = 0;
+        vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+        std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+        vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+        for (const char *optional : optionalDeviceExtensions)
+        {
+            for (const auto &extension : availableExtensions)
+            {
+                if (strcmp(extension.extensionName, optional) == 0)
+                {
+                    extensions.push_back(optional);
+                    break;
+                }
+            }
+        }
+    }
+    enabledExtensions_ = std::set<std::string>(extensions.begin(), extensions.end());
+
+    // An extension alone does not enable its features; they have to be supported and requested as
+    // well. Only the structures of enabled extensions are queried.
+    VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures{};
+    timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+    VkPhysicalDeviceDescriptorIndexingFeatures indexingFeatures{};
+    indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+    const bool timelineExtension = useTimelineSemaphores_ && isExtensionEnabled(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+    const bool indexingExtension =
+        isExtensionEnabled(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME) &&
+        isExtensionEnabled(VK_KHR_MAINTENANCE3_EXTENSION_NAME);
+    if (timelineExtension || indexingExtension)
+    {
+        auto getPhysicalDeviceFeatures2 = reinterpret_cast<PFN_vkGetPhysicalDeviceFeatures2KHR>(
+            vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceFeatures2KHR"));
+        VkPhysicalDeviceFeatures2 features2{};
+        features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features2.pNext = timelineExtension ? static_cast<void *>(&timelineFeatures) : &indexingFeatures;
+        timelineFeatures.pNext = indexingExtension ? &indexingFeatures : nullptr;
+        getPhysicalDeviceFeatures2(physicalDevice, &features2);
+    }
+
+    // simple_shader_bindless.vert selects its object buffer with a push constant.
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+
+    timelineSemaphoreFeature_ = timelineExtension && timelineFeatures.timelineSemaphore == VK_TRUE;
+    supportsBindless_ =
+        indexingExtension &&
+        supportedFeatures.shaderStorageBufferArrayDynamicIndexing == VK_TRUE &&
+        indexingFeatures.runtimeDescriptorArray == VK_TRUE &&
+        indexingFeatures.descriptorBindingPartiallyBound == VK_TRUE &&
+        indexingFeatures.descriptorBindingVariableDescriptorCount == VK_TRUE &&
+        indexingFeatures.descriptorBindingUpdateUnusedWhilePending == VK_TRUE &&
+        indexingFeatures.descriptorBindingStorageBufferUpdateAfterBind == VK_TRUE &&
+        indexingFeatures.descriptorBindingSampledImageUpdateAfterBind == VK_TRUE &&
+        indexingFeatures.shaderSampledImageArrayNonUniformIndexing == VK_TRUE;
+
+    // Only what the engine uses is requested.
+    VkPhysicalDeviceTimelineSemaphoreFeatures enabledTimelineFeatures{};
+    enabledTimelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+    enabledTimelineFeatures.timelineSemaphore = VK_TRUE;
+    VkPhysicalDeviceDescriptorIndexingFeatures enabledIndexingFeatures{};
+    enabledIndexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+    enabledIndexingFeatures.runtimeDescriptorArray = VK_TRUE;
+    enabledIndexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+    enabledIndexingFeatures.descriptorBindingVariableDescriptorCount = VK_TRUE;
+    enabledIndexingFeatures.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+    enabledIndexingFeatures.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+    enabledIndexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+    enabledIndexingFeatures.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+    const void *featureChain = nullptr;
+    if (supportsBindless_)
+    {
+        deviceFeatures.shaderStorageBufferArrayDynamicIndexing = VK_TRUE;
+        featureChain = &enabledIndexingFeatures;
+    }
+    if (timelineSemaphoreFeature_)
+    {
+        enabledTimelineFeatures.pNext = const_cast<void *>(featureChain);
+        featureChain = &enabledTimelineFeatures;
+    }
+    createInfo.pNext = featureChain;
+
+    if (supportsBindless_)
+    {
+        auto getPhysicalDeviceProperties2 = reinterpret_cast<PFN_vkGetPhysicalDeviceProperties2KHR>(
+            vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceProperties2KHR"));
+        descriptorIndexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+        VkPhysicalDeviceProperties2 properties2{};
+        properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties2.pNext = &descriptorIndexingProperties;
+        getPhysicalDeviceProperties2(physicalDevice, &properties2);
+        descriptorIndexingProperties.pNext = nullptr;
+    }
+
     createInfo.pEnabledFeatures = &deviceFeatures;
-    createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-    createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+    createInfo.ppEnabledExtensionNames = extensions.data();
 
     // might not really be necessary anymore because device specific validation layers
     // have been deprecated
@@ -215,6 +346,101 @@ void LveDevice::createLogicalDevice()
 
     vkGetDeviceQueue(device_, indices.graphicsFamily, 0, &graphicsQueue_);
     vkGetDeviceQueue(device_, indices.presentFamily, 0, &presentQueue_);
+    transferQueue_ = graphicsQueue_;
+    if (indices.transferFamilyHasValue)
+    {
+        vkGetDeviceQueue(device_, indices.transferFamily, 0, &transferQueue_);
+    }
+    queueFamilyIndices_ = indices;
+
+    memoryAllocator_ = std::make_unique<LveMemoryAllocator>(device_, physicalDevice);
+
+    // The allocator takes the first memory type with the flags, so that type's heap decides.
+    const VkPhysicalDeviceMemoryProperties &memoryProperties = memoryAllocator_->getMemoryProperties();
+    const VkMemoryPropertyFlags directFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+    {
+        if ((memoryProperties.memoryTypes[i].propertyFlags & directFlags) == directFlags)
+        {
+            uint32_t heapIndex = memoryProperties.memoryTypes[i].heapIndex;
+            supportsDirectUpload_ = memoryProperties.memoryHeaps[heapIndex].size >= MIN_DIRECT_UPLOAD_HEAP_SIZE;
+            break;
+        }
+    }
+
+    // VK_KHR_get_physical_device_properties2 is an instance extension, so this is loaded from the instance.
+    if (isExtensionEnabled(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME))
+    {
+        getPhysicalDeviceMemoryProperties2_ = reinterpret_cast<PFN_vkGetPhysicalDeviceMemoryProperties2KHR>(
+            vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceMemoryProperties2KHR"));
+    }
+
+    if (isExtensionEnabled(VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME))
+    {
+        createDescriptorUpdateTemplate = reinterpret_cast<PFN_vkCreateDescriptorUpdateTemplateKHR>(
+            vkGetDeviceProcAddr(device_, "vkCreateDescriptorUpdateTemplateKHR"));
+        destroyDescriptorUpdateTemplate = reinterpret_cast<PFN_vkDestroyDescriptorUpdateTemplateKHR>(
+            vkGetDeviceProcAddr(device_, "vkDestroyDescriptorUpdateTemplateKHR"));
+        updateDescriptorSetWithTemplate = reinterpret_cast<PFN_vkUpdateDescriptorSetWithTemplateKHR>(
+            vkGetDeviceProcAddr(device_, "vkUpdateDescriptorSetWithTemplateKHR"));
+    }
+    if (isExtensionEnabled(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME))
+    {
+        cmdPushDescriptorSet = reinterpret_cast<PFN_vkCmdPushDescriptorSetKHR>(
+            vkGetDeviceProcAddr(device_, "vkCmdPushDescriptorSetKHR"));
+        
+        // Only defined together with update templates.
+        if (createDescriptorUpdateTemplate != nullptr)
+        {
+            cmdPushDescriptorSetWithTemplate = reinterpret_cast<PFN_vkCmdPushDescriptorSetWithTemplateKHR>(
+                vkGetDeviceProcAddr(device_, "vkCmdPushDescriptorSetWithTemplateKHR"));
+        }
+    }
+}
+
+VkMemoryPropertyFlags LveDevice::hostWrittenMemoryProperties() const
+{
+    if (useDirectUpload())
+    {
+        return VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+    }
+    return VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+}
+
+bool LveDevice::isExtensionEnabled(const char *extensionName) const
+{
+    return enabledExtensions_.count(extensionName) > 0;
+}
+
+LveMemoryStatistics LveDevice::getMemoryStatistics()
+{
+    LveMemoryStatistics statistics{};
+    statistics.allocator = memoryAllocator_->getStatistics();
+    statistics.staging = stagingPool_->getStatistics();
+
+    const VkPhysicalDeviceMemoryProperties &memoryProperties = memoryAllocator_->getMemoryProperties();
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budget{};
+    budget.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+    if (getPhysicalDeviceMemoryProperties2_ != nullptr)
+    {
+        VkPhysicalDeviceMemoryProperties2 properties2{};
+        properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+        properties2.pNext = &budget;
+        getPhysicalDeviceMemoryProperties2_(physicalDevice, &properties2);
+        statistics.budgetExtension = true;
+    }
+
+    for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++)
+    {
+        LveMemoryStatistics::Heap heap{};
+        heap.size = memoryProperties.memoryHeaps[i].size;
+        heap.flags = memoryProperties.memoryHeaps[i].flags;
+        heap.reservedBytes = statistics.allocator.heapReservedBytes[i];
+        heap.budget = statistics.budgetExtension ? budget.heapBudget[i] : heap.size;
+        heap.usage = statistics.budgetExtension ? budget.heapUsage[i] : heap.reservedBytes;
+        statistics.heaps.push_back(heap);
+    }
+    return statistics;
 }
 
 void LveDevice::createCommandPool()
@@ -231,6 +457,17 @@ void LveDevice::createCommandPool()
     {
         throw std::runtime_error("failed to create command pool!");
     }
+
+    transferCommandPool = commandPool;
+    if (hasDedicatedTransferQueue())
+    {
+        poolInfo.queueFamilyIndex = queueFamilyIndices_.transferFamily;
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        if (vkCreateCommandPool(device_, &poolInfo, nullptr, &transferCommandPool) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create transfer command pool!");
+        }
+    }
 }
 
 void LveDevice::createSurface() { window.createWindowSurface(instance, &surface_); }
@@ -390,21 +627,31 @@ QueueFamilyIndices LveDevice::findQueueFamilies(VkPhysicalDevice device)
     int i = 0;
     for (const auto &queueFamily : queueFamilies)
     {
-        if (queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)
-        {
-            indices.graphicsFamily = i;
-            indices.graphicsFamilyHasValue = true;
-        }
-        VkBool32 presentSupport = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_, &presentSupport);
-        if (queueFamily.queueCount > 0 && presentSupport)
+        if (!indices.isComplete())
         {
-            indices.presentFamily = i;
-            indices.presentFamilyHasValue = true;
+            if (queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)
+            {
+                indices.graphicsFamily = i;
+                indices.graphicsFamilyHasValue = true;
+            }
+            VkBool32 presentSupport = false;
+            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_, &presentSupport);
+            if (queueFamily.queueCount > 0 && presentSupport)
+            {
+                indices.presentFamily = i;
+                indices.presentFamilyHasValue = true;
+            }
         }
-        if (indices.isComplete())
+        
+        // Prefer a family without compute as well: that is usually the copy engine.
+        bool transferOnly = queueFamily.queueCount > 0 &&
+            (queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT) &&
+            !(queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT);
+        if (transferOnly &&
+            (!indices.transferFamilyHasValue || !(queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT)))
         {
-            break;
+            indices.transferFamily = i;
+            indices.transferFamilyHasValue = true;
         }
         i++;
     }
@@ -481,13 +728,14 @@ uint32_t LveDevice::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags pr
 }
 
 // Device memory has two parts, a VkBuffer and a VkDeviceMemory.
-// createBuffer() initializes &buffer and &bufferMemory.
+// createBuffer() initializes &buffer and &allocation, a range of a VkDeviceMemory block.
 void LveDevice::createBuffer(
     VkDeviceSize size,
     VkBufferUsageFlags usage,
     VkMemoryPropertyFlags properties,
     VkBuffer &buffer,                   // attached to device memory
-    VkDeviceMemory &bufferMemory)       // device memory
+    LveAllocation &allocation,          // device memory range
+    LveMemoryCategory category)
 {
     VkBufferCreateInfo bufferCreateInfo{};
     bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -503,32 +751,370 @@ void LveDevice::createBuffer(
     VkMemoryRequirements memRequirements;
     vkGetBufferMemoryRequirements(device_, buffer, &memRequirements);
 
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+    try
+    {
+        allocation = memoryAllocator_->allocate(memRequirements, properties, category);
+    }
+    catch (...)
+    {
+        vkDestroyBuffer(device_, buffer, nullptr);
+        buffer = VK_NULL_HANDLE;
+        throw;
+    }
+
+    // buffer is the buffer attached to the allocation
+    // allocation is the range of a VkDeviceMemory block that holds the buffer
+    vkBindBufferMemory(device_, buffer, allocation.memory, allocation.offset);
+}
+
+void LveDevice::createTimelineSemaphore()
+{
+    if (!timelineSemaphoreFeature_)
+    {
+        return;
+    }
+
+    VkSemaphoreTypeCreateInfo typeInfo{};
+    typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &typeInfo;
+    if (vkCreateSemaphore(device_, &semaphoreInfo, nullptr, &timelineSemaphore_) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create timeline semaphore!");
+    }
+
+    getSemaphoreCounterValue_ = reinterpret_cast<PFN_vkGetSemaphoreCounterValueKHR>(
+        vkGetDeviceProcAddr(device_, "vkGetSemaphoreCounterValueKHR"));
+    waitSemaphores_ = reinterpret_cast<PFN_vkWaitSemaphoresKHR>(
+        vkGetDeviceProcAddr(device_, "vkWaitSemaphoresKHR"));
+}
+
+void LveDevice::createPipelineCache()
+{
+    std::vector<char> initialData = readPipelineCacheFile();
+
+    VkPipelineCacheCreateInfo pipelineCacheInfo{};
+    pipelineCacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    pipelineCacheInfo.initialDataSize = initialData.size();
+    pipelineCacheInfo.pInitialData = initialData.empty() ? nullptr : initialData.data();
+    if (vkCreatePipelineCache(device_, &pipelineCacheInfo, nullptr, &pipelineCache_) == VK_SUCCESS)
+    {
+        pipelineCacheLoaded_ = !initialData.empty();
+        return;
+    }
+
+    // Drivers should ignore data they cannot use, but some reject it instead.
+    pipelineCacheInfo.initialDataSize = 0;
+    pipelineCacheInfo.pInitialData = nullptr;
+    if (vkCreatePipelineCache(device_, &pipelineCacheInfo, nullptr, &pipelineCache_) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create pipeline cache!");
+    }
+}
+
+// Layout of VkPipelineCacheHeaderVersionOne: headerSize, headerVersion, vendorID, deviceID as 32 bit
+// little endian values, then the pipelineCacheUUID.
+std::vector<char> LveDevice::readPipelineCacheFile() const
+{
+    if (pipelineCachePath_.empty())
+    {
+        return {};
+    }
+    std::ifstream file{pipelineCachePath_, std::ios::binary | std::ios::ate};
+    if (!file.is_open())
+    {
+        return {};
+    }
+    std::vector<char> data(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(data.data(), static_cast<std::streamsize>(data.size()));
+
+    const size_t headerSize = 4 * sizeof(uint32_t) + VK_UUID_SIZE;
+    if (!file.good() || data.size() < headerSize)
+    {
+        return {};
+    }
+    uint32_t header[4];
+    for (int i = 0; i < 4; i++)
+    {
+        const auto *bytes = reinterpret_cast<const unsigned char *>(data.data()) + i * 4;
+        header[i] = bytes[0] | bytes[1] << 8 | bytes[2] << 16 | static_cast<uint32_t>(bytes[3]) << 24;
+    }
+    if (header[0] < headerSize ||
+        header[1] != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+        header[2] != properties.vendorID ||
+        header[3] != properties.deviceID ||
+        memcmp(data.data() + 4 * sizeof(uint32_t), properties.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+    {
+        return {};
+    }
+    return data;
+}
+
+bool LveDevice::savePipelineCache()
+{
+    if (pipelineCachePath_.empty() || pipelineCache_ == VK_NULL_HANDLE)
+    {
+        return false;
+    }
+    size_t size = 0;
+    if (vkGetPipelineCacheData(device_, pipelineCache_, &size, nullptr) != VK_SUCCESS || size == 0)
+    {
+        return false;
+    }
+    std::vector<char> data(size);
+    if (vkGetPipelineCacheData(device_, pipelineCache_, &size, data.data()) != VK_SUCCESS)
+    {
+        return false;
+    }
+
+    std::string tempPath = pipelineCachePath_ + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+        {
+            return false;
+        }
+        file.write(data.data(), static_cast<std::streamsize>(size));
+        if (!file.good())
+        {
+            file.close();
+            std::remove(tempPath.c_str());
+            return false;
+        }
+    }
+    if (std::rename(tempPath.c_str(), pipelineCachePath_.c_str()) != 0)
+    {
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+LveSubmission LveDevice::submit(const VkSubmitInfo &submitInfo)
+{
+    return submitToGraphicsQueue(submitInfo, VK_NULL_HANDLE);
+}
+
+LveSubmission LveDevice::submitToGraphicsQueue(VkSubmitInfo submitInfo, VkCommandBuffer singleTimeCommandBuffer)
+{
+    assert(submitInfo.pNext == nullptr && "Submissions through the device must not have a pNext chain");
+    retireSubmissions();
+
+    const uint64_t value = nextSubmissionValue_;
+    VkFence fence = VK_NULL_HANDLE;
+
+    // The timeline is signaled after the caller's semaphores. Binary semaphores ignore their values,
+    // but every signal semaphore needs one.
+    std::vector<VkSemaphore> signalSemaphores{};
+    std::vector<uint64_t> signalValues{};
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    if (usesTimelineSemaphores())
+    {
+        signalSemaphores.assign(
+            submitInfo.pSignalSemaphores,
+            submitInfo.pSignalSemaphores + submitInfo.signalSemaphoreCount);
+        signalSemaphores.push_back(timelineSemaphore_);
+        signalValues.assign(signalSemaphores.size(), 0);
+        signalValues.back() = value;
+
+        timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timelineInfo.signalSemaphoreValueCount = static_cast<uint32_t>(signalValues.size());
+        timelineInfo.pSignalSemaphoreValues = signalValues.data();
+        submitInfo.pNext = &timelineInfo;
+        submitInfo.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
+        submitInfo.pSignalSemaphores = signalSemaphores.data();
+    }
+    else if (!freeFences_.empty())
+    {
+        fence = freeFences_.back();
+        freeFences_.pop_back();
+    }
+    else
+    {
+        VkFenceCreateInfo fenceInfo{};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        if (vkCreateFence(device_, &fenceInfo, nullptr, &fence) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create submission fence!");
+        }
+    }
+
+    if (vkQueueSubmit(graphicsQueue_, 1, &submitInfo, fence) != VK_SUCCESS)
+    {
+        if (fence != VK_NULL_HANDLE)
+        {
+            freeFences_.push_back(fence);
+        }
+        if (singleTimeCommandBuffer != VK_NULL_HANDLE)
+        {
+            freeCommandBuffers_.push_back(singleTimeCommandBuffer);
+        }
+        throw std::runtime_error("failed to submit to the graphics queue!");
+    }
+
+    nextSubmissionValue_++;
+    if (fence != VK_NULL_HANDLE || singleTimeCommandBuffer != VK_NULL_HANDLE)
+    {
+        pendingSubmissions_.push_back({value, singleTimeCommandBuffer, fence});
+    }
+    return {value};
+}
+
+bool LveDevice::isComplete(LveSubmission submission)
+{
+    if (submission.value > completedSubmissionValue_)
+    {
+        retireSubmissions();
+    }
+    return submission.value <= completedSubmissionValue_;
+}
 
-    if (vkAllocateMemory(device_, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS)
+void LveDevice::wait(LveSubmission submission)
+{
+    if (submission.value <= completedSubmissionValue_)
     {
-        throw std::runtime_error("failed to allocate vertex buffer memory!");
+        return;
     }
 
-    // device owns the buffer and bufferMemory
-    // buffer is the buffer attached to the bufferMemory
-    // bufferMemory is the VkDeviceMemory object describing the device memory to attach
-    vkBindBufferMemory(device_, buffer, bufferMemory, 0);
+    if (usesTimelineSemaphores())
+    {
+        VkSemaphoreWaitInfo waitInfo{};
+        waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        waitInfo.semaphoreCount = 1;
+        waitInfo.pSemaphores = &timelineSemaphore_;
+        waitInfo.pValues = &submission.value;
+        waitSemaphores_(device_, &waitInfo, UINT64_MAX);
+    }
+    else
+    {
+        // Waits for the earlier fences as well, so every submission up to this one can be retired.
+        std::vector<VkFence> fences{};
+        for (const PendingSubmission &pending : pendingSubmissions_)
+        {
+            if (pending.value > submission.value)
+            {
+                break;
+            }
+            fences.push_back(pending.fence);
+        }
+        if (!fences.empty())
+        {
+            vkWaitForFences(device_, static_cast<uint32_t>(fences.size()), fences.data(), VK_TRUE, UINT64_MAX);
+        }
+    }
+    retireSubmissions();
+}
+
+void LveDevice::deferDestruction(std::function<void()> destroy)
+{
+    if (nextSubmissionValue_ - 1 <= completedSubmissionValue_)
+    {
+        destroy();
+        return;
+    }
+    deferredDestructions_.push_back({nextSubmissionValue_ - 1, std::move(destroy)});
+}
+
+uint32_t LveDevice::addDestructionListener(std::function<void(uint64_t handle)> listener)
+{
+    std::lock_guard<std::mutex> lock{destructionListenersMutex_};
+    uint32_t listenerId = nextDestructionListenerId_++;
+    destructionListeners_.emplace_back(listenerId, std::move(listener));
+    return listenerId;
+}
+
+void LveDevice::removeDestructionListener(uint32_t listenerId)
+{
+    std::lock_guard<std::mutex> lock{destructionListenersMutex_};
+    for (auto it = destructionListeners_.begin(); it != destructionListeners_.end(); ++it)
+    {
+        if (it->first == listenerId)
+        {
+            destructionListeners_.erase(it);
+            return;
+        }
+    }
+}
+
+void LveDevice::notifyDestroyed(uint64_t handle)
+{
+    std::lock_guard<std::mutex> lock{destructionListenersMutex_};
+    for (auto &listener : destructionListeners_)
+    {
+        listener.second(handle);
+    }
+}
+
+// Submissions to the one queue complete in order, so they are retired from the front.
+void LveDevice::retireSubmissions()
+{
+    if (usesTimelineSemaphores())
+    {
+        getSemaphoreCounterValue_(device_, timelineSemaphore_, &completedSubmissionValue_);
+    }
+
+    while (!pendingSubmissions_.empty())
+    {
+        PendingSubmission &pending = pendingSubmissions_.front();
+        if (pending.fence != VK_NULL_HANDLE)
+        {
+            if (vkGetFenceStatus(device_, pending.fence) != VK_SUCCESS)
+            {
+                break;
+            }
+            vkResetFences(device_, 1, &pending.fence);
+            freeFences_.push_back(pending.fence);
+            completedSubmissionValue_ = pending.value;
+        }
+        else if (pending.value > completedSubmissionValue_)
+        {
+            break;
+        }
+        if (pending.commandBuffer != VK_NULL_HANDLE)
+        {
+            freeCommandBuffers_.push_back(pending.commandBuffer);
+        }
+        pendingSubmissions_.pop_front();
+    }
+
+    // A destruction may defer another one, so each is removed before it runs.
+    while (!deferredDestructions_.empty() && deferredDestructions_.front().value <= completedSubmissionValue_)
+    {
+        std::function<void()> destroy = std::move(deferredDestructions_.front().destroy);
+        deferredDestructions_.pop_front();
+        destroy();
+    }
 }
 
 VkCommandBuffer LveDevice::beginSingleTimeCommands()
 {
-    VkCommandBufferAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandPool = commandPool;
-    allocInfo.commandBufferCount = 1;
+    retireSubmissions();
 
     VkCommandBuffer commandBuffer;
-    vkAllocateCommandBuffers(device_, &allocInfo, &commandBuffer);
+    if (!freeCommandBuffers_.empty())
+    {
+        // The pool allows resetting single command buffers; beginning one resets it implicitly.
+        commandBuffer = freeCommandBuffers_.back();
+        freeCommandBuffers_.pop_back();
+    }
+    else
+    {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandPool = commandPool;
+        allocInfo.commandBufferCount = 1;
+
+        if (vkAllocateCommandBuffers(device_, &allocInfo, &commandBuffer) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to allocate single time command buffer!");
+        }
+    }
 
     VkCommandBufferBeginInfo beginInfo{};
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -539,7 +1125,10 @@ VkCommandBuffer LveDevice::beginSingleTimeCommands()
     return commandBuffer;
 }
 
-void LveDevice::endSingleTimeCommands(VkCommandBuffer commandBuffer)
+LveSubmission LveDevice::submitSingleTimeCommands(
+    VkCommandBuffer commandBuffer,
+    VkSemaphore waitSemaphore,
+    VkPipelineStageFlags waitStage)
 {
     vkEndCommandBuffer(commandBuffer);
 
@@ -547,14 +1136,21 @@ void LveDevice::endSingleTimeCommands(VkCommandBuffer commandBuffer)
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers = &commandBuffer;
+    if (waitSemaphore != VK_NULL_HANDLE)
+    {
+        submitInfo.waitSemaphoreCount = 1;
+        submitInfo.pWaitSemaphores = &waitSemaphore;
+        submitInfo.pWaitDstStageMask = &waitStage;
+    }
+    return submitToGraphicsQueue(submitInfo, commandBuffer);
+}
 
-    vkQueueSubmit(graphicsQueue_, 1, &submitInfo, VK_NULL_HANDLE);
-    vkQueueWaitIdle(graphicsQueue_);
-
-    vkFreeCommandBuffers(device_, commandPool, 1, &commandBuffer);
+void LveDevice::endSingleTimeCommands(VkCommandBuffer commandBuffer)
+{
+    wait(submitSingleTimeCommands(commandBuffer));
 }
 
-void LveDevice::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size)
+LveSubmission LveDevice::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size)
 {
     VkCommandBuffer commandBuffer = beginSingleTimeCommands();
 
@@ -564,10 +1160,10 @@ void LveDevice::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize
     copyRegion.size = size;
     vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
 
-    endSingleTimeCommands(commandBuffer);
+    return submitSingleTimeCommands(commandBuffer);
 }
 
-void LveDevice::copyBufferToImage(
+LveSubmission LveDevice::copyBufferToImage(
     VkBuffer buffer,
     VkImage image,
     uint32_t width,
@@ -596,14 +1192,15 @@ void LveDevice::copyBufferToImage(
         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
         1,
         &region);
-    endSingleTimeCommands(commandBuffer);
+    return submitSingleTimeCommands(commandBuffer);
 }
 
 void LveDevice::createImageWithInfo(
     const VkImageCreateInfo &imageInfo,
     VkMemoryPropertyFlags properties,
     VkImage &image,
-    VkDeviceMemory &imageMemory)
+    LveAllocation &allocation,
+    LveMemoryCategory category)
 {
     if (vkCreateImage(device_, &imageInfo, nullptr, &image) != VK_SUCCESS)
     {
@@ -613,17 +1210,22 @@ void LveDevice::createImageWithInfo(
     VkMemoryRequirements memRequirements;
     vkGetImageMemoryRequirements(device_, image, &memRequirements);
 
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-
-    if (vkAllocateMemory(device_, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS)
+    try
+    {
+        allocation = memoryAllocator_->allocate(
+            memRequirements,
+            properties,
+            category,
+            imageInfo.tiling == VK_IMAGE_TILING_LINEAR);
+    }
+    catch (...)
     {
-        throw std::runtime_error("failed to allocate image memory!");
+        vkDestroyImage(device_, image, nullptr);
+        image = VK_NULL_HANDLE;
+        throw;
     }
 
-    if (vkBindImageMemory(device_, image, imageMemory, 0) != VK_SUCCESS)
+    if (vkBindImageMemory(device_, image, allocation.memory, allocation.offset) != VK_SUCCESS)
     {
         throw std::runtime_error("failed to bind image memory!");
     }
@@ -1,13 +1,22 @@
 #pragma once
 
+#include "lve_memory_allocator.hpp"
 #include "lve_window.hpp"
 
 // std lib headers
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
 #include <string>
 #include <vector>
 
 namespace lve {
 
+class LveStagingPool;
+struct LveMemoryStatistics;
+
 struct SwapChainSupportDetails
 {
     VkSurfaceCapabilitiesKHR capabilities;
@@ -15,12 +24,23 @@ struct SwapChainSupportDetails
     std::vector<VkPresentModeKHR> presentModes;
 };
 
+// Completion token of a graphics queue submission made through LveDevice. Values grow with every
+// submission; with timeline semaphores they are the values the device's timeline is signaled to.
+// The default token is always complete.
+struct LveSubmission
+{
+    uint64_t value = 0;
+};
+
 struct QueueFamilyIndices
 {
     uint32_t graphicsFamily;
     uint32_t presentFamily;
+    // A family that supports transfers but not graphics, if the device has one.
+    uint32_t transferFamily;
     bool graphicsFamilyHasValue = false;
     bool presentFamilyHasValue = false;
+    bool transferFamilyHasValue = false;
     bool isComplete() { return graphicsFamilyHasValue && presentFamilyHasValue; }
 };
 
@@ -34,7 +54,17 @@ class LveDevice
         const bool enableValidationLayers = true;
     #endif
 
-    LveDevice(LveWindow &window);
+    static constexpr const char *DEFAULT_PIPELINE_CACHE_PATH = "lve_pipeline_cache.bin";
+
+    // Timeline semaphores are used where the device supports them, unless useTimelineSemaphores is
+    // false; then every submission gets a fence instead. The pipeline cache is loaded from and
+    // saved to pipelineCachePath; an empty path keeps it in memory only.
+    LveDevice(
+        LveWindow &window,
+        bool useTimelineSemaphores = true,
+        std::string pipelineCachePath = DEFAULT_PIPELINE_CACHE_PATH);
+    
+    // Waits for the device to be idle, runs every deferred destruction and saves the pipeline cache.
     ~LveDevice();
 
     // Not copyable or movable
@@ -48,6 +78,18 @@ class LveDevice
     VkSurfaceKHR surface() { return surface_; }
     VkQueue graphicsQueue() { return graphicsQueue_; }
     VkQueue presentQueue() { return presentQueue_; }
+    
+    // The dedicated transfer queue and a command pool for it, or the graphics queue and pool when the
+    // device has no transfer-only family. Uploads on a dedicated queue must hand buffer ownership to
+    // the graphics family.
+    bool hasDedicatedTransferQueue() { return transferQueue_ != graphicsQueue_; }
+    VkQueue transferQueue() { return transferQueue_; }
+    VkCommandPool getTransferCommandPool() { return transferCommandPool; }
+    uint32_t graphicsQueueFamily() { return queueFamilyIndices_.graphicsFamily; }
+    uint32_t transferQueueFamily()
+    {
+        return hasDedicatedTransferQueue() ? queueFamilyIndices_.transferFamily : queueFamilyIndices_.graphicsFamily;
+    }
 
     SwapChainSupportDetails getSwapChainSupport()
     {
@@ -67,30 +109,139 @@ class LveDevice
         VkFormatFeatureFlags features);
 
   // Buffer Helper Functions
+    // The buffer's memory is sub-allocated; release it with memoryAllocator().free(allocation).
     void createBuffer(
       VkDeviceSize size,
       VkBufferUsageFlags usage,
       VkMemoryPropertyFlags properties,
       VkBuffer &buffer,
-      VkDeviceMemory &bufferMemory);
+      LveAllocation &allocation,
+      LveMemoryCategory category = LveMemoryCategory::Other);
+    
+    LveMemoryAllocator &memoryAllocator() { return *memoryAllocator_; }
+    
+    // DEVICE_LOCAL | HOST_VISIBLE memory on a heap of at least MIN_DIRECT_UPLOAD_HEAP_SIZE bytes, as
+    // with resizable BAR or on integrated GPUs. Buffers there are written through their mapping
+    // instead of being copied from staging memory. The 256 MiB BAR window of other discrete GPUs is
+    // too small to hold models, so it does not count.
+    static constexpr VkDeviceSize MIN_DIRECT_UPLOAD_HEAP_SIZE = 1024ull * 1024 * 1024;
+    bool supportsDirectUpload() const { return supportsDirectUpload_; }
+    
+    // On by default where supported; turned off, uploads go through staging memory everywhere.
+    void setDirectUploadEnabled(bool enabled) { directUploadEnabled_ = enabled; }
+    bool useDirectUpload() const { return supportsDirectUpload_ && directUploadEnabled_; }
     
+    // Memory for buffers the host writes and the device reads, e.g. every frame: device local as
+    // well when useDirectUpload(), otherwise only host visible.
+    VkMemoryPropertyFlags hostWrittenMemoryProperties() const;
+    
+    // Recycled staging buffers for uploads.
+    LveStagingPool &stagingPool() { return *stagingPool_; }
+    
+    // Every graphics queue submission goes through the device and is signaled on one timeline, so
+    // the CPU waits on the exact submission it needs and frames, uploads and deferred destruction
+    // share one notion of completion. Without timeline semaphores each submission gets a fence from a
+    // recycled set. Render thread only.
+    bool usesTimelineSemaphores() const { return timelineSemaphore_ != VK_NULL_HANDLE; }
+    
+    // Submits to the graphics queue and returns the submission's token. submitInfo may wait on and
+    // signal binary semaphores, but must not have a pNext chain.
+    LveSubmission submit(const VkSubmitInfo &submitInfo);
+    
+    // The most recent submission; the default token if there was none.
+    LveSubmission lastSubmission() const { return {nextSubmissionValue_ - 1}; }
+    
+    bool isComplete(LveSubmission submission);
+    void wait(LveSubmission submission);
+    
+    // Runs destroy once every submission made so far has completed, so command buffers that were
+    // submitted may still use what it destroys. Deferred destructions run when completions are
+    // noticed, e.g. in wait(), isComplete() and submissions.
+    void deferDestruction(std::function<void()> destroy);
+    
+    // Listeners get the handle of every buffer, image view and sampler the engine destroys, right
+    // before it is destroyed and on the destroying thread, so caches keyed by handles can drop what
+    // refers to it. Handles are compared as handleValue(). Thread safe.
+    uint32_t addDestructionListener(std::function<void(uint64_t handle)> listener);
+    void removeDestructionListener(uint32_t listenerId);
+    void notifyDestroyed(uint64_t handle);
+    
+    // Non-dispatchable handles are pointers or 64 bit integers, depending on the platform.
+    template <typename Handle>
+    static uint64_t handleValue(Handle handle) { return reinterpret_cast<uint64_t>(handle); }
+    
+    // One time commands on the graphics queue. Command buffers are recycled once their submission
+    // has completed.
     VkCommandBuffer beginSingleTimeCommands();
+    
+    // Submits without waiting, optionally after waitSemaphore is signaled at waitStage. Poll the
+    // returned token with isComplete() or block on it with wait().
+    LveSubmission submitSingleTimeCommands(
+        VkCommandBuffer commandBuffer,
+        VkSemaphore waitSemaphore = VK_NULL_HANDLE,
+        VkPipelineStageFlags waitStage = 0);
+    
+    // Submits and waits for this submission only; other work on the queue keeps running.
     void endSingleTimeCommands(VkCommandBuffer commandBuffer);
-    void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
-    void copyBufferToImage(
+    
+    // Asynchronous; wait on the returned token before reusing srcBuffer or reading the destination
+    // from the host. Later submissions on the graphics queue still need a barrier to read it.
+    LveSubmission copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
+    LveSubmission copyBufferToImage(
         VkBuffer buffer,
         VkImage image,
         uint32_t width,
         uint32_t height,
         uint32_t layerCount);
 
+    // Like createBuffer(), the image's memory comes from memoryAllocator().
     void createImageWithInfo(
         const VkImageCreateInfo &imageInfo,
         VkMemoryPropertyFlags properties,
         VkImage &image,
-        VkDeviceMemory &imageMemory);
+        LveAllocation &allocation,
+        LveMemoryCategory category = LveMemoryCategory::Other);
+    
+    // Shared by every pipeline the engine creates, so the driver compiles each shader combination
+    // once. Its initial data comes from the cache file if the file's header matches this device's
+    // vendor, device and pipelineCacheUUID; a driver update or another GPU starts it empty.
+    VkPipelineCache pipelineCache() const { return pipelineCache_; }
+    
+    // Whether the pipeline cache started from the cache file.
+    bool pipelineCacheLoaded() const { return pipelineCacheLoaded_; }
+    
+    // Writes the pipeline cache to a temporary file and renames it over the cache file, so a crash
+    // never leaves a half written cache. Called by the destructor; failing to save is not an error.
+    bool savePipelineCache();
+    
+    // Optional device extensions are enabled when the physical device supports them.
+    bool isExtensionEnabled(const char *extensionName) const;
+    
+    // Per heap budget and usage, and the engine's allocations by category. Cheap enough to query
+    // every frame. Defined in lve_memory_statistics.hpp.
+    LveMemoryStatistics getMemoryStatistics();
+    
+    // Descriptor indexing with runtime sized, partially bound, variable count arrays of storage
+    // buffers and sampled images that are updated after binding and indexed non-uniformly, as
+    // LveBindlessDescriptors needs. Only through VK_EXT_descriptor_indexing and VK_KHR_maintenance3;
+    // the instance targets Vulkan 1.0, so the core 1.2 features are not used. Storage buffer arrays
+    // are indexed dynamically as well. descriptorIndexingProperties holds the limits of
+    // update-after-bind sets where it is supported.
+    bool supportsBindless() const { return supportsBindless_; }
+
+    // VK_KHR_descriptor_update_template and VK_KHR_push_descriptor. Their entry points below are
+    // null where the extension is not enabled.
+    bool supportsUpdateTemplates() const { return createDescriptorUpdateTemplate != nullptr; }
+    bool supportsPushDescriptors() const { return cmdPushDescriptorSet != nullptr; }
 
     VkPhysicalDeviceProperties properties;
+    VkPhysicalDeviceDescriptorIndexingProperties descriptorIndexingProperties{};
+    
+    PFN_vkCreateDescriptorUpdateTemplateKHR createDescriptorUpdateTemplate = nullptr;
+    PFN_vkDestroyDescriptorUpdateTemplateKHR destroyDescriptorUpdateTemplate = nullptr;
+    PFN_vkUpdateDescriptorSetWithTemplateKHR updateDescriptorSetWithTemplate = nullptr;
+    PFN_vkCmdPushDescriptorSetKHR cmdPushDescriptorSet = nullptr;
+    PFN_vkCmdPushDescriptorSetWithTemplateKHR cmdPushDescriptorSetWithTemplate = nullptr;
 
     private:
     
@@ -100,6 +251,18 @@ class LveDevice
     void pickPhysicalDevice();
     void createLogicalDevice();
     void createCommandPool();
+    void createTimelineSemaphore();
+    void createPipelineCache();
+    
+    // The cache file's data if its VkPipelineCacheHeaderVersionOne matches this device.
+    std::vector<char> readPipelineCacheFile() const;
+    
+    // singleTimeCommandBuffer, if any, is recycled once the submission has completed.
+    LveSubmission submitToGraphicsQueue(VkSubmitInfo submitInfo, VkCommandBuffer singleTimeCommandBuffer);
+    
+    // Notes which submissions completed, recycles their command buffers and fences and runs the
+    // destructions deferred until then.
+    void retireSubmissions();
 
     // helper functions
     bool isDeviceSuitable(VkPhysicalDevice device);
@@ -116,17 +279,76 @@ class LveDevice
     VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
     LveWindow &window;
     VkCommandPool commandPool;
+    VkCommandPool transferCommandPool;
+    QueueFamilyIndices queueFamilyIndices_;
 
     VkDevice device_;
+    std::unique_ptr<LveMemoryAllocator> memoryAllocator_;
+    std::unique_ptr<LveStagingPool> stagingPool_;
+    bool supportsDirectUpload_ = false;
+    bool directUploadEnabled_ = true;
+    
+    // Set while creating the logical device; the semaphore exists only if it was.
+    bool useTimelineSemaphores_;
+    bool timelineSemaphoreFeature_ = false;
+    bool supportsBindless_ = false;
+    VkSemaphore timelineSemaphore_ = VK_NULL_HANDLE;
+    PFN_vkGetSemaphoreCounterValueKHR getSemaphoreCounterValue_ = nullptr;
+    PFN_vkWaitSemaphoresKHR waitSemaphores_ = nullptr;
+    
+    // Submissions with a fence or a single time command buffer, in submission order, and what
+    // completed ones left for reuse. With timeline semaphores only single time submissions are kept.
+    struct PendingSubmission
+    {
+        uint64_t value;
+        VkCommandBuffer commandBuffer;
+        VkFence fence;
+    };
+    std::deque<PendingSubmission> pendingSubmissions_;
+    std::vector<VkCommandBuffer> freeCommandBuffers_;
+    std::vector<VkFence> freeFences_;
+    
+    struct DeferredDestruction
+    {
+        uint64_t value;
+        std::function<void()> destroy;
+    };
+    std::deque<DeferredDestruction> deferredDestructions_;
+    
+    std::string pipelineCachePath_;
+    VkPipelineCache pipelineCache_ = VK_NULL_HANDLE;
+    bool pipelineCacheLoaded_ = false;
+    
+    std::mutex destructionListenersMutex_;
+    std::vector<std::pair<uint32_t, std::function<void(uint64_t)>>> destructionListeners_;
+    uint32_t nextDestructionListenerId_ = 0;
+    
+    uint64_t nextSubmissionValue_ = 1;
+    uint64_t completedSubmissionValue_ = 0;
     VkSurfaceKHR surface_;
     VkQueue graphicsQueue_;
     VkQueue presentQueue_;
+    VkQueue transferQueue_;
 
     const std::vector<const char *> validationLayers = {"VK_LAYER_KHRONOS_validation"};
     const std::vector<const char *> deviceExtensions =
     {
-        VK_KHR_SWAPCHAIN_EXTENSION_NAME,
-        "VK_KHR_portability_subset"}; // add "VK_KHR_portability_subset as macOS fix
+        VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+    
+    // Enabled only if supported; check with isExtensionEnabled().
+    // VK_KHR_portability_subset must be enabled where it exists (macOS fix), and only there.
+    const std::vector<const char *> optionalDeviceExtensions =
+    {
+        "VK_KHR_portability_subset",
+        VK_EXT_MEMORY_BUDGET_EXTENSION_NAME,
+        VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME,
+        VK_KHR_MAINTENANCE3_EXTENSION_NAME,
+        VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME,
+        VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME,
+        VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME};
+    std::set<std::string> enabledExtensions_;
+    
+    PFN_vkGetPhysicalDeviceMemoryProperties2KHR getPhysicalDeviceMemoryProperties2_ = nullptr;
     };
 
 }  // namespace lve
@@ -0,0 +1,103 @@
+#include "lve_frame_allocator.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace lve
+{
+    LveFrameAllocator::LveFrameAllocator(LveDevice& device, VkDeviceSize frameSize)
+    :   _lveDevice{device}
+    {
+        // Frame regions start on every alignment a slice may need.
+        const VkPhysicalDeviceLimits& limits = device.properties.limits;
+        VkDeviceSize regionAlignment = std::max({
+            limits.minUniformBufferOffsetAlignment,
+            limits.minStorageBufferOffsetAlignment,
+            limits.nonCoherentAtomSize,
+            VkDeviceSize{16}});
+        _frameSize = (frameSize + regionAlignment - 1) / regionAlignment * regionAlignment;
+
+        _buffer = std::make_unique<LveBuffer>(
+            device,
+            _frameSize,
+            LveSwapChain::MAX_FRAMES_IN_FLIGHT,
+            VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT |
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+            VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+            VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
+            VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+            device.hostWrittenMemoryProperties(),
+            1,
+            LveMemoryCategory::Uniforms);
+        if (_buffer->map() != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to map frame allocator buffer!");
+        }
+    }
+
+    void LveFrameAllocator::beginFrame(int frameIndex)
+    {
+        assert(frameIndex >= 0 && frameIndex < LveSwapChain::MAX_FRAMES_IN_FLIGHT && "Invalid frame index");
+        _frameBegin = static_cast<VkDeviceSize>(frameIndex) * _frameSize;
+        _used = 0;
+    }
+
+    LveFrameAllocator::Slice LveFrameAllocator::allocate(VkDeviceSize size, VkDeviceSize alignment)
+    {
+        assert(alignment > 0 && (alignment & (alignment - 1)) == 0 && "Alignment must be a power of two");
+        VkDeviceSize offset = (_used + alignment - 1) & ~(alignment - 1);
+        if (offset + size > _frameSize)
+        {
+            throw std::runtime_error("frame allocator is out of memory!");
+        }
+        _used = offset + size;
+        _peakUsed = std::max(_peakUsed, _used);
+
+        Slice slice{};
+        slice.data = static_cast<char*>(_buffer->getMappedMemory()) + _frameBegin + offset;
+        slice.buffer = _buffer->getBuffer();
+        slice.offset = _frameBegin + offset;
+        slice.size = size;
+        return slice;
+    }
+
+    LveFrameAllocator::Slice LveFrameAllocator::allocateUniform(VkDeviceSize size)
+    {
+        return allocate(size, std::max<VkDeviceSize>(_lveDevice.properties.limits.minUniformBufferOffsetAlignment, 16));
+    }
+
+    LveFrameAllocator::Slice LveFrameAllocator::allocateStorage(VkDeviceSize size)
+    {
+        return allocate(size, std::max<VkDeviceSize>(_lveDevice.properties.limits.minStorageBufferOffsetAlignment, 16));
+    }
+
+    void LveFrameAllocator::flush()
+    {
+        if (_used > 0)
+        {
+            _buffer->flush(_used, _frameBegin);
+        }
+    }
+
+    VkBuffer LveFrameAllocator::getBuffer() const
+    {
+        return _buffer->getBuffer();
+    }
+
+    VkDeviceSize LveFrameAllocator::getFrameSize() const
+    {
+        return _frameSize;
+    }
+
+    VkDeviceSize LveFrameAllocator::getUsedSize() const
+    {
+        return _used;
+    }
+
+    VkDeviceSize LveFrameAllocator::getPeakUsedSize() const
+    {
+        return _peakUsed;
+    }
+}
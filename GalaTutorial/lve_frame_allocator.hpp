@@ -0,0 +1,86 @@
+#ifndef lve_frame_allocator_hpp
+#define lve_frame_allocator_hpp
+
+#pragma once
+
+#include "lve_buffer.hpp"
+#include "lve_device.hpp"
+#include "lve_swap_chain.hpp"
+
+// std
+#include <memory>
+
+namespace lve
+{
+    // Transient per-frame GPU data (uniforms, instance data, indirect commands) as slices of one
+    // persistently mapped host visible buffer, device local as well where the device supports direct
+    // uploads. The buffer holds one region of frameSize bytes per frame in flight; allocating bumps
+    // an offset within the current frame's region, and beginFrame() rewinds it. Nothing is freed
+    // individually.
+    //
+    // Call beginFrame() after LveRenderer::beginFrame() returned a command buffer:
+    // LveSwapChain::acquireNextImage() passed the submission of the frame that last used this frame
+    // index to LveDevice::wait(), so the GPU is done with its region. Call flush() before the frame
+    // is submitted.
+    class LveFrameAllocator
+    {
+        public:
+
+        static constexpr VkDeviceSize DEFAULT_FRAME_SIZE = 4 * 1024 * 1024;
+
+        struct Slice
+        {
+            void*        data;
+            VkBuffer     buffer;
+            VkDeviceSize offset;
+            VkDeviceSize size;
+
+            // For descriptors of type *_DYNAMIC that cover the whole buffer from offset 0.
+            uint32_t dynamicOffset() const { return static_cast<uint32_t>(offset); }
+        };
+
+        explicit LveFrameAllocator(LveDevice& device, VkDeviceSize frameSize = DEFAULT_FRAME_SIZE);
+
+        LveFrameAllocator(const LveFrameAllocator&) = delete;
+        LveFrameAllocator& operator=(const LveFrameAllocator&) = delete;
+
+        void beginFrame(int frameIndex);
+
+        // Throws if the frame's region is full. alignment must be a power of two.
+        Slice allocate(VkDeviceSize size, VkDeviceSize alignment);
+
+        // Aligned for use as a uniform or storage buffer (min*BufferOffsetAlignment).
+        Slice allocateUniform(VkDeviceSize size);
+        Slice allocateStorage(VkDeviceSize size);
+
+        // Copies value into a uniform slice.
+        template<typename T>
+        Slice pushUniform(const T& value)
+        {
+            Slice slice = allocateUniform(sizeof(T));
+            *static_cast<T*>(slice.data) = value;
+            return slice;
+        }
+
+        // Makes this frame's writes visible to the device; no call is made if the memory is coherent.
+        void flush();
+
+        VkBuffer getBuffer() const;
+        VkDeviceSize getFrameSize() const;
+
+        // Bytes allocated in the current frame, and the most any frame has used.
+        VkDeviceSize getUsedSize() const;
+        VkDeviceSize getPeakUsedSize() const;
+
+        private:
+
+        LveDevice&                  _lveDevice;
+        std::unique_ptr<LveBuffer>  _buffer;
+        VkDeviceSize                _frameSize;
+        VkDeviceSize                _frameBegin = 0;
+        VkDeviceSize                _used = 0;
+        VkDeviceSize                _peakUsed = 0;
+    };
+}
+
+#endif /* lve_frame_allocator_hpp */
@@ -4,6 +4,8 @@
 #pragma once
 
 #include "lve_camera.hpp"
+#include "lve_descriptors.hpp"
+#include "lve_frame_allocator.hpp"
 
 #include <vulkan/vulkan.h>
 
@@ -16,6 +18,18 @@ namespace lve
         VkCommandBuffer commandBuffer;
         LveCamera &camera;
         VkDescriptorSet globalDescriptorSet;
+        
+        // Dynamic offset of this frame's GlobalUbo, for binding globalDescriptorSet.
+        uint32_t globalUboOffset;
+        
+        // Transient per-frame data for render systems; reset at the start of the frame.
+        LveFrameAllocator &frameAllocator;
+        
+        // Transient descriptor sets, valid for this frame only; reset at the start of the frame.
+        LveDescriptorAllocator &frameDescriptors;
+        
+        // Sets that stay valid across frames, shared between identical writes.
+        LveDescriptorCache &descriptorCache;
     };
 }
 
@@ -44,6 +44,10 @@ class LveGameObject
     
     glm::vec3 _color{};
     
+    // Index into the scene's bindless texture array; ~0u, LveBindlessDescriptors::INVALID_INDEX, for
+    // none. Only read by the Bindless object data path.
+    uint32_t _textureIndex = ~0u;
+    
     TransformComponent _transformComp{};
     
     private:
@@ -0,0 +1,326 @@
+#include "lve_memory_allocator.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace lve
+{
+    const char* memoryCategoryName(LveMemoryCategory category)
+    {
+        switch (category)
+        {
+            case LveMemoryCategory::Models:      return "models";
+            case LveMemoryCategory::Staging:     return "staging";
+            case LveMemoryCategory::Uniforms:    return "uniforms";
+            case LveMemoryCategory::DepthImages: return "depthImages";
+            default:                             return "other";
+        }
+    }
+
+    LveMemoryAllocator::LveMemoryAllocator(VkDevice device, VkPhysicalDevice physicalDevice)
+    :   _device{device}
+    {
+        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &_memoryProperties);
+        _pools.resize(_memoryProperties.memoryTypeCount * 2);
+
+        // A block may take at most an eighth of its heap, e.g. on small host visible device local heaps.
+        for (uint32_t i = 0; i < _memoryProperties.memoryTypeCount; i++)
+        {
+            VkDeviceSize heapSize = _memoryProperties.memoryHeaps[_memoryProperties.memoryTypes[i].heapIndex].size;
+            VkDeviceSize blockSize = BLOCK_SIZE;
+            while (blockSize > MIN_ALLOCATION_SIZE && blockSize > heapSize / 8)
+            {
+                blockSize /= 2;
+            }
+            _blockSizes.push_back(blockSize);
+        }
+    }
+
+    LveMemoryAllocator::~LveMemoryAllocator()
+    {
+        assert(_statistics.allocationCount == 0 && "Device memory allocations outlive the allocator");
+        for (uint32_t p = 0; p < _pools.size(); p++)
+        {
+            for (std::unique_ptr<Block>& block : _pools[p].blocks)
+            {
+                if (block)
+                {
+                    releaseDeviceMemory(block->memory, block->size, p / 2);
+                }
+            }
+        }
+    }
+
+    LveAllocation LveMemoryAllocator::allocate(
+        const VkMemoryRequirements& requirements,
+        VkMemoryPropertyFlags properties,
+        LveMemoryCategory category,
+        bool linear)
+    {
+        LveAllocation allocation{};
+        allocation.memoryType = findMemoryType(requirements.memoryTypeBits, properties);
+        allocation.requestedSize = requirements.size;
+        allocation.linear = linear;
+        allocation.category = category;
+
+        std::lock_guard<std::mutex> lock{_mutex};
+
+        const VkDeviceSize blockSize = _blockSizes[allocation.memoryType];
+        const uint32_t order = orderFor(std::max(requirements.size, requirements.alignment));
+        if ((MIN_ALLOCATION_SIZE << order) > blockSize)
+        {
+            allocation.size = requirements.size;
+            allocation.memory = allocateDeviceMemory(requirements.size, allocation.memoryType, &allocation.mapped);
+            _statistics.dedicatedCount++;
+            _statistics.allocationCount++;
+            _statistics.allocatedBytes += allocation.size;
+            _statistics.requestedBytes += allocation.requestedSize;
+            _statistics.categoryBytes[static_cast<uint32_t>(category)] += allocation.size;
+            return allocation;
+        }
+
+        Pool& pool = _pools[allocation.memoryType * 2 + (linear ? 1 : 0)];
+
+        // First block with a free range that is large enough, otherwise a new one.
+        uint32_t blockIndex = LveAllocation::DEDICATED;
+        uint32_t freeOrder = UINT32_MAX;
+        for (uint32_t i = 0; i < pool.blocks.size() && freeOrder == UINT32_MAX; i++)
+        {
+            if (pool.blocks[i])
+            {
+                freeOrder = findFreeOrder(*pool.blocks[i], order);
+                blockIndex = i;
+            }
+        }
+        if (freeOrder == UINT32_MAX)
+        {
+            auto block = std::make_unique<Block>();
+            block->size = blockSize;
+            block->maxOrder = orderFor(blockSize);
+            block->allocatedBytes = 0;
+            block->freeLists.resize(block->maxOrder + 1);
+            block->freeLists[block->maxOrder].insert(0);
+            block->memory = allocateDeviceMemory(blockSize, allocation.memoryType, &block->mapped);
+            _statistics.blockCount++;
+
+            auto empty = std::find(pool.blocks.begin(), pool.blocks.end(), nullptr);
+            blockIndex = static_cast<uint32_t>(empty - pool.blocks.begin());
+            if (empty == pool.blocks.end())
+            {
+                pool.blocks.push_back(std::move(block));
+            }
+            else
+            {
+                *empty = std::move(block);
+            }
+            freeOrder = pool.blocks[blockIndex]->maxOrder;
+        }
+
+        // Take the lowest free range and split it down to the requested order, freeing the upper halves.
+        Block& block = *pool.blocks[blockIndex];
+        VkDeviceSize offset = *block.freeLists[freeOrder].begin();
+        block.freeLists[freeOrder].erase(block.freeLists[freeOrder].begin());
+        while (freeOrder > order)
+        {
+            freeOrder--;
+            block.freeLists[freeOrder].insert(offset + (MIN_ALLOCATION_SIZE << freeOrder));
+        }
+
+        allocation.memory = block.memory;
+        allocation.offset = offset;
+        allocation.size = MIN_ALLOCATION_SIZE << order;
+        allocation.block = blockIndex;
+        allocation.order = order;
+        if (block.mapped != nullptr)
+        {
+            allocation.mapped = static_cast<char*>(block.mapped) + offset;
+        }
+        block.allocatedBytes += allocation.size;
+        _statistics.allocationCount++;
+        _statistics.allocatedBytes += allocation.size;
+        _statistics.requestedBytes += allocation.requestedSize;
+        _statistics.categoryBytes[static_cast<uint32_t>(category)] += allocation.size;
+        return allocation;
+    }
+
+    void LveMemoryAllocator::free(LveAllocation& allocation)
+    {
+        if (allocation.memory == VK_NULL_HANDLE)
+        {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock{_mutex};
+        assert(_statistics.allocationCount > 0 && "Freeing more allocations than were made");
+        _statistics.allocationCount--;
+        _statistics.allocatedBytes -= allocation.size;
+        _statistics.requestedBytes -= allocation.requestedSize;
+        _statistics.categoryBytes[static_cast<uint32_t>(allocation.category)] -= allocation.size;
+
+        if (allocation.block == LveAllocation::DEDICATED)
+        {
+            _statistics.dedicatedCount--;
+            releaseDeviceMemory(allocation.memory, allocation.size, allocation.memoryType);
+            allocation = LveAllocation{};
+            return;
+        }
+
+        Pool& pool = _pools[allocation.memoryType * 2 + (allocation.linear ? 1 : 0)];
+        Block& block = *pool.blocks[allocation.block];
+        block.allocatedBytes -= allocation.size;
+
+        // Merge with the buddy while it is free.
+        VkDeviceSize offset = allocation.offset;
+        uint32_t order = allocation.order;
+        while (order < block.maxOrder)
+        {
+            VkDeviceSize buddy = offset ^ (MIN_ALLOCATION_SIZE << order);
+            if (block.freeLists[order].erase(buddy) == 0)
+            {
+                break;
+            }
+            offset = std::min(offset, buddy);
+            order++;
+        }
+        block.freeLists[order].insert(offset);
+
+        // Empty blocks are released, except the pool's last one, so alternating loads and unloads do
+        // not keep allocating device memory.
+        if (block.allocatedBytes == 0)
+        {
+            size_t liveBlocks = std::count_if(
+                pool.blocks.begin(),
+                pool.blocks.end(),
+                [](const std::unique_ptr<Block>& b) { return b != nullptr; });
+            if (liveBlocks > 1)
+            {
+                releaseDeviceMemory(block.memory, block.size, allocation.memoryType);
+                pool.blocks[allocation.block] = nullptr;
+                _statistics.blockCount--;
+            }
+        }
+        allocation = LveAllocation{};
+    }
+
+    LveMemoryAllocator::Statistics LveMemoryAllocator::getStatistics() const
+    {
+        std::lock_guard<std::mutex> lock{_mutex};
+        Statistics statistics = _statistics;
+
+        VkDeviceSize freeBytes = 0;
+        VkDeviceSize largestFree = 0;
+        for (const Pool& pool : _pools)
+        {
+            for (const std::unique_ptr<Block>& block : pool.blocks)
+            {
+                if (!block)
+                {
+                    continue;
+                }
+                freeBytes += block->size - block->allocatedBytes;
+                for (uint32_t order = block->maxOrder + 1; order-- > 0;)
+                {
+                    if (!block->freeLists[order].empty())
+                    {
+                        largestFree += MIN_ALLOCATION_SIZE << order;
+                        break;
+                    }
+                }
+            }
+        }
+        if (statistics.allocatedBytes > 0)
+        {
+            statistics.internalFragmentation =
+                1.f - static_cast<float>(statistics.requestedBytes) / static_cast<float>(statistics.allocatedBytes);
+        }
+        if (freeBytes > 0)
+        {
+            statistics.externalFragmentation = 1.f - static_cast<float>(largestFree) / static_cast<float>(freeBytes);
+        }
+        return statistics;
+    }
+
+    uint32_t LveMemoryAllocator::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const
+    {
+        for (uint32_t i = 0; i < _memoryProperties.memoryTypeCount; i++)
+        {
+            if ((typeFilter & (1 << i)) &&
+                (_memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+            {
+                return i;
+            }
+        }
+        throw std::runtime_error("failed to find suitable memory type!");
+    }
+
+    VkMemoryPropertyFlags LveMemoryAllocator::getMemoryTypeFlags(uint32_t memoryType) const
+    {
+        return _memoryProperties.memoryTypes[memoryType].propertyFlags;
+    }
+
+    const VkPhysicalDeviceMemoryProperties& LveMemoryAllocator::getMemoryProperties() const
+    {
+        return _memoryProperties;
+    }
+
+    uint32_t LveMemoryAllocator::orderFor(VkDeviceSize size)
+    {
+        uint32_t order = 0;
+        while ((MIN_ALLOCATION_SIZE << order) < size)
+        {
+            order++;
+        }
+        return order;
+    }
+
+    uint32_t LveMemoryAllocator::findFreeOrder(const Block& block, uint32_t order)
+    {
+        for (uint32_t o = order; o <= block.maxOrder; o++)
+        {
+            if (!block.freeLists[o].empty())
+            {
+                return o;
+            }
+        }
+        return UINT32_MAX;
+    }
+
+    VkDeviceMemory LveMemoryAllocator::allocateDeviceMemory(VkDeviceSize size, uint32_t memoryType, void** mapped)
+    {
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = size;
+        allocInfo.memoryTypeIndex = memoryType;
+
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        if (vkAllocateMemory(_device, &allocInfo, nullptr, &memory) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to allocate device memory!");
+        }
+        _statistics.deviceAllocationCount++;
+        _statistics.reservedBytes += size;
+        _statistics.peakReservedBytes = std::max(_statistics.peakReservedBytes, _statistics.reservedBytes);
+        _statistics.heapReservedBytes[_memoryProperties.memoryTypes[memoryType].heapIndex] += size;
+
+        *mapped = nullptr;
+        if (getMemoryTypeFlags(memoryType) & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+        {
+            if (vkMapMemory(_device, memory, 0, VK_WHOLE_SIZE, 0, mapped) != VK_SUCCESS)
+            {
+                releaseDeviceMemory(memory, size, memoryType);
+                throw std::runtime_error("failed to map device memory!");
+            }
+        }
+        return memory;
+    }
+
+    void LveMemoryAllocator::releaseDeviceMemory(VkDeviceMemory memory, VkDeviceSize size, uint32_t memoryType)
+    {
+        // Freeing memory implicitly unmaps it.
+        vkFreeMemory(_device, memory, nullptr);
+        _statistics.reservedBytes -= size;
+        _statistics.heapReservedBytes[_memoryProperties.memoryTypes[memoryType].heapIndex] -= size;
+    }
+}
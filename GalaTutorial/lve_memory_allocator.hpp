@@ -0,0 +1,174 @@
+#ifndef lve_memory_allocator_hpp
+#define lve_memory_allocator_hpp
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+// std
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
+namespace lve
+{
+    // What an allocation is for, so memory use can be attributed to parts of the engine.
+    enum class LveMemoryCategory : uint32_t
+    {
+        Other,
+        Models,
+        Staging,
+        Uniforms,
+        DepthImages
+    };
+
+    constexpr uint32_t LVE_MEMORY_CATEGORY_COUNT = 5;
+
+    // Lower case name, e.g. "depthImages".
+    const char* memoryCategoryName(LveMemoryCategory category);
+
+    // A range of device memory handed out by LveMemoryAllocator.
+    struct LveAllocation
+    {
+        static constexpr uint32_t DEDICATED = UINT32_MAX;
+
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize   offset = 0;
+
+        // Bytes reserved for the allocation, and the bytes that were asked for.
+        VkDeviceSize   size = 0;
+        VkDeviceSize   requestedSize = 0;
+
+        // Start of the allocation if its memory is host visible, otherwise nullptr.
+        void*          mapped = nullptr;
+
+        uint32_t       memoryType = 0;
+        uint32_t       block = DEDICATED;
+        uint32_t       order = 0;
+        bool           linear = true;
+        LveMemoryCategory category = LveMemoryCategory::Other;
+    };
+
+    // Sub-allocates buffers from large VkDeviceMemory blocks instead of one vkAllocateMemory per
+    // buffer, which is slow and runs into maxMemoryAllocationCount.
+    //
+    // Each memory type has its own blocks of up to BLOCK_SIZE bytes, managed as buddy systems: an
+    // allocation takes the smallest power of two block of at least MIN_ALLOCATION_SIZE bytes that
+    // fits its size and alignment, splitting larger free blocks in halves, and merges with its buddy
+    // again when freed. Offsets are multiples of the allocation's size, so every power of two
+    // alignment up to that size holds, and so does nonCoherentAtomSize (at most 256 bytes).
+    // Requests larger than a block get dedicated memory.
+    //
+    // Linear (buffer) and optimal tiling resources never share a block, which keeps
+    // bufferImageGranularity from applying. Host visible blocks stay mapped for their lifetime, so
+    // mapping a buffer never calls vkMapMemory on memory other buffers use.
+    //
+    // Thread safe.
+    class LveMemoryAllocator
+    {
+        public:
+
+        static constexpr VkDeviceSize BLOCK_SIZE = 64 * 1024 * 1024;
+        static constexpr VkDeviceSize MIN_ALLOCATION_SIZE = 256;
+
+        struct Statistics
+        {
+            uint32_t     blockCount = 0;
+            uint32_t     dedicatedCount = 0;
+            uint32_t     allocationCount = 0;
+
+            // vkAllocateMemory calls made so far.
+            uint64_t     deviceAllocationCount = 0;
+
+            // Device memory held in blocks and dedicated allocations, and its peak.
+            VkDeviceSize reservedBytes = 0;
+            VkDeviceSize peakReservedBytes = 0;
+
+            // Bytes handed out in power of two sizes, and the bytes that were asked for.
+            VkDeviceSize allocatedBytes = 0;
+            VkDeviceSize requestedBytes = 0;
+
+            // Share of allocated bytes lost to rounding up, and share of free bytes that are not part
+            // of their block's largest free range.
+            float        internalFragmentation = 0.f;
+            float        externalFragmentation = 0.f;
+
+            // Allocated bytes per LveMemoryCategory.
+            std::array<VkDeviceSize, LVE_MEMORY_CATEGORY_COUNT> categoryBytes{};
+
+            // Reserved bytes per memory heap.
+            std::array<VkDeviceSize, VK_MAX_MEMORY_HEAPS> heapReservedBytes{};
+        };
+
+        LveMemoryAllocator(VkDevice device, VkPhysicalDevice physicalDevice);
+
+        // Every allocation must have been freed.
+        ~LveMemoryAllocator();
+
+        LveMemoryAllocator(const LveMemoryAllocator&) = delete;
+        LveMemoryAllocator& operator=(const LveMemoryAllocator&) = delete;
+
+        // linear is false for images with optimal tiling.
+        LveAllocation allocate(
+            const VkMemoryRequirements& requirements,
+            VkMemoryPropertyFlags properties,
+            LveMemoryCategory category = LveMemoryCategory::Other,
+            bool linear = true);
+
+        // Resets allocation.
+        void free(LveAllocation& allocation);
+
+        Statistics getStatistics() const;
+
+        uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+        VkMemoryPropertyFlags getMemoryTypeFlags(uint32_t memoryType) const;
+        const VkPhysicalDeviceMemoryProperties& getMemoryProperties() const;
+
+        private:
+
+        struct Block
+        {
+            VkDeviceMemory memory;
+            void*          mapped;
+            VkDeviceSize   size;
+            uint32_t       maxOrder;
+            VkDeviceSize   allocatedBytes;
+
+            // Offsets of the free ranges of MIN_ALLOCATION_SIZE << order bytes, per order.
+            std::vector<std::set<VkDeviceSize>> freeLists;
+        };
+
+        // Blocks of one memory type and tiling; freed blocks leave a null entry so indices stay valid.
+        struct Pool
+        {
+            std::vector<std::unique_ptr<Block>> blocks;
+        };
+
+        static uint32_t orderFor(VkDeviceSize size);
+
+        // Smallest order with a free range in block, at least order, or UINT32_MAX.
+        static uint32_t findFreeOrder(const Block& block, uint32_t order);
+
+        VkDeviceMemory allocateDeviceMemory(VkDeviceSize size, uint32_t memoryType, void** mapped);
+
+        void releaseDeviceMemory(VkDeviceMemory memory, VkDeviceSize size, uint32_t memoryType);
+
+        VkDevice                            _device;
+        VkPhysicalDeviceMemoryProperties    _memoryProperties{};
+
+        // Per memory type, the block size: BLOCK_SIZE, or less on small heaps.
+        std::vector<VkDeviceSize>           _blockSizes{};
+
+        mutable std::mutex                  _mutex;
+
+        // Indexed by memoryType * 2 + linear.
+        std::vector<Pool>                   _pools{};
+
+        Statistics                          _statistics{};
+    };
+}
+
+#endif /* lve_memory_allocator_hpp */
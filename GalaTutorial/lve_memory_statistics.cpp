@@ -0,0 +1,54 @@
+#include "lve_memory_statistics.hpp"
+
+// std
+#include <sstream>
+
+namespace lve
+{
+    std::string LveMemoryStatistics::toJson() const
+    {
+        std::ostringstream json{};
+        json << "{\"budgetExtension\":" << (budgetExtension ? "true" : "false") << ",\"heaps\":[";
+        for (size_t i = 0; i < heaps.size(); i++)
+        {
+            const Heap& heap = heaps[i];
+            json << (i > 0 ? "," : "")
+                 << "{\"size\":" << heap.size
+                 << ",\"deviceLocal\":"
+                 << ((heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) ? "true" : "false")
+                 << ",\"budget\":" << heap.budget
+                 << ",\"usage\":" << heap.usage
+                 << ",\"reservedBytes\":" << heap.reservedBytes << "}";
+        }
+
+        json << "],\"categories\":{";
+        for (uint32_t c = 0; c < LVE_MEMORY_CATEGORY_COUNT; c++)
+        {
+            json << (c > 0 ? "," : "")
+                 << "\"" << memoryCategoryName(static_cast<LveMemoryCategory>(c)) << "\":"
+                 << allocator.categoryBytes[c];
+        }
+
+        json << "},\"allocator\":{"
+             << "\"blockCount\":" << allocator.blockCount
+             << ",\"dedicatedCount\":" << allocator.dedicatedCount
+             << ",\"allocationCount\":" << allocator.allocationCount
+             << ",\"deviceAllocationCount\":" << allocator.deviceAllocationCount
+             << ",\"reservedBytes\":" << allocator.reservedBytes
+             << ",\"peakReservedBytes\":" << allocator.peakReservedBytes
+             << ",\"allocatedBytes\":" << allocator.allocatedBytes
+             << ",\"requestedBytes\":" << allocator.requestedBytes
+             << ",\"internalFragmentation\":" << allocator.internalFragmentation
+             << ",\"externalFragmentation\":" << allocator.externalFragmentation
+             << "},\"staging\":{"
+             << "\"acquireCount\":" << staging.acquireCount
+             << ",\"reuseCount\":" << staging.reuseCount
+             << ",\"reuseRate\":" << staging.reuseRate
+             << ",\"bufferCount\":" << staging.bufferCount
+             << ",\"stagingBytes\":" << staging.stagingBytes
+             << ",\"peakStagingBytes\":" << staging.peakStagingBytes
+             << ",\"idleBytes\":" << staging.idleBytes
+             << "}}";
+        return json.str();
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef lve_memory_statistics_hpp
+#define lve_memory_statistics_hpp
+
+#pragma once
+
+#include "lve_memory_allocator.hpp"
+#include "lve_staging_pool.hpp"
+
+// std
+#include <string>
+#include <vector>
+
+namespace lve
+{
+    // Device memory use per heap and per engine category, from LveDevice::getMemoryStatistics().
+    struct LveMemoryStatistics
+    {
+        struct Heap
+        {
+            VkDeviceSize      size = 0;
+            VkMemoryHeapFlags flags = 0;
+
+            // With VK_EXT_memory_budget, the memory this process may use and uses on the heap,
+            // counting allocations outside the engine's allocator and the driver's own. Without it,
+            // the heap size and the engine allocator's reserved bytes.
+            VkDeviceSize      budget = 0;
+            VkDeviceSize      usage = 0;
+
+            // Bytes of device memory the engine's allocator holds on the heap.
+            VkDeviceSize      reservedBytes = 0;
+        };
+
+        // Whether budget and usage come from VK_EXT_memory_budget.
+        bool                            budgetExtension = false;
+        std::vector<Heap>               heaps{};
+        LveMemoryAllocator::Statistics  allocator{};
+        LveStagingPool::Statistics      staging{};
+
+        // One JSON object, without line breaks, so it can be written once per frame as a log line.
+        std::string toJson() const;
+    };
+}
+
+#endif /* lve_memory_statistics_hpp */
@@ -0,0 +1,191 @@
+#include "lve_mesh_cache.hpp"
+
+// std
+#include <cstdio>
+#include <fstream>
+
+// posix
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace lve
+{
+    // LveMappedFile methods:
+
+    std::shared_ptr<LveMappedFile> LveMappedFile::open(const std::string& filepath)
+    {
+        int fd = ::open(filepath.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            return nullptr;
+        }
+
+        struct stat fileStat{};
+        if (fstat(fd, &fileStat) != 0)
+        {
+            ::close(fd);
+            return nullptr;
+        }
+
+        size_t size = static_cast<size_t>(fileStat.st_size);
+        void* data = nullptr;
+
+        // mmap() rejects zero length mappings. An empty file is represented by a null data pointer.
+        if (size > 0)
+        {
+            data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data == MAP_FAILED)
+            {
+                ::close(fd);
+                return nullptr;
+            }
+        }
+
+        // The mapping stays valid after the descriptor is closed.
+        ::close(fd);
+        return std::shared_ptr<LveMappedFile>(new LveMappedFile(data, size));
+    }
+
+    LveMappedFile::LveMappedFile(void* data, size_t size)
+    :   _data{data},
+        _size{size}
+    {}
+
+    LveMappedFile::~LveMappedFile()
+    {
+        if (_data != nullptr)
+        {
+            munmap(_data, _size);
+        }
+    }
+
+    const char* LveMappedFile::data() const
+    {
+        return static_cast<const char*>(_data);
+    }
+
+    size_t LveMappedFile::size() const
+    {
+        return _size;
+    }
+
+    // LveMeshCache methods:
+
+    std::string LveMeshCache::cachePath(const std::string& sourcePath)
+    {
+        return sourcePath + ".lvemesh";
+    }
+
+    uint64_t LveMeshCache::hashBytes(const void* data, size_t size)
+    {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        uint64_t hash = 0xcbf29ce484222325ull;
+        for (size_t i = 0; i < size; i++)
+        {
+            hash ^= bytes[i];
+            hash *= 0x100000001b3ull;
+        }
+        return hash;
+    }
+
+    bool LveMeshCache::load(
+        const std::string& sourcePath,
+        uint64_t sourceHash,
+        uint64_t optionsHash,
+        LveModel::Builder& builder)
+    {
+        std::shared_ptr<LveMappedFile> file = LveMappedFile::open(cachePath(sourcePath));
+        if (file == nullptr || file->size() < sizeof(Header))
+        {
+            return false;
+        }
+
+        const Header* header = reinterpret_cast<const Header*>(file->data());
+        if (header->magic != MAGIC ||
+            header->version != VERSION ||
+            header->vertexStride != sizeof(LveModel::Vertex) ||
+            header->sourceHash != sourceHash ||
+            header->optionsHash != optionsHash)
+        {
+            return false;
+        }
+
+        size_t expectedSize =
+            sizeof(Header) +
+            static_cast<size_t>(header->vertexCount) * sizeof(LveModel::Vertex) +
+            static_cast<size_t>(header->indexCount) * sizeof(uint32_t) +
+            static_cast<size_t>(header->lodCount) * sizeof(LveModel::Lod) +
+            static_cast<size_t>(header->meshletCount) * sizeof(LveModel::Meshlet);
+
+        // A truncated file (e.g. disk full while writing) is treated as a miss.
+        if (file->size() != expectedSize)
+        {
+            return false;
+        }
+
+        builder._vertices.clear();
+        builder._indices.clear();
+        builder._lods.clear();
+        builder._meshlets.clear();
+        builder._cacheFile = file;
+        return true;
+    }
+
+    void LveMeshCache::store(
+        const std::string& sourcePath,
+        uint64_t sourceHash,
+        uint64_t optionsHash,
+        const LveModel::Builder& builder)
+    {
+        Header header{};
+        header.magic = MAGIC;
+        header.version = VERSION;
+        header.vertexStride = sizeof(LveModel::Vertex);
+        header.vertexCount = builder.vertexCount();
+        header.indexCount = builder.indexCount();
+        header.flags = 0;
+        header.sourceHash = sourceHash;
+        header.optionsHash = optionsHash;
+        header.lodCount = builder.lodCount();
+        header.meshletCount = builder.meshletCount();
+
+        // Write to a temporary file and rename it, so a reader never maps a half written cache.
+        std::string path = cachePath(sourcePath);
+        std::string tempPath = path + ".tmp";
+        {
+            std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+            if (!file.is_open())
+            {
+                return;
+            }
+
+            file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+            file.write(
+                reinterpret_cast<const char*>(builder.vertexData()),
+                static_cast<std::streamsize>(header.vertexCount) * sizeof(LveModel::Vertex));
+            file.write(
+                reinterpret_cast<const char*>(builder.indexData()),
+                static_cast<std::streamsize>(header.indexCount) * sizeof(uint32_t));
+            file.write(
+                reinterpret_cast<const char*>(builder.lodData()),
+                static_cast<std::streamsize>(header.lodCount) * sizeof(LveModel::Lod));
+            file.write(
+                reinterpret_cast<const char*>(builder.meshletData()),
+                static_cast<std::streamsize>(header.meshletCount) * sizeof(LveModel::Meshlet));
+
+            if (!file.good())
+            {
+                file.close();
+                std::remove(tempPath.c_str());
+                return;
+            }
+        }
+
+        if (std::rename(tempPath.c_str(), path.c_str()) != 0)
+        {
+            std::remove(tempPath.c_str());
+        }
+    }
+}
@@ -0,0 +1,86 @@
+#ifndef lve_mesh_cache_hpp
+#define lve_mesh_cache_hpp
+
+#pragma once
+
+#include "lve_model.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace lve
+{
+    // Read-only memory mapping of a whole file. The mapping is released when the object is destroyed.
+    class LveMappedFile
+    {
+        public:
+
+        // Returns nullptr if the file can not be opened or mapped.
+        static std::shared_ptr<LveMappedFile> open(const std::string& filepath);
+
+        ~LveMappedFile();
+
+        LveMappedFile(const LveMappedFile& o) = delete;
+        LveMappedFile& operator=(const LveMappedFile& o) = delete;
+
+        const char* data() const;
+        size_t size() const;
+
+        private:
+
+        LveMappedFile(void* data, size_t size);
+
+        void*  _data;
+        size_t _size;
+    };
+
+    // Binary cache of a loaded model, written next to the source file as <source>.lvemesh.
+    // File layout: Header, Vertex[vertexCount], uint32_t[indexCount], LveModel::Lod[lodCount],
+    // LveModel::Meshlet[meshletCount].
+    // A cache file is only used if its header matches this build's format, the source file's hash and
+    // the hash of the builder options it was written with.
+    class LveMeshCache
+    {
+        public:
+
+        static constexpr uint32_t MAGIC = 0x4D45564C; // "LVEM"
+        static constexpr uint32_t VERSION = 5;
+
+        struct Header
+        {
+            uint32_t magic;
+            uint32_t version;
+            uint32_t vertexStride;
+            uint32_t vertexCount;
+            uint32_t indexCount;
+            uint32_t flags;
+            uint64_t sourceHash;
+            uint64_t optionsHash;
+            uint32_t lodCount;
+            uint32_t meshletCount;
+        };
+
+        static std::string cachePath(const std::string& sourcePath);
+
+        // 64 bit FNV-1a hash.
+        static uint64_t hashBytes(const void* data, size_t size);
+
+        // On a cache hit, maps the cache file into builder._cacheFile and returns true.
+        static bool load(
+            const std::string& sourcePath,
+            uint64_t sourceHash,
+            uint64_t optionsHash,
+            LveModel::Builder& builder);
+
+        // Writes builder's vertices and indices. Failing to write the cache is not an error.
+        static void store(
+            const std::string& sourcePath,
+            uint64_t sourceHash,
+            uint64_t optionsHash,
+            const LveModel::Builder& builder);
+    };
+}
+
+#endif /* lve_mesh_cache_hpp */
@@ -0,0 +1,373 @@
+#include "lve_mesh_optimizer.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <numeric>
+
+namespace lve
+{
+    namespace
+    {
+        // FIFO cache simulated with timestamps: a vertex is in the cache if fewer than cacheSize
+        // misses happened since it was last loaded. flush() empties it.
+        class FifoCache
+        {
+            public:
+
+            FifoCache(size_t vertexCount, uint32_t cacheSize)
+            :   _loadedAt(vertexCount, 0),
+                _cacheSize{cacheSize},
+                _time{cacheSize + 1}
+            {}
+
+            // Returns true on a miss.
+            bool access(uint32_t vertex)
+            {
+                if (_time - _loadedAt[vertex] > _cacheSize)
+                {
+                    _loadedAt[vertex] = _time++;
+                    return true;
+                }
+                return false;
+            }
+
+            unsigned accessTriangle(const uint32_t* triangle)
+            {
+                return access(triangle[0]) + access(triangle[1]) + access(triangle[2]);
+            }
+
+            void flush()
+            {
+                _time += _cacheSize + 1;
+            }
+
+            private:
+
+            std::vector<uint64_t> _loadedAt;
+            uint64_t _cacheSize;
+            uint64_t _time;
+        };
+
+        // Triangles using each vertex, as one flat array indexed by offsets.
+        struct Adjacency
+        {
+            std::vector<uint32_t> offsets{};
+            std::vector<uint32_t> triangles{};
+
+            Adjacency(const std::vector<uint32_t>& indices, size_t vertexCount)
+            :   offsets(vertexCount + 1, 0),
+                triangles(indices.size())
+            {
+                for (uint32_t index : indices)
+                {
+                    offsets[index + 1]++;
+                }
+                std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+                std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+                for (size_t i = 0; i < indices.size(); i++)
+                {
+                    triangles[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+                }
+            }
+        };
+    }
+
+    LveModel::VertexCacheStatistics LveMeshOptimizer::analyzeVertexCache(
+        const std::vector<uint32_t>& indices,
+        size_t vertexCount,
+        uint32_t cacheSize)
+    {
+        LveModel::VertexCacheStatistics statistics{};
+        if (indices.size() < 3)
+        {
+            return statistics;
+        }
+
+        FifoCache cache{vertexCount, cacheSize};
+        std::vector<bool> referenced(vertexCount, false);
+        size_t misses = 0;
+        size_t referencedCount = 0;
+        for (uint32_t index : indices)
+        {
+            misses += cache.access(index);
+            if (!referenced[index])
+            {
+                referenced[index] = true;
+                referencedCount++;
+            }
+        }
+
+        statistics.acmr = static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+        statistics.atvr = static_cast<float>(misses) / static_cast<float>(referencedCount);
+        return statistics;
+    }
+
+    // Tipsify: fan around a vertex, emitting all its remaining triangles, then continue with the
+    // vertex just emitted that will still be in the cache and has the fewest remaining triangles.
+    // When no such vertex exists, back up through recently emitted vertices (dead end stack), then
+    // fall back to the next vertex in index order.
+    void LveMeshOptimizer::optimizeVertexCache(
+        std::vector<uint32_t>& indices,
+        size_t vertexCount,
+        uint32_t cacheSize)
+    {
+        assert(indices.size() % 3 == 0 && "optimizeVertexCache expects a triangle list");
+        const size_t triangleCount = indices.size() / 3;
+        if (triangleCount == 0)
+        {
+            return;
+        }
+
+        Adjacency adjacency{indices, vertexCount};
+
+        std::vector<uint32_t> liveTriangles(vertexCount);
+        for (size_t v = 0; v < vertexCount; v++)
+        {
+            liveTriangles[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+        }
+
+        std::vector<int64_t> cacheTime(vertexCount, 0);
+        int64_t time = cacheSize + 1;
+        std::vector<bool> emitted(triangleCount, false);
+        std::vector<uint32_t> deadEnds{};
+        std::vector<uint32_t> candidates{};
+        size_t nextInOrder = 0;
+
+        std::vector<uint32_t> result{};
+        result.reserve(indices.size());
+
+        auto skipDeadEnd = [&]() -> int64_t
+        {
+            while (!deadEnds.empty())
+            {
+                uint32_t vertex = deadEnds.back();
+                deadEnds.pop_back();
+                if (liveTriangles[vertex] > 0)
+                {
+                    return vertex;
+                }
+            }
+            for (; nextInOrder < vertexCount; nextInOrder++)
+            {
+                if (liveTriangles[nextInOrder] > 0)
+                {
+                    return static_cast<int64_t>(nextInOrder);
+                }
+            }
+            return -1;
+        };
+
+        int64_t fanning = skipDeadEnd();
+        while (fanning >= 0)
+        {
+            candidates.clear();
+            for (uint32_t i = adjacency.offsets[fanning]; i < adjacency.offsets[fanning + 1]; i++)
+            {
+                uint32_t triangle = adjacency.triangles[i];
+                if (emitted[triangle])
+                {
+                    continue;
+                }
+                emitted[triangle] = true;
+
+                for (int corner = 0; corner < 3; corner++)
+                {
+                    uint32_t vertex = indices[3 * triangle + corner];
+                    result.push_back(vertex);
+                    deadEnds.push_back(vertex);
+                    candidates.push_back(vertex);
+                    liveTriangles[vertex]--;
+                    if (time - cacheTime[vertex] > cacheSize)
+                    {
+                        cacheTime[vertex] = time++;
+                    }
+                }
+            }
+
+            // Prefer the candidate that entered the cache longest ago but will still be in it after
+            // its remaining triangles are emitted.
+            int64_t best = -1;
+            int64_t bestPriority = -1;
+            for (uint32_t vertex : candidates)
+            {
+                if (liveTriangles[vertex] == 0)
+                {
+                    continue;
+                }
+                int64_t priority = 0;
+                if (time - cacheTime[vertex] + 2 * static_cast<int64_t>(liveTriangles[vertex]) <= cacheSize)
+                {
+                    priority = time - cacheTime[vertex];
+                }
+                if (priority > bestPriority)
+                {
+                    bestPriority = priority;
+                    best = vertex;
+                }
+            }
+
+            fanning = best >= 0 ? best : skipDeadEnd();
+        }
+
+        indices.swap(result);
+    }
+
+    void LveMeshOptimizer::optimizeOverdraw(
+        std::vector<uint32_t>& indices,
+        const std::vector<LveModel::Vertex>& vertices,
+        uint32_t cacheSize,
+        float threshold)
+    {
+        assert(indices.size() % 3 == 0 && "optimizeOverdraw expects a triangle list");
+        const size_t triangleCount = indices.size() / 3;
+        if (triangleCount == 0)
+        {
+            return;
+        }
+
+        // Hard boundaries: triangles where the cache would miss on every vertex.
+        std::vector<size_t> hardStarts{};
+        {
+            FifoCache cache{vertices.size(), cacheSize};
+            for (size_t t = 0; t < triangleCount; t++)
+            {
+                if (cache.accessTriangle(&indices[3 * t]) == 3)
+                {
+                    hardStarts.push_back(t);
+                }
+            }
+            if (hardStarts.empty() || hardStarts.front() != 0)
+            {
+                hardStarts.insert(hardStarts.begin(), 0);
+            }
+            hardStarts.push_back(triangleCount);
+        }
+
+        // Soft boundaries: within each hard cluster, cut as soon as the miss ratio since the last cut
+        // is within threshold of the whole cluster's.
+        std::vector<size_t> clusterStarts{};
+        {
+            FifoCache cache{vertices.size(), cacheSize};
+            for (size_t c = 0; c + 1 < hardStarts.size(); c++)
+            {
+                size_t start = hardStarts[c];
+                size_t end = hardStarts[c + 1];
+
+                cache.flush();
+                size_t clusterMisses = 0;
+                for (size_t t = start; t < end; t++)
+                {
+                    clusterMisses += cache.accessTriangle(&indices[3 * t]);
+                }
+                float limit = threshold * static_cast<float>(clusterMisses) / static_cast<float>(end - start);
+
+                cache.flush();
+                clusterStarts.push_back(start);
+                size_t misses = 0;
+                size_t triangles = 0;
+                for (size_t t = start; t + 1 < end; t++)
+                {
+                    misses += cache.accessTriangle(&indices[3 * t]);
+                    triangles++;
+                    if (static_cast<float>(misses) <= limit * static_cast<float>(triangles))
+                    {
+                        clusterStarts.push_back(t + 1);
+                        cache.flush();
+                        misses = 0;
+                        triangles = 0;
+                    }
+                }
+            }
+            clusterStarts.push_back(triangleCount);
+        }
+
+        const size_t clusterCount = clusterStarts.size() - 1;
+
+        // Area weighted centroid and normal of every cluster and of the whole mesh.
+        std::vector<glm::vec3> clusterCentroids(clusterCount, glm::vec3{0.f});
+        std::vector<glm::vec3> clusterNormals(clusterCount, glm::vec3{0.f});
+        std::vector<float> clusterAreas(clusterCount, 0.f);
+        glm::vec3 meshCentroid{0.f};
+        float meshArea = 0.f;
+
+        for (size_t c = 0; c < clusterCount; c++)
+        {
+            for (size_t t = clusterStarts[c]; t < clusterStarts[c + 1]; t++)
+            {
+                const glm::vec3& a = vertices[indices[3 * t + 0]].position;
+                const glm::vec3& b = vertices[indices[3 * t + 1]].position;
+                const glm::vec3& p = vertices[indices[3 * t + 2]].position;
+                glm::vec3 normal = glm::cross(b - a, p - a);
+                float area = glm::length(normal);
+                glm::vec3 centroid = (a + b + p) / 3.f;
+
+                clusterCentroids[c] += centroid * area;
+                clusterNormals[c] += normal;
+                clusterAreas[c] += area;
+            }
+            meshCentroid += clusterCentroids[c];
+            meshArea += clusterAreas[c];
+        }
+        if (meshArea > 0.f)
+        {
+            meshCentroid /= meshArea;
+        }
+
+        std::vector<float> sortKeys(clusterCount, 0.f);
+        for (size_t c = 0; c < clusterCount; c++)
+        {
+            if (clusterAreas[c] <= 0.f)
+            {
+                continue;
+            }
+            glm::vec3 centroid = clusterCentroids[c] / clusterAreas[c];
+            float normalLength = glm::length(clusterNormals[c]);
+            if (normalLength > 0.f)
+            {
+                sortKeys[c] = glm::dot(centroid - meshCentroid, clusterNormals[c] / normalLength);
+            }
+        }
+
+        // Outward facing clusters first; stable so that ties keep the cache optimized order.
+        std::vector<uint32_t> order(clusterCount);
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b)
+        {
+            return sortKeys[a] > sortKeys[b];
+        });
+
+        std::vector<uint32_t> result{};
+        result.reserve(indices.size());
+        for (uint32_t c : order)
+        {
+            result.insert(
+                result.end(),
+                indices.begin() + 3 * clusterStarts[c],
+                indices.begin() + 3 * clusterStarts[c + 1]);
+        }
+        indices.swap(result);
+    }
+
+    void LveMeshOptimizer::optimizeVertexFetch(
+        std::vector<LveModel::Vertex>& vertices,
+        std::vector<uint32_t>& indices)
+    {
+        const uint32_t unused = UINT32_MAX;
+        std::vector<uint32_t> remap(vertices.size(), unused);
+        std::vector<LveModel::Vertex> result{};
+        result.reserve(vertices.size());
+
+        for (uint32_t& index : indices)
+        {
+            if (remap[index] == unused)
+            {
+                remap[index] = static_cast<uint32_t>(result.size());
+                result.push_back(vertices[index]);
+            }
+            index = remap[index];
+        }
+        vertices.swap(result);
+    }
+}
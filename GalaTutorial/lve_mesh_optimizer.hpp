@@ -0,0 +1,53 @@
+#ifndef lve_mesh_optimizer_hpp
+#define lve_mesh_optimizer_hpp
+
+#pragma once
+
+#include "lve_model.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace lve
+{
+    // Reorders triangle lists for the GPU. The passes are meant to run in this order:
+    //   1. optimizeVertexCache: triangle order for post-transform cache reuse (Tipsify, Sander et al. 2007).
+    //   2. optimizeOverdraw: reorders clusters of the cache optimized order so that triangles facing
+    //      away from the mesh center are drawn first, keeping most of the cache reuse.
+    //   3. optimizeVertexFetch: renumbers vertices in the order the index buffer first uses them.
+    // All passes keep the set of triangles and their winding.
+    class LveMeshOptimizer
+    {
+        public:
+
+        // Roughly the post-transform cache size of current GPUs.
+        static constexpr uint32_t DEFAULT_CACHE_SIZE = 16;
+
+        // Simulates a FIFO post-transform cache of cacheSize entries.
+        static LveModel::VertexCacheStatistics analyzeVertexCache(
+            const std::vector<uint32_t>& indices,
+            size_t vertexCount,
+            uint32_t cacheSize = DEFAULT_CACHE_SIZE);
+
+        static void optimizeVertexCache(
+            std::vector<uint32_t>& indices,
+            size_t vertexCount,
+            uint32_t cacheSize = DEFAULT_CACHE_SIZE);
+
+        // Cluster boundaries are placed where the cache would be flushed anyway, and inside such runs
+        // wherever the cache miss ratio so far is within threshold of the run's. A higher threshold
+        // gives more, smaller clusters: less overdraw, more cache misses.
+        static void optimizeOverdraw(
+            std::vector<uint32_t>& indices,
+            const std::vector<LveModel::Vertex>& vertices,
+            uint32_t cacheSize = DEFAULT_CACHE_SIZE,
+            float threshold = 1.05f);
+
+        // Vertices no triangle uses are removed.
+        static void optimizeVertexFetch(
+            std::vector<LveModel::Vertex>& vertices,
+            std::vector<uint32_t>& indices);
+    };
+}
+
+#endif /* lve_mesh_optimizer_hpp */
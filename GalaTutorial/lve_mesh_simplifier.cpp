@@ -0,0 +1,441 @@
+#include "lve_mesh_simplifier.hpp"
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+
+namespace lve
+{
+    namespace
+    {
+        constexpr uint32_t NONE = UINT32_MAX;
+
+        struct Position
+        {
+            double x;
+            double y;
+            double z;
+        };
+
+        Position operator-(const Position& a, const Position& b)
+        {
+            return Position{a.x - b.x, a.y - b.y, a.z - b.z};
+        }
+
+        Position cross(const Position& a, const Position& b)
+        {
+            return Position{a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+        }
+
+        double dot(const Position& a, const Position& b)
+        {
+            return a.x * b.x + a.y * b.y + a.z * b.z;
+        }
+
+        // Sum of squared distances to a set of weighted planes: p^T A p + 2 b.p + c.
+        struct Quadric
+        {
+            double a00 = 0.0, a01 = 0.0, a02 = 0.0, a11 = 0.0, a12 = 0.0, a22 = 0.0;
+            double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+            double c = 0.0;
+            double weight = 0.0;
+
+            void addPlane(const Position& normal, double distance, double planeWeight)
+            {
+                a00 += planeWeight * normal.x * normal.x;
+                a01 += planeWeight * normal.x * normal.y;
+                a02 += planeWeight * normal.x * normal.z;
+                a11 += planeWeight * normal.y * normal.y;
+                a12 += planeWeight * normal.y * normal.z;
+                a22 += planeWeight * normal.z * normal.z;
+                b0 += planeWeight * normal.x * distance;
+                b1 += planeWeight * normal.y * distance;
+                b2 += planeWeight * normal.z * distance;
+                c += planeWeight * distance * distance;
+                weight += planeWeight;
+            }
+
+            void add(const Quadric& o)
+            {
+                a00 += o.a00; a01 += o.a01; a02 += o.a02;
+                a11 += o.a11; a12 += o.a12; a22 += o.a22;
+                b0 += o.b0; b1 += o.b1; b2 += o.b2;
+                c += o.c;
+                weight += o.weight;
+            }
+
+            // Area weighted mean of the squared distances.
+            double evaluate(const Position& p) const
+            {
+                if (weight <= 0.0)
+                {
+                    return 0.0;
+                }
+                double error =
+                    a00 * p.x * p.x + a11 * p.y * p.y + a22 * p.z * p.z +
+                    2.0 * (a01 * p.x * p.y + a02 * p.x * p.z + a12 * p.y * p.z) +
+                    2.0 * (b0 * p.x + b1 * p.y + b2 * p.z) +
+                    c;
+                return std::max(error, 0.0) / weight;
+            }
+        };
+
+        struct PositionKey
+        {
+            float x;
+            float y;
+            float z;
+
+            bool operator==(const PositionKey& o) const
+            {
+                return x == o.x && y == o.y && z == o.z;
+            }
+        };
+
+        struct PositionKeyHash
+        {
+            size_t operator()(const PositionKey& key) const
+            {
+                uint32_t bits[3];
+                memcpy(bits, &key, sizeof(bits));
+                uint64_t hash = 0;
+                for (uint32_t word : bits)
+                {
+                    hash = (hash ^ word) * 0x100000001b3ull;
+                    hash ^= hash >> 29;
+                }
+                return static_cast<size_t>(hash);
+            }
+        };
+
+        uint64_t edgeKey(uint32_t a, uint32_t b)
+        {
+            return a < b
+                ? (static_cast<uint64_t>(a) << 32) | b
+                : (static_cast<uint64_t>(b) << 32) | a;
+        }
+
+        struct Collapse
+        {
+            uint32_t from;
+            uint32_t to;
+            double   cost;
+        };
+
+        // Of the vertices sharing target's position, the one whose attributes are closest to vertex's.
+        uint32_t closestWedge(
+            const std::vector<LveModel::Vertex>& vertices,
+            const std::vector<uint32_t>& wedgeNext,
+            uint32_t vertex,
+            uint32_t target)
+        {
+            const LveModel::Vertex& reference = vertices[vertex];
+            uint32_t best = target;
+            float bestScore = -std::numeric_limits<float>::max();
+            for (uint32_t wedge = target; wedge != NONE; wedge = wedgeNext[wedge])
+            {
+                const LveModel::Vertex& candidate = vertices[wedge];
+                float score =
+                    glm::dot(candidate.normal, reference.normal) -
+                    glm::length(candidate.color - reference.color) -
+                    std::abs(candidate.uv.x - reference.uv.x) -
+                    std::abs(candidate.uv.y - reference.uv.y);
+                if (score > bestScore)
+                {
+                    bestScore = score;
+                    best = wedge;
+                }
+            }
+            return best;
+        }
+    }
+
+    std::vector<uint32_t> LveMeshSimplifier::simplify(
+        const std::vector<LveModel::Vertex>& vertices,
+        const std::vector<uint32_t>& indices,
+        size_t targetIndexCount,
+        float targetError,
+        float* resultError)
+    {
+        if (resultError != nullptr)
+        {
+            *resultError = 0.f;
+        }
+
+        const size_t vertexCount = vertices.size();
+        if (vertexCount == 0 || indices.size() < 3)
+        {
+            return indices;
+        }
+
+        // Errors are computed on positions scaled to the unit cube, so targetError is relative.
+        glm::vec3 minimum = vertices[0].position;
+        glm::vec3 maximum = vertices[0].position;
+        for (const LveModel::Vertex& vertex : vertices)
+        {
+            minimum = glm::min(minimum, vertex.position);
+            maximum = glm::max(maximum, vertex.position);
+        }
+        glm::vec3 extent = maximum - minimum;
+        double scale = std::max({extent.x, extent.y, extent.z});
+        if (scale <= 0.0)
+        {
+            scale = 1.0;
+        }
+
+        std::vector<Position> positions(vertexCount);
+        for (size_t v = 0; v < vertexCount; v++)
+        {
+            positions[v] = Position{
+                (vertices[v].position.x - minimum.x) / scale,
+                (vertices[v].position.y - minimum.y) / scale,
+                (vertices[v].position.z - minimum.z) / scale};
+        }
+
+        // Vertices with equal positions form one canonical vertex (the first of them); wedgeNext
+        // links the others in index order.
+        std::vector<uint32_t> canonical(vertexCount);
+        std::vector<uint32_t> wedgeNext(vertexCount, NONE);
+        {
+            std::unordered_map<PositionKey, uint32_t, PositionKeyHash> lastWithPosition{};
+            lastWithPosition.reserve(vertexCount);
+            for (uint32_t v = 0; v < vertexCount; v++)
+            {
+                // + 0.f folds -0.f into 0.f.
+                PositionKey key{
+                    vertices[v].position.x + 0.f,
+                    vertices[v].position.y + 0.f,
+                    vertices[v].position.z + 0.f};
+                auto inserted = lastWithPosition.emplace(key, v);
+                if (inserted.second)
+                {
+                    canonical[v] = v;
+                }
+                else
+                {
+                    canonical[v] = canonical[inserted.first->second];
+                    wedgeNext[inserted.first->second] = v;
+                    inserted.first->second = v;
+                }
+            }
+        }
+
+        std::vector<uint32_t> result{};
+        result.reserve(indices.size());
+        for (size_t i = 0; i + 2 < indices.size(); i += 3)
+        {
+            uint32_t a = canonical[indices[i + 0]];
+            uint32_t b = canonical[indices[i + 1]];
+            uint32_t c = canonical[indices[i + 2]];
+            if (a != b && b != c && a != c)
+            {
+                result.insert(result.end(), {indices[i + 0], indices[i + 1], indices[i + 2]});
+            }
+        }
+
+        // Edges used by one triangle are on the border, edges used by more than two are non manifold;
+        // the vertices of both stay where they are.
+        std::vector<bool> fixed(vertexCount, false);
+        {
+            std::unordered_map<uint64_t, uint32_t> edgeUses{};
+            edgeUses.reserve(result.size());
+            for (size_t i = 0; i < result.size(); i += 3)
+            {
+                for (int e = 0; e < 3; e++)
+                {
+                    edgeUses[edgeKey(canonical[result[i + e]], canonical[result[i + (e + 1) % 3]])]++;
+                }
+            }
+            for (const auto& [key, uses] : edgeUses)
+            {
+                if (uses != 2)
+                {
+                    fixed[key >> 32] = true;
+                    fixed[key & 0xFFFFFFFFu] = true;
+                }
+            }
+        }
+
+        std::vector<Quadric> quadrics(vertexCount);
+        for (size_t i = 0; i < result.size(); i += 3)
+        {
+            uint32_t a = canonical[result[i + 0]];
+            uint32_t b = canonical[result[i + 1]];
+            uint32_t c = canonical[result[i + 2]];
+            Position normal = cross(positions[b] - positions[a], positions[c] - positions[a]);
+            double length = std::sqrt(dot(normal, normal));
+            if (length <= 0.0)
+            {
+                continue;
+            }
+            normal = Position{normal.x / length, normal.y / length, normal.z / length};
+            double distance = -dot(normal, positions[a]);
+            double area = 0.5 * length;
+            quadrics[a].addPlane(normal, distance, area);
+            quadrics[b].addPlane(normal, distance, area);
+            quadrics[c].addPlane(normal, distance, area);
+        }
+
+        const double maxCost = static_cast<double>(targetError) * targetError;
+        double resultCost = 0.0;
+
+        std::vector<uint32_t> offsets(vertexCount + 1);
+        std::vector<uint32_t> adjacent{};
+        std::vector<Collapse> candidates{};
+        std::vector<bool> locked(vertexCount);
+        std::vector<uint32_t> collapseTo(vertexCount);
+
+        while (result.size() > targetIndexCount)
+        {
+            const size_t triangleCount = result.size() / 3;
+
+            // Triangles around each canonical vertex.
+            std::fill(offsets.begin(), offsets.end(), 0);
+            for (uint32_t index : result)
+            {
+                offsets[canonical[index] + 1]++;
+            }
+            for (size_t v = 0; v < vertexCount; v++)
+            {
+                offsets[v + 1] += offsets[v];
+            }
+            adjacent.resize(result.size());
+            {
+                std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+                for (size_t i = 0; i < result.size(); i++)
+                {
+                    adjacent[fill[canonical[result[i]]]++] = static_cast<uint32_t>(i / 3);
+                }
+            }
+
+            candidates.clear();
+            for (size_t t = 0; t < triangleCount; t++)
+            {
+                for (int e = 0; e < 3; e++)
+                {
+                    uint32_t a = canonical[result[3 * t + e]];
+                    uint32_t b = canonical[result[3 * t + (e + 1) % 3]];
+                    if (!fixed[a])
+                    {
+                        candidates.push_back({a, b, quadrics[a].evaluate(positions[b])});
+                    }
+                    if (!fixed[b])
+                    {
+                        candidates.push_back({b, a, quadrics[b].evaluate(positions[a])});
+                    }
+                }
+            }
+            std::sort(candidates.begin(), candidates.end(), [](const Collapse& l, const Collapse& r)
+            {
+                return l.cost < r.cost;
+            });
+
+            // Collapses within a pass must not share triangles, so the one ring of every collapsed
+            // vertex is locked until the next pass rebuilds the adjacency.
+            std::fill(locked.begin(), locked.end(), false);
+            for (uint32_t v = 0; v < vertexCount; v++)
+            {
+                collapseTo[v] = v;
+            }
+
+            const size_t trianglesToRemove = triangleCount - targetIndexCount / 3;
+            size_t trianglesRemoved = 0;
+            size_t collapses = 0;
+
+            for (const Collapse& collapse : candidates)
+            {
+                if (collapse.cost > maxCost || trianglesRemoved >= trianglesToRemove)
+                {
+                    break;
+                }
+                if (locked[collapse.from] || locked[collapse.to])
+                {
+                    continue;
+                }
+
+                // Reject collapses that flip or degenerate a remaining triangle.
+                bool flips = false;
+                size_t removes = 0;
+                for (uint32_t i = offsets[collapse.from]; i < offsets[collapse.from + 1] && !flips; i++)
+                {
+                    const uint32_t* triangle = &result[3 * adjacent[i]];
+                    uint32_t corners[3] = {canonical[triangle[0]], canonical[triangle[1]], canonical[triangle[2]]};
+                    if (corners[0] == collapse.to || corners[1] == collapse.to || corners[2] == collapse.to)
+                    {
+                        removes++;
+                        continue;
+                    }
+
+                    Position before[3];
+                    Position after[3];
+                    for (int k = 0; k < 3; k++)
+                    {
+                        before[k] = positions[corners[k]];
+                        after[k] = corners[k] == collapse.from ? positions[collapse.to] : before[k];
+                    }
+                    Position normalBefore = cross(before[1] - before[0], before[2] - before[0]);
+                    Position normalAfter = cross(after[1] - after[0], after[2] - after[0]);
+                    flips = dot(normalBefore, normalAfter) <= 0.0;
+                }
+                if (flips)
+                {
+                    continue;
+                }
+
+                collapseTo[collapse.from] = collapse.to;
+                quadrics[collapse.to].add(quadrics[collapse.from]);
+                resultCost = std::max(resultCost, collapse.cost);
+                trianglesRemoved += removes;
+                collapses++;
+
+                locked[collapse.to] = true;
+                for (uint32_t i = offsets[collapse.from]; i < offsets[collapse.from + 1]; i++)
+                {
+                    const uint32_t* triangle = &result[3 * adjacent[i]];
+                    locked[canonical[triangle[0]]] = true;
+                    locked[canonical[triangle[1]]] = true;
+                    locked[canonical[triangle[2]]] = true;
+                }
+            }
+
+            if (collapses == 0)
+            {
+                break;
+            }
+
+            size_t kept = 0;
+            for (size_t t = 0; t < triangleCount; t++)
+            {
+                uint32_t triangle[3];
+                for (int k = 0; k < 3; k++)
+                {
+                    uint32_t vertex = result[3 * t + k];
+                    uint32_t target = collapseTo[canonical[vertex]];
+                    triangle[k] = target == canonical[vertex]
+                        ? vertex
+                        : closestWedge(vertices, wedgeNext, vertex, target);
+                }
+                uint32_t a = canonical[triangle[0]];
+                uint32_t b = canonical[triangle[1]];
+                uint32_t c = canonical[triangle[2]];
+                if (a == b || b == c || a == c)
+                {
+                    continue;
+                }
+                result[kept++] = triangle[0];
+                result[kept++] = triangle[1];
+                result[kept++] = triangle[2];
+            }
+            result.resize(kept);
+        }
+
+        if (resultError != nullptr)
+        {
+            *resultError = static_cast<float>(std::sqrt(resultCost) * scale);
+        }
+        return result;
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef lve_mesh_simplifier_hpp
+#define lve_mesh_simplifier_hpp
+
+#pragma once
+
+#include "lve_model.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace lve
+{
+    // Quadric error mesh simplification (Garland and Heckbert 1997) by half edge collapse: a vertex
+    // is merged into one of its neighbours, so the simplified index buffer reuses the original vertex
+    // buffer and can share it with the full resolution mesh.
+    //
+    // Vertices with the same position but different attributes (e.g. the per face normals of a flat
+    // shaded mesh) are moved together. The triangles of a collapsed vertex then use the target's
+    // vertex with the closest attributes. Vertices on the mesh border are never moved, so the
+    // silhouette of open meshes is kept.
+    class LveMeshSimplifier
+    {
+        public:
+
+        // Returns the simplified triangle list. Collapses stop at targetIndexCount or before the
+        // error would exceed targetError, which is relative to the largest extent of the mesh.
+        // If resultError is given, it receives the error of the result as a model space distance.
+        static std::vector<uint32_t> simplify(
+            const std::vector<LveModel::Vertex>& vertices,
+            const std::vector<uint32_t>& indices,
+            size_t targetIndexCount,
+            float targetError,
+            float* resultError = nullptr);
+    };
+}
+
+#endif /* lve_mesh_simplifier_hpp */
@@ -0,0 +1,303 @@
+#include "lve_meshlets.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <numeric>
+
+namespace lve
+{
+    namespace
+    {
+        // Weight of normal deviation against new vertices when choosing the next triangle: a triangle
+        // at 90 degrees to the meshlet's normal costs as much as one extra vertex.
+        const float CONE_WEIGHT = 1.f;
+
+        glm::vec3 triangleNormal(const std::vector<LveModel::Vertex>& vertices, const uint32_t* triangle)
+        {
+            const glm::vec3& a = vertices[triangle[0]].position;
+            const glm::vec3& b = vertices[triangle[1]].position;
+            const glm::vec3& c = vertices[triangle[2]].position;
+            glm::vec3 normal = glm::cross(b - a, c - a);
+            float length = glm::length(normal);
+            return length > 0.f ? normal / length : glm::vec3{0.f};
+        }
+
+        // Bounding sphere around the center of the bounding box and the normal cone of the triangles
+        // in indices[meshlet.firstIndex, meshlet.firstIndex + meshlet.indexCount).
+        void computeBounds(
+            const std::vector<LveModel::Vertex>& vertices,
+            const std::vector<uint32_t>& indices,
+            LveModel::Meshlet& meshlet)
+        {
+            const uint32_t* first = indices.data() + meshlet.firstIndex;
+
+            glm::vec3 minimum = vertices[first[0]].position;
+            glm::vec3 maximum = minimum;
+            glm::vec3 normalSum{0.f};
+            for (uint32_t i = 0; i < meshlet.indexCount; i++)
+            {
+                minimum = glm::min(minimum, vertices[first[i]].position);
+                maximum = glm::max(maximum, vertices[first[i]].position);
+            }
+            for (uint32_t i = 0; i < meshlet.indexCount; i += 3)
+            {
+                normalSum += triangleNormal(vertices, first + i);
+            }
+
+            meshlet.center = (minimum + maximum) * 0.5f;
+            meshlet.radius = 0.f;
+            for (uint32_t i = 0; i < meshlet.indexCount; i++)
+            {
+                meshlet.radius = std::max(meshlet.radius, glm::length(vertices[first[i]].position - meshlet.center));
+            }
+
+            // A cutoff of 1 never culls: used when the normals span a hemisphere or more.
+            meshlet.coneAxis = glm::vec3{0.f, 0.f, 1.f};
+            meshlet.coneCutoff = 1.f;
+            float normalLength = glm::length(normalSum);
+            if (normalLength <= 0.f)
+            {
+                return;
+            }
+            glm::vec3 axis = normalSum / normalLength;
+
+            float minimumDot = 1.f;
+            for (uint32_t i = 0; i < meshlet.indexCount; i += 3)
+            {
+                glm::vec3 normal = triangleNormal(vertices, first + i);
+                if (normal != glm::vec3{0.f})
+                {
+                    minimumDot = std::min(minimumDot, glm::dot(normal, axis));
+                }
+            }
+            meshlet.coneAxis = axis;
+            if (minimumDot > 0.f)
+            {
+                // sin of the cone's half angle.
+                meshlet.coneCutoff = std::sqrt(1.f - minimumDot * minimumDot);
+            }
+        }
+    }
+
+    void LveMeshlets::build(
+        const std::vector<LveModel::Vertex>& vertices,
+        std::vector<uint32_t>& indices,
+        uint32_t firstIndex,
+        uint32_t indexCount,
+        std::vector<LveModel::Meshlet>& meshlets)
+    {
+        assert(indexCount % 3 == 0 && "LveMeshlets::build expects a triangle list");
+        const uint32_t* range = indices.data() + firstIndex;
+        const uint32_t triangleCount = indexCount / 3;
+        if (triangleCount == 0)
+        {
+            return;
+        }
+
+        // Vertices with the same position share an id, so meshlets also grow across the seams of flat
+        // shaded meshes, where neighbouring faces have no vertex in common.
+        std::vector<uint32_t> positionIds(vertices.size());
+        {
+            std::vector<uint32_t> order(vertices.size());
+            std::iota(order.begin(), order.end(), 0);
+            auto less = [&](uint32_t a, uint32_t b)
+            {
+                const glm::vec3& p = vertices[a].position;
+                const glm::vec3& q = vertices[b].position;
+                return p.x != q.x ? p.x < q.x : p.y != q.y ? p.y < q.y : p.z < q.z;
+            };
+            std::sort(order.begin(), order.end(), less);
+            for (size_t i = 0; i < order.size(); i++)
+            {
+                bool same = i > 0 && vertices[order[i]].position == vertices[order[i - 1]].position;
+                positionIds[order[i]] = same ? positionIds[order[i - 1]] : static_cast<uint32_t>(i);
+            }
+        }
+
+        // Triangles using each position, as one flat array indexed by offsets.
+        std::vector<uint32_t> offsets(vertices.size() + 1, 0);
+        for (uint32_t i = 0; i < indexCount; i++)
+        {
+            offsets[positionIds[range[i]] + 1]++;
+        }
+        std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+        std::vector<uint32_t> adjacency(indexCount);
+        {
+            std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+            for (uint32_t i = 0; i < indexCount; i++)
+            {
+                adjacency[fill[positionIds[range[i]]]++] = i / 3;
+            }
+        }
+
+        std::vector<glm::vec3> normals(triangleCount);
+        for (uint32_t t = 0; t < triangleCount; t++)
+        {
+            normals[t] = triangleNormal(vertices, range + 3 * t);
+        }
+
+        // inMeshlet[v] is the number of the meshlet v was last added to, plus one.
+        std::vector<uint32_t> inMeshlet(vertices.size(), 0);
+        std::vector<bool> emitted(triangleCount, false);
+        std::vector<uint32_t> result{};
+        result.reserve(indexCount);
+
+        const size_t firstMeshlet = meshlets.size();
+        std::vector<uint32_t> meshletVertices{};
+        uint32_t meshletNumber = 0;
+        uint32_t nextSeed = 0;
+
+        while (result.size() < indexCount)
+        {
+            meshletNumber++;
+            meshletVertices.clear();
+            glm::vec3 normalSum{0.f};
+            uint32_t meshletTriangles = 0;
+
+            LveModel::Meshlet meshlet{};
+            meshlet.firstIndex = firstIndex + static_cast<uint32_t>(result.size());
+
+            while (emitted[nextSeed])
+            {
+                nextSeed++;
+            }
+            int64_t next = nextSeed;
+
+            while (next >= 0)
+            {
+                const uint32_t triangle = static_cast<uint32_t>(next);
+                emitted[triangle] = true;
+                meshletTriangles++;
+                normalSum += normals[triangle];
+                for (int corner = 0; corner < 3; corner++)
+                {
+                    uint32_t vertex = range[3 * triangle + corner];
+                    result.push_back(vertex);
+                    if (inMeshlet[vertex] != meshletNumber)
+                    {
+                        inMeshlet[vertex] = meshletNumber;
+                        meshletVertices.push_back(vertex);
+                    }
+                }
+
+                if (meshletTriangles == MAX_TRIANGLES)
+                {
+                    break;
+                }
+
+                // Cheapest unemitted triangle sharing a vertex with the meshlet that still fits.
+                float normalLength = glm::length(normalSum);
+                glm::vec3 axis = normalLength > 0.f ? normalSum / normalLength : glm::vec3{0.f};
+                next = -1;
+                float bestCost = 0.f;
+                for (uint32_t vertex : meshletVertices)
+                {
+                    uint32_t position = positionIds[vertex];
+                    for (uint32_t i = offsets[position]; i < offsets[position + 1]; i++)
+                    {
+                        uint32_t candidate = adjacency[i];
+                        if (emitted[candidate])
+                        {
+                            continue;
+                        }
+                        uint32_t newVertices = 0;
+                        for (int corner = 0; corner < 3; corner++)
+                        {
+                            newVertices += inMeshlet[range[3 * candidate + corner]] != meshletNumber;
+                        }
+                        if (meshletVertices.size() + newVertices > MAX_VERTICES)
+                        {
+                            continue;
+                        }
+                        float cost = static_cast<float>(newVertices) +
+                            CONE_WEIGHT * (1.f - glm::dot(normals[candidate], axis));
+                        if (next < 0 || cost < bestCost)
+                        {
+                            bestCost = cost;
+                            next = candidate;
+                        }
+                    }
+                }
+
+                // Disconnected from the rest of the meshlet: continue in the input order, which the
+                // vertex cache optimization made mostly local, if the next triangle still fits.
+                if (next < 0)
+                {
+                    while (nextSeed < triangleCount && emitted[nextSeed])
+                    {
+                        nextSeed++;
+                    }
+                    if (nextSeed < triangleCount)
+                    {
+                        uint32_t newVertices = 0;
+                        for (int corner = 0; corner < 3; corner++)
+                        {
+                            newVertices += inMeshlet[range[3 * nextSeed + corner]] != meshletNumber;
+                        }
+                        if (meshletVertices.size() + newVertices <= MAX_VERTICES)
+                        {
+                            next = nextSeed;
+                        }
+                    }
+                }
+            }
+
+            meshlet.indexCount = firstIndex + static_cast<uint32_t>(result.size()) - meshlet.firstIndex;
+            meshlets.push_back(meshlet);
+        }
+
+        std::copy(result.begin(), result.end(), indices.begin() + firstIndex);
+        for (size_t m = firstMeshlet; m < meshlets.size(); m++)
+        {
+            computeBounds(vertices, indices, meshlets[m]);
+        }
+    }
+
+    // Gribb and Hartmann: clip space satisfies -w <= x, y <= w and 0 <= z <= w.
+    LveMeshlets::Frustum LveMeshlets::Frustum::fromMatrix(const glm::mat4& matrix)
+    {
+        auto row = [&](int i)
+        {
+            return glm::vec4{matrix[0][i], matrix[1][i], matrix[2][i], matrix[3][i]};
+        };
+
+        Frustum frustum{};
+        frustum.planes[0] = row(3) + row(0);
+        frustum.planes[1] = row(3) - row(0);
+        frustum.planes[2] = row(3) + row(1);
+        frustum.planes[3] = row(3) - row(1);
+        frustum.planes[4] = row(2);
+        frustum.planes[5] = row(3) - row(2);
+        for (glm::vec4& plane : frustum.planes)
+        {
+            float length = glm::length(glm::vec3{plane});
+            if (length > 0.f)
+            {
+                plane /= length;
+            }
+        }
+        return frustum;
+    }
+
+    bool LveMeshlets::Frustum::intersectsSphere(const glm::vec3& center, float radius) const
+    {
+        for (const glm::vec4& plane : planes)
+        {
+            if (glm::dot(glm::vec3{plane}, center) + plane.w < -radius)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Conservative: true only if dot(p - camera, n) > 0 for every point p of the bounding sphere and every
+    // normal n of the cone (the test meshoptimizer uses for its cluster cones).
+    bool LveMeshlets::isBackFacing(const LveModel::Meshlet& meshlet, const glm::vec3& cameraPosition)
+    {
+        glm::vec3 toCenter = meshlet.center - cameraPosition;
+        return glm::dot(toCenter, meshlet.coneAxis) >= meshlet.coneCutoff * glm::length(toCenter) + meshlet.radius;
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef lve_meshlets_hpp
+#define lve_meshlets_hpp
+
+#pragma once
+
+#include "lve_model.hpp"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace lve
+{
+    // Splits triangle lists into meshlets: small clusters of neighbouring triangles, each a contiguous
+    // range of the index buffer with a bounding sphere and a cone bounding its triangle normals. Whole
+    // meshlets can then be culled before drawing when they are outside the view frustum or face away
+    // from the camera.
+    //
+    // Culling is done in model space: the frustum planes are extracted from the full model view
+    // projection matrix and the camera position is moved into model space, so non uniformly scaled
+    // objects are culled exactly as unscaled ones.
+    class LveMeshlets
+    {
+        public:
+
+        static constexpr uint32_t MAX_VERTICES = 64;
+        static constexpr uint32_t MAX_TRIANGLES = 124;
+
+        // Reorders the triangles of indices[firstIndex, firstIndex + indexCount) into meshlets and
+        // appends them to meshlets. Meshlets grow across shared vertices, preferring triangles that
+        // add no new vertex and whose normal is close to the meshlet's.
+        static void build(
+            const std::vector<LveModel::Vertex>& vertices,
+            std::vector<uint32_t>& indices,
+            uint32_t firstIndex,
+            uint32_t indexCount,
+            std::vector<LveModel::Meshlet>& meshlets);
+
+        // The six clip planes of a view projection (or model view projection) matrix with Vulkan's
+        // [0, 1] depth range, normalized so that dot(xyz, p) + w is a signed distance.
+        struct Frustum
+        {
+            std::array<glm::vec4, 6> planes{};
+
+            static Frustum fromMatrix(const glm::mat4& matrix);
+
+            bool intersectsSphere(const glm::vec3& center, float radius) const;
+        };
+
+        // True when every triangle of meshlet faces away from cameraPosition. Only valid for meshes
+        // that are closed, since the pipeline does not cull back faces itself.
+        static bool isBackFacing(const LveModel::Meshlet& meshlet, const glm::vec3& cameraPosition);
+    };
+}
+
+#endif /* lve_meshlets_hpp */
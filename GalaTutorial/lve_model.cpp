@@ -1,82 +1,165 @@
 #include "lve_model.hpp"
-#include "lve_utils.hpp"
+#include "lve_mesh_cache.hpp"
+#include "lve_mesh_optimizer.hpp"
+#include "lve_mesh_simplifier.hpp"
+#include "lve_meshlets.hpp"
+#include "lve_obj_parser.hpp"
+#include "lve_vertex_format.hpp"
+#include "lve_vertex_weld_table.hpp"
 
 #define TINYOBJLOADER_IMPLEMENTATION
 #include <tiny_obj_loader.h>
-#define GLM_ENABLE_EXPERIMENTAL
-#include <glm/gtx/hash.hpp>
 
+#include <algorithm>
 #include <cassert>
-#include <iostream>
-#include <unordered_map>
+#include <cmath>
+#include <cstring>
+#include <ostream>
+#include <stdexcept>
 
-namespace std
+namespace lve
 {
-    template<>
-    struct hash<lve::LveModel::Vertex>
+    LveModel::LveModel(
+        LveDevice& device,
+        const LveModel::Builder& builder,
+        std::shared_ptr<LveUploadBatch> uploadBatch)
+    :   _lveDevice{device},
+        _uploadBatch{uploadBatch},
+        _vertexLayout{builder._vertexLayout},
+        _cacheStatisticsBefore{builder._cacheStatisticsBefore},
+        _cacheStatisticsAfter{builder._cacheStatisticsAfter}
     {
-        size_t operator()(lve::LveModel::Vertex const &vertex) const
+        bool ownBatch = _uploadBatch == nullptr;
+        if(ownBatch)
         {
-            size_t seed = 0;
-            lve::hashCombine(seed, vertex.position, vertex.color, vertex.normal, vertex.uv);
-            return seed;
+            _uploadBatch = std::make_shared<LveUploadBatch>(device);
         }
-    };
-}
-
-namespace lve
-{
-    LveModel::LveModel(LveDevice& device, const LveModel::Builder& builder)
-    : _lveDevice{device}
-    {
-        createVertexBuffers(builder._vertices);
-        createIndexBuffers(builder._indices);
+        
+        createVertexBuffers(builder.vertexData(), builder.vertexCount());
+        createIndexBuffers(builder.indexData(), builder.indexCount());
+        
+        if(ownBatch)
+        {
+            _uploadBatch->submit();
+        }
+        
+        if(builder.lodCount() > 0)
+        {
+            _lods.assign(builder.lodData(), builder.lodData() + builder.lodCount());
+        }
+        else
+        {
+            _lods.push_back({0, _hasIndexBuffer ? _indexCount : _vertexCount, 0.f});
+        }
+        
+        // Meshlets are stored in index buffer order, so each level's meshlets are one run of them.
+        _meshlets.assign(builder.meshletData(), builder.meshletData() + builder.meshletCount());
+        for(const Lod& lod : _lods)
+        {
+            auto first = std::lower_bound(
+                _meshlets.begin(),
+                _meshlets.end(),
+                lod.firstIndex,
+                [](const Meshlet& meshlet, uint32_t firstIndex) { return meshlet.firstIndex < firstIndex; });
+            _lodFirstMeshlet.push_back(static_cast<uint32_t>(first - _meshlets.begin()));
+        }
+        _lodFirstMeshlet.push_back(static_cast<uint32_t>(_meshlets.size()));
     }
 
     // TODO make destructor the default implimentation = default.
     LveModel::~LveModel()
-    {}
+    {
+        waitForUpload();
+    }
     
-    std::unique_ptr<LveModel> LveModel::createModelFromFile(LveDevice& device, const std::string& filepath)
+    std::unique_ptr<LveModel> LveModel::createModelFromFile(
+        LveDevice& device,
+        const std::string& filepath,
+        const LoadOptions& options,
+        std::shared_ptr<LveUploadBatch> uploadBatch)
     {
         Builder builder{};
+        builder._vertexLayout = options.vertexLayout;
+        builder._optimizeMesh = options.optimizeMesh;
+        builder._lodCount = options.lodCount;
+        builder._buildMeshlets = options.buildMeshlets;
+        builder._weldEpsilon = options.weldEpsilon;
         builder.loadModel(filepath);
-        std::cout << "Vertex count: " << builder._vertices.size() << "\n";
-        return std::make_unique<LveModel>(device, builder);
+        return std::make_unique<LveModel>(device, builder, uploadBatch);
+    }
+    
+    void LveModel::writeStatistics(std::ostream& out) const
+    {
+        Statistics statistics = getStatistics();
+        out << "Vertex count: " << statistics.vertexCount << "\n";
+        if(statistics.cacheStatisticsAfter.acmr > 0.f)
+        {
+            out << "ACMR " << statistics.cacheStatisticsBefore.acmr << " -> " << statistics.cacheStatisticsAfter.acmr
+                << ", ATVR " << statistics.cacheStatisticsBefore.atvr << " -> " << statistics.cacheStatisticsAfter.atvr << "\n";
+        }
+        out << "Index type: " << (statistics.indexType == VK_INDEX_TYPE_UINT16 ? "uint16" : "uint32")
+            << ", index buffer " << statistics.indexBufferSize << " bytes"
+            << " (" << statistics.indexBytesSaved << " saved)\n";
+        for(uint32_t lod = 0; lod < getLodCount(); lod++)
+        {
+            out << "LOD " << lod << ": " << getTriangleCount(lod) << " triangles, error " << getLod(lod).error;
+            if(getMeshletCount(lod) > 0)
+            {
+                out << ", " << getMeshletCount(lod) << " meshlets";
+            }
+            out << "\n";
+        }
     }
 
-    void LveModel::createVertexBuffers(const std::vector<Vertex> &vertices)
+    // vertices may point into a mapped mesh cache file; with the Full layout it is copied once, straight into
+    // the upload batch's staging memory.
+    void LveModel::createVertexBuffers(const Vertex* vertices, uint32_t vertexCount)
     {
-        _vertexCount = static_cast<uint32_t>(vertices.size());
+        _vertexCount = vertexCount;
         assert(_vertexCount >= 3 && "Vertex count must be at least 3");
-        VkDeviceSize bufferSize = sizeof(vertices[0]) * _vertexCount;
-        uint32_t vertexSize = sizeof(vertices[0]);
         
-        LveBuffer stagingBuffer {
-            _lveDevice,
-            vertexSize,
-            _vertexCount,
-            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        }; // Creates stagingBuffer's VkBuffer buffer and VkDevice memory attributes. Binds these two attributes.
+        // Bounding sphere around the center of the bounding box; computed before encoding so it is in
+        // model space for every layout.
+        glm::vec3 minimum = vertices[0].position;
+        glm::vec3 maximum = vertices[0].position;
+        for(uint32_t i = 1; i < _vertexCount; i++)
+        {
+            minimum = glm::min(minimum, vertices[i].position);
+            maximum = glm::max(maximum, vertices[i].position);
+        }
+        glm::vec3 center = (minimum + maximum) * 0.5f;
+        float radius = 0.f;
+        for(uint32_t i = 0; i < _vertexCount; i++)
+        {
+            radius = std::max(radius, glm::length(vertices[i].position - center));
+        }
+        _boundingSphere = glm::vec4{center, radius};
         
-        stagingBuffer.map(); // Maps stagingBuffer's memory to (void*) mapped
-        stagingBuffer.writeToBuffer((void*)vertices.data()); // Writes from vertices to mapped.
+        uint32_t vertexSize = LveVertexFormat::stride(_vertexLayout);
+        VkDeviceSize bufferSize = static_cast<VkDeviceSize>(vertexSize) * _vertexCount;
         
-        _vertexBuffer = std::make_unique<LveBuffer>(
-            _lveDevice,
-            vertexSize,
-            _vertexCount,
-            VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
-        ); // Creates vertexBuffer's VkBuffer buffer and VkDevice memory attributes. Binds these two attributes.
-        //                   src,                       dst
-        _lveDevice.copyBuffer(stagingBuffer.getBuffer(), _vertexBuffer->getBuffer(), bufferSize); // Copies from stagingBuffer's buffer to vertexBuffer's buffer.
+        // Creates vertexBuffer's VkBuffer buffer and VkDevice memory attributes. Binds these two attributes.
+        _vertexBuffer = createDeviceBuffer(vertexSize, _vertexCount, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+        
+        // Either written in place, or the upload batch copies from its staging memory to vertexBuffer's
+        // buffer when submitted.
+        void* staging = uploadDestination(*_vertexBuffer, bufferSize);
+        if(_vertexLayout == VertexLayout::Full)
+        {
+            memcpy(staging, vertices, static_cast<size_t>(bufferSize));
+        }
+        else
+        {
+            std::vector<char> encoded{};
+            _positionDecode = LveVertexFormat::encode(_vertexLayout, vertices, _vertexCount, encoded);
+            memcpy(staging, encoded.data(), encoded.size());
+        }
+        finishUpload(*_vertexBuffer);
     }
     
-    void LveModel::createIndexBuffers(const std::vector<uint32_t>& indices)
+    void LveModel::createIndexBuffers(const uint32_t* indices, uint32_t indexCount)
     {
-        _indexCount = static_cast<uint32_t>(indices.size());
+        _indexCount = indexCount;
         _hasIndexBuffer = _indexCount > 0;
         
         if(!_hasIndexBuffer)
@@ -84,50 +167,109 @@ namespace lve
             return;
         }
         
-        VkDeviceSize bufferSize = sizeof(indices[0]) * _indexCount;
-        uint32_t indexSize = sizeof(indices[0]);
-        
-        LveBuffer stagingBuffer{
-            _lveDevice,
-            indexSize,
-            _indexCount,
-            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-        };
+        // Primitive restart is disabled, so 0xFFFF is an ordinary index and 65536 vertices fit in 16 bits.
+        uint32_t indexSize = sizeof(uint32_t);
+        _indexType = VK_INDEX_TYPE_UINT32;
+        if(_vertexCount <= 65536)
+        {
+            indexSize = sizeof(uint16_t);
+            _indexType = VK_INDEX_TYPE_UINT16;
+        }
+        VkDeviceSize bufferSize = static_cast<VkDeviceSize>(indexSize) * _indexCount;
         
-        stagingBuffer.map();
-        stagingBuffer.writeToBuffer((void *)indices.data());
+        _indexBuffer = createDeviceBuffer(indexSize, _indexCount, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
         
-        _indexBuffer = std::make_unique<LveBuffer>(
+        void* staging = uploadDestination(*_indexBuffer, bufferSize);
+        if(_indexType == VK_INDEX_TYPE_UINT16)
+        {
+            uint16_t* shortIndices = static_cast<uint16_t*>(staging);
+            for(uint32_t i = 0; i < _indexCount; i++)
+            {
+                assert(indices[i] < _vertexCount && "Index out of range");
+                shortIndices[i] = static_cast<uint16_t>(indices[i]);
+            }
+        }
+        else
+        {
+            memcpy(staging, indices, static_cast<size_t>(bufferSize));
+        }
+        finishUpload(*_indexBuffer);
+    }
+    
+    std::unique_ptr<LveBuffer> LveModel::createDeviceBuffer(
+        VkDeviceSize instanceSize,
+        uint32_t instanceCount,
+        VkBufferUsageFlags usage)
+    {
+        if(_lveDevice.useDirectUpload())
+        {
+            return std::make_unique<LveBuffer>(
+                _lveDevice,
+                instanceSize,
+                instanceCount,
+                usage,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+                1,
+                LveMemoryCategory::Models);
+        }
+        return std::make_unique<LveBuffer>(
             _lveDevice,
-            indexSize,
-            _indexCount,
-            VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-        
-        _lveDevice.copyBuffer(stagingBuffer.getBuffer(), _indexBuffer->getBuffer(), bufferSize);
+            instanceSize,
+            instanceCount,
+            usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            1,
+            LveMemoryCategory::Models);
+    }
+    
+    // Only staged buffers are transfer destinations. Host writes are visible to every later
+    // submission, so directly written buffers need no copy and no barrier.
+    void* LveModel::uploadDestination(LveBuffer& buffer, VkDeviceSize size)
+    {
+        if(!(buffer.getUsageFlags() & VK_BUFFER_USAGE_TRANSFER_DST_BIT))
+        {
+            if(buffer.map() != VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to map model buffer!");
+            }
+            return buffer.getMappedMemory();
+        }
+        return _uploadBatch->reserve(buffer.getBuffer(), 0, size);
+    }
+    
+    void LveModel::finishUpload(LveBuffer& buffer)
+    {
+        if(buffer.getMappedMemory() != nullptr)
+        {
+            buffer.flush();
+            buffer.unmap();
+        }
     }
 
     // Bind vertex buffer to command buffer.
     void LveModel::bind(VkCommandBuffer commandBuffer)
     {
+        waitForUpload();
+        _bindCount++;
+        
         VkBuffer buffers[] = {_vertexBuffer->getBuffer()};
         VkDeviceSize offsets[] = {0};
         vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
         
         if(_hasIndexBuffer)
         {
-            vkCmdBindIndexBuffer(commandBuffer, _indexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+            vkCmdBindIndexBuffer(commandBuffer, _indexBuffer->getBuffer(), 0, _indexType);
         }
         
     }
 
-    // draw primitives, first is assembling primitives.
-    void LveModel::draw(VkCommandBuffer commandBuffer)
+    // draw primitives, first is assembling primitives. lod is clamped to the coarsest level.
+    void LveModel::draw(VkCommandBuffer commandBuffer, uint32_t lod)
     {
         if(_hasIndexBuffer)
         {
-            vkCmdDrawIndexed(commandBuffer, _indexCount, 1, 0, 0, 0);
+            const Lod& level = getLod(lod);
+            vkCmdDrawIndexed(commandBuffer, level.indexCount, 1, level.firstIndex, 0, 0);
         }
         else
         {
@@ -137,6 +279,104 @@ namespace lve
         
     }
 
+    uint64_t LveModel::getBindCount() const
+    {
+        return _bindCount;
+    }
+    
+    bool LveModel::isUploaded()
+    {
+        if(_uploadBatch && _uploadBatch->isComplete())
+        {
+            _uploadBatch = nullptr;
+        }
+        return _uploadBatch == nullptr;
+    }
+    
+    bool LveModel::getUploadSubmission(LveSubmission& submission)
+    {
+        if(isUploaded() || !_uploadBatch->isSubmitted())
+        {
+            return false;
+        }
+        submission = _uploadBatch->getSubmission();
+        return true;
+    }
+    
+    void LveModel::waitForUpload()
+    {
+        if(_uploadBatch)
+        {
+            _uploadBatch->wait();
+            _uploadBatch = nullptr;
+        }
+    }
+    
+    void LveModel::drawRange(VkCommandBuffer commandBuffer, uint32_t firstIndex, uint32_t indexCount)
+    {
+        assert(_hasIndexBuffer && "drawRange needs an index buffer");
+        vkCmdDrawIndexed(commandBuffer, indexCount, 1, firstIndex, 0, 0);
+    }
+    
+    LveModel::VertexLayout LveModel::getVertexLayout() const
+    {
+        return _vertexLayout;
+    }
+    
+    const glm::mat4& LveModel::getPositionDecode() const
+    {
+        return _positionDecode;
+    }
+    
+    uint32_t LveModel::getLodCount() const
+    {
+        return static_cast<uint32_t>(_lods.size());
+    }
+    
+    const LveModel::Lod& LveModel::getLod(uint32_t lod) const
+    {
+        return _lods[std::min(lod, getLodCount() - 1)];
+    }
+    
+    uint32_t LveModel::getTriangleCount(uint32_t lod) const
+    {
+        return getLod(lod).indexCount / 3;
+    }
+    
+    const glm::vec4& LveModel::getBoundingSphere() const
+    {
+        return _boundingSphere;
+    }
+    
+    uint32_t LveModel::getMeshletCount(uint32_t lod) const
+    {
+        lod = std::min(lod, getLodCount() - 1);
+        return _lodFirstMeshlet[lod + 1] - _lodFirstMeshlet[lod];
+    }
+    
+    const LveModel::Meshlet* LveModel::getMeshlets(uint32_t lod) const
+    {
+        return _meshlets.data() + _lodFirstMeshlet[std::min(lod, getLodCount() - 1)];
+    }
+    
+    LveModel::Statistics LveModel::getStatistics() const
+    {
+        Statistics statistics{};
+        statistics.vertexCount = _vertexCount;
+        statistics.indexCount = _hasIndexBuffer ? _indexCount : 0;
+        statistics.indexType = _indexType;
+        statistics.vertexBufferSize = _vertexBuffer->getBufferSize();
+        statistics.cacheStatisticsBefore = _cacheStatisticsBefore;
+        statistics.cacheStatisticsAfter = _cacheStatisticsAfter;
+        if(_hasIndexBuffer)
+        {
+            statistics.indexBufferSize = _indexBuffer->getBufferSize();
+            statistics.indexBytesSaved =
+                static_cast<VkDeviceSize>(_indexCount) * sizeof(uint32_t) - statistics.indexBufferSize;
+        }
+        return statistics;
+    }
+
     std::vector<VkVertexInputBindingDescription> LveModel::Vertex::getBindingDescriptions()
     {
         std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
@@ -164,6 +404,210 @@ namespace lve
     
     void LveModel::Builder::loadModel(const std::string &filepath)
     {
+        _vertices.clear();
+        _indices.clear();
+        _lods.clear();
+        _meshlets.clear();
+        _cacheFile = nullptr;
+        
+        std::shared_ptr<LveMappedFile> source = LveMappedFile::open(filepath);
+        if(source == nullptr)
+        {
+            throw std::runtime_error("failed to open file: " + filepath);
+        }
+        
+        uint64_t sourceHash = LveMeshCache::hashBytes(source->data(), source->size());
+        if(LveMeshCache::load(filepath, sourceHash, optionsHash(), *this))
+        {
+            return;
+        }
+        
+        if(_parseThreadCount == 1 ||
+           !LveObjParser::parse(source->data(), source->size(), _parseThreadCount, _vertices, _indices))
+        {
+            parseObj(filepath);
+        }
+        if(_weldEpsilon > 0.f)
+        {
+            LveVertexWeldTable::weld(_vertices, _indices, _weldEpsilon);
+        }
+        if(_optimizeMesh)
+        {
+            optimizeMesh();
+        }
+        if(_lodCount > 1)
+        {
+            buildLods();
+        }
+        if(_buildMeshlets)
+        {
+            buildMeshlets();
+        }
+        LveMeshCache::store(filepath, sourceHash, optionsHash(), *this);
+    }
+    
+    uint64_t LveModel::Builder::optionsHash() const
+    {
+        struct
+        {
+            float weldEpsilon;
+            uint32_t optimizeMesh;
+            uint32_t lodCount;
+            uint32_t buildMeshlets;
+        } options{};
+        options.weldEpsilon = _weldEpsilon > 0.f ? _weldEpsilon : 0.f;
+        options.optimizeMesh = _optimizeMesh ? 1 : 0;
+        options.lodCount = std::min(std::max(_lodCount, 1u), MAX_LOD_COUNT);
+        options.buildMeshlets = _buildMeshlets ? 1 : 0;
+        return LveMeshCache::hashBytes(&options, sizeof(options));
+    }
+    
+    void LveModel::Builder::optimizeMesh()
+    {
+        _cacheStatisticsBefore = LveMeshOptimizer::analyzeVertexCache(_indices, _vertices.size());
+        
+        LveMeshOptimizer::optimizeVertexCache(_indices, _vertices.size());
+        LveMeshOptimizer::optimizeOverdraw(_indices, _vertices);
+        LveMeshOptimizer::optimizeVertexFetch(_vertices, _indices);
+        
+        _cacheStatisticsAfter = LveMeshOptimizer::analyzeVertexCache(_indices, _vertices.size());
+    }
+    
+    // Every level is simplified from the full resolution one, so errors do not accumulate through the
+    // chain, and gets its own vertex cache optimization. The error stored for a level is at least that
+    // of the previous level so the errors increase with the level.
+    void LveModel::Builder::buildLods()
+    {
+        _lods.clear();
+        if(_indices.empty())
+        {
+            return;
+        }
+        
+        const uint32_t fullIndexCount = static_cast<uint32_t>(_indices.size());
+        _lods.push_back({0, fullIndexCount, 0.f});
+        
+        // Relative to the largest extent of the mesh; the error of each level is usually well below it.
+        const float targetError = 0.05f;
+        const uint32_t lodCount = std::min(_lodCount, MAX_LOD_COUNT);
+        
+        for(uint32_t level = 1; level < lodCount; level++)
+        {
+            size_t targetIndexCount = (fullIndexCount / 3 >> level) * 3;
+            float error = 0.f;
+            std::vector<uint32_t> indices = LveMeshSimplifier::simplify(
+                _vertices,
+                std::vector<uint32_t>(_indices.begin(), _indices.begin() + fullIndexCount),
+                targetIndexCount,
+                targetError,
+                &error);
+            
+            // Stop once simplification no longer removes a useful share of the previous level.
+            if(indices.empty() || indices.size() > _lods.back().indexCount * 9 / 10)
+            {
+                break;
+            }
+            LveMeshOptimizer::optimizeVertexCache(indices, _vertices.size());
+            
+            Lod lod{};
+            lod.firstIndex = static_cast<uint32_t>(_indices.size());
+            lod.indexCount = static_cast<uint32_t>(indices.size());
+            lod.error = std::max(error, _lods.back().error);
+            _lods.push_back(lod);
+            _indices.insert(_indices.end(), indices.begin(), indices.end());
+        }
+    }
+    
+    void LveModel::Builder::buildMeshlets()
+    {
+        _meshlets.clear();
+        if(_lods.empty())
+        {
+            LveMeshlets::build(_vertices, _indices, 0, static_cast<uint32_t>(_indices.size()), _meshlets);
+            return;
+        }
+        for(const Lod& lod : _lods)
+        {
+            LveMeshlets::build(_vertices, _indices, lod.firstIndex, lod.indexCount, _meshlets);
+        }
+    }
+    
+    const LveModel::Vertex* LveModel::Builder::vertexData() const
+    {
+        if(_cacheFile)
+        {
+            return reinterpret_cast<const Vertex*>(_cacheFile->data() + sizeof(LveMeshCache::Header));
+        }
+        return _vertices.data();
+    }
+    
+    uint32_t LveModel::Builder::vertexCount() const
+    {
+        if(_cacheFile)
+        {
+            return reinterpret_cast<const LveMeshCache::Header*>(_cacheFile->data())->vertexCount;
+        }
+        return static_cast<uint32_t>(_vertices.size());
+    }
+    
+    const uint32_t* LveModel::Builder::indexData() const
+    {
+        if(_cacheFile)
+        {
+            return reinterpret_cast<const uint32_t*>(vertexData() + vertexCount());
+        }
+        return _indices.data();
+    }
+    
+    uint32_t LveModel::Builder::indexCount() const
+    {
+        if(_cacheFile)
+        {
+            return reinterpret_cast<const LveMeshCache::Header*>(_cacheFile->data())->indexCount;
+        }
+        return static_cast<uint32_t>(_indices.size());
+    }
+    
+    const LveModel::Lod* LveModel::Builder::lodData() const
+    {
+        if(_cacheFile)
+        {
+            return reinterpret_cast<const Lod*>(indexData() + indexCount());
+        }
+        return _lods.data();
+    }
+    
+    uint32_t LveModel::Builder::lodCount() const
+    {
+        if(_cacheFile)
+        {
+            return reinterpret_cast<const LveMeshCache::Header*>(_cacheFile->data())->lodCount;
+        }
+        return static_cast<uint32_t>(_lods.size());
+    }
+    
+    const LveModel::Meshlet* LveModel::Builder::meshletData() const
+    {
+        if(_cacheFile)
+        {
+            return reinterpret_cast<const Meshlet*>(lodData() + lodCount());
+        }
+        return _meshlets.data();
+    }
+    
+    uint32_t LveModel::Builder::meshletCount() const
+    {
+        if(_cacheFile)
+        {
+            return reinterpret_cast<const LveMeshCache::Header*>(_cacheFile->data())->meshletCount;
+        }
+        return static_cast<uint32_t>(_meshlets.size());
+    }
+    
+    void LveModel::Builder::parseObj(const std::string &filepath)
+    {
+        _cacheFile = nullptr;
+        
         tinyobj::attrib_t attrib;
         std::vector<tinyobj::shape_t> shapes;
         std::vector<tinyobj::material_t> materials;
@@ -177,7 +621,13 @@ namespace lve
         _vertices.clear();
         _indices.clear();
         
-        std::unordered_map<Vertex, uint32_t> uniqueVertices{};
+        size_t cornerCount = 0;
+        for(const auto& shape : shapes)
+        {
+            cornerCount += shape.mesh.indices.size();
+        }
+        _indices.reserve(cornerCount);
+        LveVertexWeldTable uniqueVertices{_vertices, cornerCount};
         
         for(const auto& shape : shapes)
         {
@@ -215,17 +665,12 @@ namespace lve
                 {
                     vertex.uv =
                     {
-                        attrib.texcoords[2 * index.normal_index + 0],
-                        attrib.texcoords[2 * index.normal_index + 1]
+                        attrib.texcoords[2 * index.texcoord_index + 0],
+                        attrib.texcoords[2 * index.texcoord_index + 1]
                     };
                 }
                 
-                if(uniqueVertices.count(vertex) == 0)
-                {
-                    uniqueVertices[vertex] = static_cast<uint32_t>(_vertices.size());
-                    _vertices.push_back(vertex);
-                }
-                _indices.push_back(uniqueVertices[vertex]);
+                _indices.push_back(uniqueVertices.findOrInsert(vertex));
             }
         }
     }
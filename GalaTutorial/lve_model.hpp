@@ -1,15 +1,22 @@
 #pragma once
 #include "lve_buffer.hpp"
 #include "lve_device.hpp"
+#include "lve_upload_batch.hpp"
+#include "lve_utils.hpp"
 #include <glm/glm.hpp>
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/hash.hpp>
 #include <vector>
 #include <memory>
+#include <iosfwd>
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 //
 namespace lve
 {
+    class LveMappedFile;
+    
     class LveModel
     {
         public:
@@ -32,38 +39,266 @@ namespace lve
             }
         };
         
+        // Vertex buffer encoding, see LveVertexFormat. The compact layouts are 20 bytes per vertex.
+        enum class VertexLayout : uint32_t
+        {
+            Full,                       // Vertex as is, 32 bit floats
+            CompactHalfPosition,        // half float position
+            CompactNormalizedPosition   // 16 bit unorm position within the model's bounds
+        };
+        
+        static constexpr uint32_t VERTEX_LAYOUT_COUNT = 3;
+        
+        // Post-transform vertex cache efficiency of an index buffer, see LveMeshOptimizer.
+        struct VertexCacheStatistics
+        {
+            float acmr = 0.f; // vertices transformed per triangle, 0.5 (best) to 3
+            float atvr = 0.f; // vertices transformed per vertex used, 1 (best) to 6
+        };
+        
+        // One level of detail: a range of the shared index buffer. error estimates the distance, in
+        // model space, by which the simplified surface deviates from the full resolution one.
+        struct Lod
+        {
+            uint32_t firstIndex;
+            uint32_t indexCount;
+            float    error;
+        };
+        
+        static constexpr uint32_t MAX_LOD_COUNT = 8;
+        
+        // A cluster of triangles that can be culled as a whole; see LveMeshlets. The triangles of each
+        // level of detail are split separately, so every meshlet lies within one Lod's index range.
+        struct Meshlet
+        {
+            glm::vec3 center;
+            float     radius;
+            glm::vec3 coneAxis;
+            float     coneCutoff;
+            uint32_t  firstIndex;
+            uint32_t  indexCount;
+        };
+        
+        // Sizes of a model's GPU buffers, from getStatistics().
+        struct Statistics
+        {
+            uint32_t     vertexCount = 0;
+            uint32_t     indexCount = 0;
+            VkIndexType  indexType = VK_INDEX_TYPE_UINT32;
+            VkDeviceSize vertexBufferSize = 0;
+            VkDeviceSize indexBufferSize = 0;
+            
+            // Index buffer bytes saved over 32 bit indices.
+            VkDeviceSize indexBytesSaved = 0;
+            
+            // From the Builder; zero unless the mesh was optimized while loading it.
+            VertexCacheStatistics cacheStatisticsBefore{};
+            VertexCacheStatistics cacheStatisticsAfter{};
+        };
+        
+        // How createModelFromFile() builds a model; each option sets the Builder field of the same name.
+        struct LoadOptions
+        {
+            VertexLayout vertexLayout = VertexLayout::Full;
+            bool         optimizeMesh = false;
+            uint32_t     lodCount = 1;
+            bool         buildMeshlets = false;
+            float        weldEpsilon = 0.f;
+        };
+        
         struct Builder
         {
             std::vector<Vertex> _vertices{};
             std::vector<uint32_t> _indices{};
             
+            // Set when the model came from the binary mesh cache. _vertices and _indices are then
+            // empty, and vertexData() and indexData() point into the mapped cache file.
+            std::shared_ptr<LveMappedFile> _cacheFile{};
+            
+            // Threads used to parse .obj files on a cache miss. 0 uses all hardware threads, 1 uses tinyobj.
+            unsigned _parseThreadCount = 0;
+            
+            // When > 0, loadModel() also merges vertices whose positions are within this distance and
+            // whose other attributes are equal. See LveVertexWeldTable.
+            float _weldEpsilon = 0.f;
+            
+            // When true, loadModel() reorders triangles for the vertex cache and for less overdraw, and
+            // vertices for fetch locality. The result is stored in the mesh cache.
+            bool _optimizeMesh = false;
+            
+            // Levels of detail built by loadModel(), including the full resolution one. Each level has
+            // about half the triangles of the previous; fewer levels are built when simplification
+            // stops paying off. The levels are appended to _indices and listed in _lods.
+            uint32_t _lodCount = 1;
+            std::vector<Lod> _lods{};
+            
+            // When true, loadModel() splits every level of detail into meshlets, reordering its
+            // triangles. Back facing meshlets are culled, so this is only for closed meshes.
+            bool _buildMeshlets = false;
+            std::vector<Meshlet> _meshlets{};
+            
+            // Encoding of the vertex buffer created from this builder.
+            VertexLayout _vertexLayout = VertexLayout::Full;
+            
+            // Set by optimizeMesh(); left at zero when the model came from the mesh cache.
+            VertexCacheStatistics _cacheStatisticsBefore{};
+            VertexCacheStatistics _cacheStatisticsAfter{};
+            
+            // Loads from filepath's mesh cache if it is up to date, otherwise parses the .obj file
+            // and writes a new cache.
             void loadModel(const std::string &filepath);
+            
+            // Serial tinyobj parse, bypassing the cache. Reference for the parallel parser.
+            void parseObj(const std::string &filepath);
+            
+            // Runs the LveMeshOptimizer passes on _vertices and _indices.
+            void optimizeMesh();
+            
+            // Simplifies _indices into _lodCount - 1 more levels (see LveMeshSimplifier).
+            void buildLods();
+            
+            // Splits every level of detail into meshlets (see LveMeshlets).
+            void buildMeshlets();
+            
+            // Hash of the options that change loadModel()'s output. Stored in the mesh cache, so a
+            // cache written with other options is a miss.
+            uint64_t optionsHash() const;
+            
+            const Vertex* vertexData() const;
+            uint32_t vertexCount() const;
+            const uint32_t* indexData() const;
+            uint32_t indexCount() const;
+            
+            // Empty (lodCount() 0) when no levels were built; the whole index buffer is then one level.
+            const Lod* lodData() const;
+            uint32_t lodCount() const;
+            const Meshlet* meshletData() const;
+            uint32_t meshletCount() const;
         };
         
-        LveModel(LveDevice& device, const LveModel::Builder& builder);
+        // Buffer contents are uploaded with uploadBatch, which the model keeps until its first bind().
+        // Without one the model submits its own batch. Either way construction does not wait for
+        // the GPU.
+        LveModel(
+            LveDevice& device,
+            const LveModel::Builder& builder,
+            std::shared_ptr<LveUploadBatch> uploadBatch = nullptr);
+        
+        // Waits for a pending upload, which still writes to this model's buffers.
         ~LveModel();
         
         LveModel(const LveModel& o) = delete;
         LveModel& operator=(const LveModel& o) = delete;
         
-        static std::unique_ptr<LveModel> createModelFromFile(LveDevice& device, const std::string& filepath);
+        // Prints nothing, so it may run on a loader thread; see writeStatistics().
+        static std::unique_ptr<LveModel> createModelFromFile(
+            LveDevice& device,
+            const std::string& filepath,
+            const LoadOptions& options,
+            std::shared_ptr<LveUploadBatch> uploadBatch = nullptr);
         
+        // The first bind() submits the upload batch if nobody has and waits for it to complete.
         void bind(VkCommandBuffer commandBuffer);
-        void draw(VkCommandBuffer commandBuffer);
+        
+        bool isUploaded();
+        
+        // The submission that completes the upload of the buffers. False once they are uploaded and
+        // while their batch is not submitted yet.
+        bool getUploadSubmission(LveSubmission& submission);
+        
+        // Number of bind() calls so far; LveModelRegistry uses it to tell which models are drawn.
+        uint64_t getBindCount() const;
+        
+        void draw(VkCommandBuffer commandBuffer, uint32_t lod = 0);
+        
+        // Draws indexCount indices from firstIndex, e.g. a run of visible meshlets.
+        void drawRange(VkCommandBuffer commandBuffer, uint32_t firstIndex, uint32_t indexCount);
+        
+        uint32_t getLodCount() const;
+        const Lod& getLod(uint32_t lod) const;
+        uint32_t getTriangleCount(uint32_t lod) const;
+        
+        // Model space bounding sphere: center in xyz, radius in w.
+        const glm::vec4& getBoundingSphere() const;
+        
+        // Meshlets of level lod, in index buffer order. Empty if the model was built without meshlets.
+        uint32_t getMeshletCount(uint32_t lod) const;
+        const Meshlet* getMeshlets(uint32_t lod) const;
+        
+        VertexLayout getVertexLayout() const;
+        
+        Statistics getStatistics() const;
+        
+        // Vertex and index counts, vertex cache efficiency, index type and levels of detail, one
+        // line each.
+        void writeStatistics(std::ostream& out) const;
+        
+        // Maps positions as stored in the vertex buffer to model space. Identity unless the layout
+        // stores normalized positions; multiply the model matrix by it.
+        const glm::mat4& getPositionDecode() const;
         
         private:
         
-        void createVertexBuffers(const std::vector<Vertex> &vertices);
-        void createIndexBuffers(const std::vector<uint32_t>& indices);
+        void createVertexBuffers(const Vertex* vertices, uint32_t vertexCount);
+        void createIndexBuffers(const uint32_t* indices, uint32_t indexCount);
+        void waitForUpload();
+        
+        // A device local buffer: host visible when the device uses direct uploads, otherwise a
+        // transfer destination.
+        std::unique_ptr<LveBuffer> createDeviceBuffer(
+            VkDeviceSize instanceSize,
+            uint32_t instanceCount,
+            VkBufferUsageFlags usage);
+        
+        // Where to write size bytes of buffer's contents: its own mapping, or upload batch staging
+        // memory that is copied to it.
+        void* uploadDestination(LveBuffer& buffer, VkDeviceSize size);
+        
+        // Makes writes through a mapping visible to the device; nothing to do for staged buffers.
+        void finishUpload(LveBuffer& buffer);
         
         LveDevice& _lveDevice;
         
+        // Released once the upload has completed.
+        std::shared_ptr<LveUploadBatch> _uploadBatch;
+        
         std::unique_ptr<LveBuffer> _vertexBuffer;
         uint32_t _vertexCount;
+        VertexLayout _vertexLayout;
+        glm::mat4 _positionDecode{1.f};
         
         bool _hasIndexBuffer = false;
         std::unique_ptr<LveBuffer> _indexBuffer;
         uint32_t _indexCount;
         
+        // VK_INDEX_TYPE_UINT16 whenever every vertex can be addressed with 16 bits.
+        VkIndexType _indexType = VK_INDEX_TYPE_UINT32;
+        
+        std::vector<Lod> _lods{};
+        glm::vec4 _boundingSphere{0.f};
+        
+        VertexCacheStatistics _cacheStatisticsBefore{};
+        VertexCacheStatistics _cacheStatisticsAfter{};
+        
+        // Meshlets of every level, and the first meshlet of each level (one extra entry at the end).
+        std::vector<Meshlet> _meshlets{};
+        std::vector<uint32_t> _lodFirstMeshlet{};
+        
+        uint64_t _bindCount = 0;
+        
+    };
+}
+
+namespace std
+{
+    template<>
+    struct hash<lve::LveModel::Vertex>
+    {
+        size_t operator()(lve::LveModel::Vertex const &vertex) const
+        {
+            size_t seed = 0;
+            lve::hashCombine(seed, vertex.position, vertex.color, vertex.normal, vertex.uv);
+            return seed;
+        }
     };
 }
@@ -0,0 +1,186 @@
+#include "lve_model_registry.hpp"
+#include "lve_mesh_cache.hpp"
+
+// std
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+#include <vector>
+
+// posix
+#include <sys/stat.h>
+
+namespace lve
+{
+    LveModelRegistry::LveModelRegistry(LveDevice& device, VkDeviceSize budget)
+    :   _lveDevice{device}
+    {
+        _statistics.budget = budget;
+    }
+
+    std::shared_ptr<LveModel> LveModelRegistry::acquire(
+        const std::string& filepath,
+        const LveModel::LoadOptions& options,
+        std::shared_ptr<LveUploadBatch> uploadBatch)
+    {
+        std::error_code error{};
+        std::string canonicalPath = std::filesystem::weakly_canonical(filepath, error).string();
+        if (error)
+        {
+            canonicalPath = filepath;
+        }
+        const Key key{
+            contentHash(canonicalPath),
+            static_cast<uint32_t>(options.vertexLayout),
+            options.optimizeMesh,
+            options.lodCount,
+            options.buildMeshlets,
+            options.weldEpsilon};
+
+        {
+            // Another thread loading the same model finishes it instead of loading it twice.
+            std::unique_lock<std::mutex> lock{_mutex};
+            _loaded.wait(lock, [&] { return _loading.count(key) == 0; });
+            auto found = _entries.find(key);
+            if (found != _entries.end())
+            {
+                _statistics.hits++;
+                return found->second.model;
+            }
+            _statistics.misses++;
+            _loading.insert(key);
+        }
+
+        std::shared_ptr<LveModel> model{};
+        try
+        {
+            model = LveModel::createModelFromFile(_lveDevice, filepath, options, uploadBatch);
+        }
+        catch (...)
+        {
+            {
+                std::lock_guard<std::mutex> lock{_mutex};
+                _loading.erase(key);
+            }
+            _loaded.notify_all();
+            throw;
+        }
+
+        LveModel::Statistics modelStatistics = model->getStatistics();
+        {
+            std::lock_guard<std::mutex> lock{_mutex};
+            Entry entry{};
+            entry.model = model;
+            entry.bytes = modelStatistics.vertexBufferSize + modelStatistics.indexBufferSize;
+            entry.bindCount = 0;
+            entry.lastDrawnFrame = _frame;
+            _entries.emplace(key, std::move(entry));
+            _loading.erase(key);
+            _statistics.modelCount = static_cast<uint32_t>(_entries.size());
+            _statistics.residentBytes += modelStatistics.vertexBufferSize + modelStatistics.indexBufferSize;
+        }
+        _loaded.notify_all();
+        return model;
+    }
+
+    void LveModelRegistry::endFrame()
+    {
+        std::vector<std::shared_ptr<LveModel>> evicted{};
+        evict(evicted);
+
+        // Destroyed once the submissions that may draw them have completed.
+        for (std::shared_ptr<LveModel>& model : evicted)
+        {
+            _lveDevice.deferDestruction([model = std::move(model)]() mutable { model.reset(); });
+        }
+    }
+
+    void LveModelRegistry::evict(std::vector<std::shared_ptr<LveModel>>& evicted)
+    {
+        std::lock_guard<std::mutex> lock{_mutex};
+        _frame++;
+
+        std::vector<std::map<Key, Entry>::iterator> candidates{};
+        for (auto it = _entries.begin(); it != _entries.end(); it++)
+        {
+            Entry& entry = it->second;
+            uint64_t bindCount = entry.model->getBindCount();
+            if (bindCount != entry.bindCount)
+            {
+                entry.bindCount = bindCount;
+                entry.lastDrawnFrame = _frame;
+            }
+            if (entry.model.use_count() == 1)
+            {
+                candidates.push_back(it);
+            }
+        }
+
+        if (_statistics.residentBytes <= _statistics.budget)
+        {
+            return;
+        }
+
+        std::sort(
+            candidates.begin(),
+            candidates.end(),
+            [](const auto& a, const auto& b) { return a->second.lastDrawnFrame < b->second.lastDrawnFrame; });
+        for (auto& candidate : candidates)
+        {
+            if (_statistics.residentBytes <= _statistics.budget)
+            {
+                break;
+            }
+            _statistics.residentBytes -= candidate->second.bytes;
+            _statistics.evictions++;
+            evicted.push_back(std::move(candidate->second.model));
+            _entries.erase(candidate);
+        }
+        _statistics.modelCount = static_cast<uint32_t>(_entries.size());
+    }
+
+    void LveModelRegistry::setBudget(VkDeviceSize budget)
+    {
+        std::lock_guard<std::mutex> lock{_mutex};
+        _statistics.budget = budget;
+    }
+
+    LveModelRegistry::Statistics LveModelRegistry::getStatistics() const
+    {
+        std::lock_guard<std::mutex> lock{_mutex};
+        return _statistics;
+    }
+
+    uint64_t LveModelRegistry::contentHash(const std::string& canonicalPath)
+    {
+        struct stat fileStat{};
+        if (stat(canonicalPath.c_str(), &fileStat) != 0)
+        {
+            throw std::runtime_error("failed to open file: " + canonicalPath);
+        }
+        const int64_t modificationTime = static_cast<int64_t>(fileStat.st_mtime);
+        const uint64_t size = static_cast<uint64_t>(fileStat.st_size);
+
+        {
+            std::lock_guard<std::mutex> lock{_mutex};
+            auto found = _stamps.find(canonicalPath);
+            if (found != _stamps.end() &&
+                found->second.modificationTime == modificationTime &&
+                found->second.size == size)
+            {
+                return found->second.contentHash;
+            }
+        }
+
+        std::shared_ptr<LveMappedFile> file = LveMappedFile::open(canonicalPath);
+        if (file == nullptr)
+        {
+            throw std::runtime_error("failed to open file: " + canonicalPath);
+        }
+        uint64_t hash = LveMeshCache::hashBytes(file->data(), file->size());
+
+        std::lock_guard<std::mutex> lock{_mutex};
+        _stamps[canonicalPath] = {modificationTime, size, hash};
+        return hash;
+    }
+}
@@ -0,0 +1,111 @@
+#ifndef lve_model_registry_hpp
+#define lve_model_registry_hpp
+
+#pragma once
+
+#include "lve_device.hpp"
+#include "lve_model.hpp"
+#include "lve_upload_batch.hpp"
+
+// std
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace lve
+{
+    // Shares models between everything that loads the same file. A model is identified by the hash of
+    // its source file's content and the options it is built with, so the same file under two paths
+    // and a file that changed on disk are both handled; canonical paths only spare re-hashing files
+    // whose size and modification time did not change.
+    //
+    // The registry keeps every model it loaded and tracks the device local bytes of their buffers.
+    // While those exceed the budget, endFrame() evicts models nobody else references, least recently
+    // drawn first. Evicted models are handed to LveDevice::deferDestruction(), since submitted command
+    // buffers may still read their buffers.
+    //
+    // acquire() may be called from any thread; endFrame() and destruction belong on the render thread.
+    class LveModelRegistry
+    {
+        public:
+
+        static constexpr VkDeviceSize DEFAULT_BUDGET = 256 * 1024 * 1024;
+
+        struct Statistics
+        {
+            uint64_t     hits = 0;
+            uint64_t     misses = 0;
+            uint64_t     evictions = 0;
+            uint32_t     modelCount = 0;
+            VkDeviceSize residentBytes = 0;
+            VkDeviceSize budget = 0;
+        };
+
+        explicit LveModelRegistry(LveDevice& device, VkDeviceSize budget = DEFAULT_BUDGET);
+
+        LveModelRegistry(const LveModelRegistry&) = delete;
+        LveModelRegistry& operator=(const LveModelRegistry&) = delete;
+
+        // Returns the registered model for filepath and these options, loading it on a miss with
+        // LveModel::createModelFromFile(). uploadBatch is only used on a miss.
+        std::shared_ptr<LveModel> acquire(
+            const std::string& filepath,
+            const LveModel::LoadOptions& options = {},
+            std::shared_ptr<LveUploadBatch> uploadBatch = nullptr);
+
+        // Call once per frame after submitting it: notes which models were drawn and evicts while over
+        // budget.
+        void endFrame();
+
+        // Takes effect at the next endFrame().
+        void setBudget(VkDeviceSize budget);
+
+        Statistics getStatistics() const;
+
+        private:
+
+        // Source content hash, then the load options: vertex layout, mesh optimization, level of
+        // detail count, meshlets and weld epsilon.
+        using Key = std::tuple<uint64_t, uint32_t, bool, uint32_t, bool, float>;
+
+        struct Entry
+        {
+            std::shared_ptr<LveModel> model;
+            VkDeviceSize bytes;
+            uint64_t bindCount;
+            uint64_t lastDrawnFrame;
+        };
+
+        struct FileStamp
+        {
+            int64_t  modificationTime;
+            uint64_t size;
+            uint64_t contentHash;
+        };
+
+        // Hash of filepath's content, reusing the stamp of an unchanged file.
+        uint64_t contentHash(const std::string& canonicalPath);
+
+        // Moves the models endFrame() evicts into evicted, under the lock.
+        void evict(std::vector<std::shared_ptr<LveModel>>& evicted);
+
+        LveDevice&                        _lveDevice;
+
+        mutable std::mutex                _mutex;
+        std::condition_variable           _loaded;
+        std::map<Key, Entry>              _entries{};
+        std::set<Key>                     _loading{};
+        std::map<std::string, FileStamp>  _stamps{};
+
+        uint64_t                          _frame = 0;
+        Statistics                        _statistics{};
+    };
+}
+
+#endif /* lve_model_registry_hpp */
@@ -0,0 +1,600 @@
+#include "lve_obj_parser.hpp"
+#include "lve_vertex_weld_table.hpp"
+
+// std
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <thread>
+
+namespace lve
+{
+    namespace
+    {
+        // Files smaller than this are parsed as a single chunk; thread start up would cost more than it saves.
+        constexpr size_t MIN_CHUNK_SIZE = 64 * 1024;
+
+        // One face corner. Indices are zero based. A corner whose index was negative (relative to the
+        // end of the list) holds the chunk local position until the chunk's base offset is known.
+        struct Corner
+        {
+            int32_t v;
+            int32_t vt;
+            int32_t vn;
+            uint8_t relative; // RELATIVE_* bits
+        };
+
+        constexpr uint8_t RELATIVE_V  = 1;
+        constexpr uint8_t RELATIVE_VT = 2;
+        constexpr uint8_t RELATIVE_VN = 4;
+
+        struct Chunk
+        {
+            const char* begin;
+            const char* end;
+
+            std::vector<float> positions{};
+            std::vector<float> colors{};
+            std::vector<float> normals{};
+            std::vector<float> texcoords{};
+            std::vector<Corner> corners{};
+
+            bool valid = true;
+
+            // Offsets of this chunk's elements in the whole file.
+            size_t positionBase = 0;
+            size_t normalBase = 0;
+            size_t texcoordBase = 0;
+            size_t indexBase = 0;
+
+            std::vector<LveModel::Vertex> uniqueVertices{};
+            std::vector<uint32_t> localIndices{};
+        };
+
+        bool isSpace(char c)
+        {
+            return c == ' ' || c == '\t';
+        }
+
+        bool isDigit(char c)
+        {
+            return c >= '0' && c <= '9';
+        }
+
+        // Mirrors tinyobj's tryParseDouble(), so the parsed values are bit for bit the same.
+        bool tryParseDouble(const char* s, const char* sEnd, double* result)
+        {
+            if (s >= sEnd)
+            {
+                return false;
+            }
+
+            double mantissa = 0.0;
+            int exponent = 0;
+            char sign = '+';
+            char expSign = '+';
+            const char* curr = s;
+            int read = 0;
+            bool endNotReached = false;
+            bool leadingDecimalDots = false;
+
+            if (*curr == '+' || *curr == '-')
+            {
+                sign = *curr;
+                curr++;
+                if ((curr != sEnd) && (*curr == '.'))
+                {
+                    leadingDecimalDots = true;
+                }
+            }
+            else if (isDigit(*curr))
+            {
+            }
+            else if (*curr == '.')
+            {
+                leadingDecimalDots = true;
+            }
+            else
+            {
+                return false;
+            }
+
+            endNotReached = (curr != sEnd);
+            if (!leadingDecimalDots)
+            {
+                while (endNotReached && isDigit(*curr))
+                {
+                    mantissa *= 10;
+                    mantissa += static_cast<int>(*curr - 0x30);
+                    curr++;
+                    read++;
+                    endNotReached = (curr != sEnd);
+                }
+
+                if (read == 0)
+                {
+                    return false;
+                }
+            }
+
+            if (endNotReached)
+            {
+                if (*curr == '.')
+                {
+                    curr++;
+                    read = 1;
+                    endNotReached = (curr != sEnd);
+                    while (endNotReached && isDigit(*curr))
+                    {
+                        static const double powLut[] =
+                            {1.0, 0.1, 0.01, 0.001, 0.0001, 0.00001, 0.000001, 0.0000001};
+                        const int lutEntries = sizeof powLut / sizeof powLut[0];
+
+                        mantissa += static_cast<int>(*curr - 0x30) *
+                            (read < lutEntries ? powLut[read] : std::pow(10.0, -read));
+                        read++;
+                        curr++;
+                        endNotReached = (curr != sEnd);
+                    }
+                }
+
+                if (endNotReached && (*curr == 'e' || *curr == 'E'))
+                {
+                    curr++;
+                    endNotReached = (curr != sEnd);
+                    if (endNotReached && (*curr == '+' || *curr == '-'))
+                    {
+                        expSign = *curr;
+                        curr++;
+                    }
+                    else if (endNotReached && isDigit(*curr))
+                    {
+                    }
+                    else
+                    {
+                        return false;
+                    }
+
+                    read = 0;
+                    endNotReached = (curr != sEnd);
+                    while (endNotReached && isDigit(*curr))
+                    {
+                        if (exponent > std::numeric_limits<int>::max() / 10)
+                        {
+                            return false;
+                        }
+                        exponent *= 10;
+                        exponent += static_cast<int>(*curr - 0x30);
+                        curr++;
+                        read++;
+                        endNotReached = (curr != sEnd);
+                    }
+                    exponent *= (expSign == '+' ? 1 : -1);
+                    if (read == 0)
+                    {
+                        return false;
+                    }
+                }
+            }
+
+            *result = (sign == '+' ? 1 : -1) *
+                (exponent ? std::ldexp(mantissa * std::pow(5.0, exponent), exponent) : mantissa);
+            return true;
+        }
+
+        // Reads the next whitespace separated token of [token, lineEnd) as a real.
+        bool parseReal(const char*& token, const char* lineEnd, float& out)
+        {
+            while (token < lineEnd && isSpace(*token)) token++;
+            const char* end = token;
+            while (end < lineEnd && !isSpace(*end) && *end != '\r') end++;
+
+            double value = 0.0;
+            bool parsed = tryParseDouble(token, end, &value);
+            if (parsed)
+            {
+                out = static_cast<float>(value);
+            }
+            token = end;
+            return parsed;
+        }
+
+        float parseRealOr(const char*& token, const char* lineEnd, float fallback)
+        {
+            float value = fallback;
+            parseReal(token, lineEnd, value);
+            return value;
+        }
+
+        // atoi() semantics on a range that need not be null terminated.
+        int parseInt(const char* token, const char* lineEnd)
+        {
+            while (token < lineEnd && isSpace(*token)) token++;
+            bool negative = false;
+            if (token < lineEnd && (*token == '+' || *token == '-'))
+            {
+                negative = *token == '-';
+                token++;
+            }
+            long long value = 0;
+            while (token < lineEnd && isDigit(*token) && value <= std::numeric_limits<int>::max())
+            {
+                value = value * 10 + (*token - '0');
+                token++;
+            }
+            value = negative ? -value : value;
+            return static_cast<int>(std::clamp<long long>(
+                value,
+                std::numeric_limits<int>::min(),
+                std::numeric_limits<int>::max()));
+        }
+
+        const char* skipToSeparator(const char* token, const char* lineEnd)
+        {
+            while (token < lineEnd && *token != '/' && !isSpace(*token) && *token != '\r') token++;
+            return token;
+        }
+
+        // Converts a one based .obj index to zero based. count is the number of elements of that kind
+        // read so far in this chunk, used to resolve negative indices.
+        bool fixIndex(int idx, size_t count, uint8_t relativeBit, int32_t& out, uint8_t& relative)
+        {
+            if (idx > 0)
+            {
+                out = idx - 1;
+                return true;
+            }
+            if (idx == 0)
+            {
+                return false;
+            }
+            out = static_cast<int32_t>(static_cast<int64_t>(count) + idx);
+            relative |= relativeBit;
+            return true;
+        }
+
+        // Same grammar as tinyobj's parseTriple(): v, v/vt, v//vn or v/vt/vn.
+        bool parseCorner(const char*& token, const char* lineEnd, const Chunk& chunk, Corner& corner)
+        {
+            corner = Corner{-1, -1, -1, 0};
+
+            if (!fixIndex(parseInt(token, lineEnd), chunk.positions.size() / 3, RELATIVE_V, corner.v, corner.relative))
+            {
+                return false;
+            }
+            token = skipToSeparator(token, lineEnd);
+            if (token >= lineEnd || *token != '/')
+            {
+                return true;
+            }
+            token++;
+
+            if (token < lineEnd && *token == '/')
+            {
+                token++;
+                if (!fixIndex(parseInt(token, lineEnd), chunk.normals.size() / 3, RELATIVE_VN, corner.vn, corner.relative))
+                {
+                    return false;
+                }
+                token = skipToSeparator(token, lineEnd);
+                return true;
+            }
+
+            if (!fixIndex(parseInt(token, lineEnd), chunk.texcoords.size() / 2, RELATIVE_VT, corner.vt, corner.relative))
+            {
+                return false;
+            }
+            token = skipToSeparator(token, lineEnd);
+            if (token >= lineEnd || *token != '/')
+            {
+                return true;
+            }
+            token++;
+
+            if (!fixIndex(parseInt(token, lineEnd), chunk.normals.size() / 3, RELATIVE_VN, corner.vn, corner.relative))
+            {
+                return false;
+            }
+            token = skipToSeparator(token, lineEnd);
+            return true;
+        }
+
+        void parseChunk(Chunk& chunk)
+        {
+            const char* line = chunk.begin;
+            while (line < chunk.end && chunk.valid)
+            {
+                const char* lineEnd = static_cast<const char*>(memchr(line, '\n', chunk.end - line));
+                if (lineEnd == nullptr)
+                {
+                    lineEnd = chunk.end;
+                }
+
+                // tinyobj also ends lines on a lone '\r'; those files are left to the serial path.
+                const char* carriageReturn = static_cast<const char*>(memchr(line, '\r', lineEnd - line));
+                if (carriageReturn != nullptr && carriageReturn + 1 != lineEnd)
+                {
+                    chunk.valid = false;
+                    break;
+                }
+
+                const char* token = line;
+                while (token < lineEnd && isSpace(*token)) token++;
+                size_t length = lineEnd - token;
+
+                if (length >= 2 && token[0] == 'v' && isSpace(token[1]))
+                {
+                    token += 2;
+                    float x = parseRealOr(token, lineEnd, 0.f);
+                    float y = parseRealOr(token, lineEnd, 0.f);
+                    float z = parseRealOr(token, lineEnd, 0.f);
+                    float r = 1.f;
+                    float g = 1.f;
+                    float b = 1.f;
+                    bool foundColor =
+                        parseReal(token, lineEnd, r) &&
+                        parseReal(token, lineEnd, g) &&
+                        parseReal(token, lineEnd, b);
+                    if (!foundColor)
+                    {
+                        r = g = b = 1.f;
+                    }
+                    chunk.positions.insert(chunk.positions.end(), {x, y, z});
+                    chunk.colors.insert(chunk.colors.end(), {r, g, b});
+                }
+                else if (length >= 3 && token[0] == 'v' && token[1] == 'n' && isSpace(token[2]))
+                {
+                    token += 3;
+                    float x = parseRealOr(token, lineEnd, 0.f);
+                    float y = parseRealOr(token, lineEnd, 0.f);
+                    float z = parseRealOr(token, lineEnd, 0.f);
+                    chunk.normals.insert(chunk.normals.end(), {x, y, z});
+                }
+                else if (length >= 3 && token[0] == 'v' && token[1] == 't' && isSpace(token[2]))
+                {
+                    token += 3;
+                    float x = parseRealOr(token, lineEnd, 0.f);
+                    float y = parseRealOr(token, lineEnd, 0.f);
+                    chunk.texcoords.insert(chunk.texcoords.end(), {x, y});
+                }
+                else if (length >= 2 && token[0] == 'f' && isSpace(token[1]))
+                {
+                    token += 2;
+                    Corner face[3];
+                    int cornerCount = 0;
+                    while (token < lineEnd && *token != '\r')
+                    {
+                        while (token < lineEnd && isSpace(*token)) token++;
+                        if (token >= lineEnd || *token == '\r')
+                        {
+                            break;
+                        }
+                        // Polygons are triangulated by tinyobj; leave them to the serial path.
+                        if (cornerCount == 3 || !parseCorner(token, lineEnd, chunk, face[cornerCount]))
+                        {
+                            chunk.valid = false;
+                            break;
+                        }
+                        cornerCount++;
+                    }
+                    if (cornerCount != 3)
+                    {
+                        chunk.valid = false;
+                    }
+                    else
+                    {
+                        chunk.corners.insert(chunk.corners.end(), {face[0], face[1], face[2]});
+                    }
+                }
+                // Comments, groups, materials, smoothing groups, lines and points don't affect the mesh.
+
+                line = (lineEnd < chunk.end) ? lineEnd + 1 : chunk.end;
+            }
+        }
+
+        // Runs task(i) for i in [0, count) with one thread per item; item 0 runs on the calling thread.
+        void parallelFor(size_t count, const std::function<void(size_t)>& task)
+        {
+            std::vector<std::thread> workers{};
+            for (size_t i = 1; i < count; i++)
+            {
+                workers.emplace_back(task, i);
+            }
+            if (count > 0)
+            {
+                task(0);
+            }
+            for (auto& worker : workers)
+            {
+                worker.join();
+            }
+        }
+
+        // Turns a chunk relative index into a file wide one and range checks it.
+        bool resolve(int32_t& index, uint8_t relative, uint8_t bit, size_t base, size_t total)
+        {
+            if (relative & bit)
+            {
+                index += static_cast<int32_t>(base);
+                return index >= 0 && static_cast<size_t>(index) < total;
+            }
+            // -1 marks an element the corner doesn't have.
+            return index < 0 || static_cast<size_t>(index) < total;
+        }
+    }
+
+    bool LveObjParser::parse(
+        const char* data,
+        size_t size,
+        unsigned threadCount,
+        std::vector<LveModel::Vertex>& vertices,
+        std::vector<uint32_t>& indices)
+    {
+        vertices.clear();
+        indices.clear();
+
+        if (threadCount == 0)
+        {
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        }
+        size_t chunkCount = std::clamp<size_t>(size / MIN_CHUNK_SIZE, 1, threadCount);
+
+        // Split into line aligned chunks.
+        std::vector<Chunk> chunks(chunkCount);
+        const char* end = data + size;
+        const char* begin = data;
+        for (size_t i = 0; i < chunkCount; i++)
+        {
+            const char* chunkEnd = (i + 1 == chunkCount) ? end : data + size * (i + 1) / chunkCount;
+            if (chunkEnd < begin)
+            {
+                chunkEnd = begin;
+            }
+            const char* newline = static_cast<const char*>(memchr(chunkEnd, '\n', end - chunkEnd));
+            chunkEnd = (newline == nullptr) ? end : newline + 1;
+            chunks[i].begin = begin;
+            chunks[i].end = chunkEnd;
+            begin = chunkEnd;
+        }
+
+        parallelFor(chunkCount, [&](size_t i) { parseChunk(chunks[i]); });
+
+        size_t positionCount = 0;
+        size_t normalCount = 0;
+        size_t texcoordCount = 0;
+        size_t indexCount = 0;
+        for (Chunk& chunk : chunks)
+        {
+            if (!chunk.valid)
+            {
+                return false;
+            }
+            chunk.positionBase = positionCount;
+            chunk.normalBase = normalCount;
+            chunk.texcoordBase = texcoordCount;
+            chunk.indexBase = indexCount;
+            positionCount += chunk.positions.size() / 3;
+            normalCount += chunk.normals.size() / 3;
+            texcoordCount += chunk.texcoords.size() / 2;
+            indexCount += chunk.corners.size();
+        }
+
+        if (positionCount > static_cast<size_t>(std::numeric_limits<int32_t>::max()) ||
+            normalCount > static_cast<size_t>(std::numeric_limits<int32_t>::max()) ||
+            texcoordCount > static_cast<size_t>(std::numeric_limits<int32_t>::max()))
+        {
+            return false;
+        }
+
+        std::vector<float> positions(positionCount * 3);
+        std::vector<float> colors(positionCount * 3);
+        std::vector<float> normals(normalCount * 3);
+        std::vector<float> texcoords(texcoordCount * 2);
+
+        // Gather attributes into file wide arrays, then build and deduplicate each chunk's vertices.
+        std::atomic<bool> valid{true};
+        parallelFor(chunkCount, [&](size_t i)
+        {
+            Chunk& chunk = chunks[i];
+            std::copy(chunk.positions.begin(), chunk.positions.end(), positions.begin() + chunk.positionBase * 3);
+            std::copy(chunk.colors.begin(), chunk.colors.end(), colors.begin() + chunk.positionBase * 3);
+            std::copy(chunk.normals.begin(), chunk.normals.end(), normals.begin() + chunk.normalBase * 3);
+            std::copy(chunk.texcoords.begin(), chunk.texcoords.end(), texcoords.begin() + chunk.texcoordBase * 2);
+
+            for (Corner& corner : chunk.corners)
+            {
+                if (!resolve(corner.v, corner.relative, RELATIVE_V, chunk.positionBase, positionCount) ||
+                    !resolve(corner.vt, corner.relative, RELATIVE_VT, chunk.texcoordBase, texcoordCount) ||
+                    !resolve(corner.vn, corner.relative, RELATIVE_VN, chunk.normalBase, normalCount))
+                {
+                    valid = false;
+                    return;
+                }
+            }
+        });
+        if (!valid)
+        {
+            return false;
+        }
+
+        parallelFor(chunkCount, [&](size_t i)
+        {
+            Chunk& chunk = chunks[i];
+            LveVertexWeldTable uniqueVertices{chunk.uniqueVertices, chunk.corners.size()};
+            chunk.localIndices.reserve(chunk.corners.size());
+
+            for (const Corner& corner : chunk.corners)
+            {
+                LveModel::Vertex vertex{};
+                if (corner.v >= 0)
+                {
+                    vertex.position =
+                    {
+                        positions[3 * corner.v + 0],
+                        positions[3 * corner.v + 1],
+                        positions[3 * corner.v + 2]
+                    };
+                    vertex.color =
+                    {
+                        colors[3 * corner.v + 0],
+                        colors[3 * corner.v + 1],
+                        colors[3 * corner.v + 2]
+                    };
+                }
+                if (corner.vn >= 0)
+                {
+                    vertex.normal =
+                    {
+                        normals[3 * corner.vn + 0],
+                        normals[3 * corner.vn + 1],
+                        normals[3 * corner.vn + 2]
+                    };
+                }
+                if (corner.vt >= 0)
+                {
+                    vertex.uv =
+                    {
+                        texcoords[2 * corner.vt + 0],
+                        texcoords[2 * corner.vt + 1]
+                    };
+                }
+
+                chunk.localIndices.push_back(uniqueVertices.findOrInsert(vertex));
+            }
+        });
+
+        // Merge in chunk order. A vertex's first occurrence in the file is its first occurrence in the
+        // earliest chunk containing it, so global ids come out in the same first seen order as the serial path.
+        size_t chunkVertexCount = 0;
+        for (const Chunk& chunk : chunks)
+        {
+            chunkVertexCount += chunk.uniqueVertices.size();
+        }
+
+        LveVertexWeldTable uniqueVertices{vertices, chunkVertexCount};
+        std::vector<std::vector<uint32_t>> localToGlobal(chunkCount);
+        for (size_t i = 0; i < chunkCount; i++)
+        {
+            localToGlobal[i].reserve(chunks[i].uniqueVertices.size());
+            for (const LveModel::Vertex& vertex : chunks[i].uniqueVertices)
+            {
+                localToGlobal[i].push_back(uniqueVertices.findOrInsert(vertex));
+            }
+        }
+
+        indices.resize(indexCount);
+        parallelFor(chunkCount, [&](size_t i)
+        {
+            const Chunk& chunk = chunks[i];
+            for (size_t j = 0; j < chunk.localIndices.size(); j++)
+            {
+                indices[chunk.indexBase + j] = localToGlobal[i][chunk.localIndices[j]];
+            }
+        });
+
+        return true;
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef lve_obj_parser_hpp
+#define lve_obj_parser_hpp
+
+#pragma once
+
+#include "lve_model.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace lve
+{
+    // Multi-threaded .obj parser. The file is split into line aligned chunks which are parsed and
+    // deduplicated on worker threads; the per chunk results are then merged in file order, so the
+    // vertex and index arrays are identical to those of the serial tinyobj path.
+    //
+    // Only files whose faces are all triangles are handled. Anything that tinyobj would triangulate
+    // or reject (polygons, zero or out of range indices) makes parse() return false, and the caller
+    // falls back to the serial path.
+    class LveObjParser
+    {
+        public:
+
+        // threadCount 0 uses std::thread::hardware_concurrency().
+        // Returns false, leaving vertices and indices empty, if the file needs the serial path.
+        static bool parse(
+            const char* data,
+            size_t size,
+            unsigned threadCount,
+            std::vector<LveModel::Vertex>& vertices,
+            std::vector<uint32_t>& indices);
+    };
+}
+
+#endif /* lve_obj_parser_hpp */
@@ -88,9 +88,19 @@ namespace lve
         shaderStagesCI[1].pNext               = nullptr;
         shaderStagesCI[1].pSpecializationInfo = nullptr;
         
+        VkSpecializationInfo vertexSpecializationInfo{};
+        if(!lvePipelineCI.vertexSpecializationEntries.empty())
+        {
+            vertexSpecializationInfo.mapEntryCount = static_cast<uint32_t>(lvePipelineCI.vertexSpecializationEntries.size());
+            vertexSpecializationInfo.pMapEntries   = lvePipelineCI.vertexSpecializationEntries.data();
+            vertexSpecializationInfo.dataSize      = lvePipelineCI.vertexSpecializationData.size();
+            vertexSpecializationInfo.pData         = lvePipelineCI.vertexSpecializationData.data();
+            shaderStagesCI[0].pSpecializationInfo  = &vertexSpecializationInfo;
+        }
+        
         // Initialize VkPipelineVertexInputStateCreateInfo.
-        auto bindingDescriptions = LveModel::Vertex::getBindingDescriptions();
-        auto attributeDescriptions = LveModel::Vertex::getAttributeDescriptions();
+        const auto& bindingDescriptions = lvePipelineCI.bindingDescriptions;
+        const auto& attributeDescriptions = lvePipelineCI.attributeDescriptions;
         vertexInputStateCI.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
         vertexInputStateCI.vertexBindingDescriptionCount   = static_cast<uint32_t>(bindingDescriptions.size());
         vertexInputStateCI.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
@@ -127,7 +137,7 @@ namespace lve
         
         if(vkCreateGraphicsPipelines(
             lveDevice.device(),
-            VK_NULL_HANDLE,
+            lveDevice.pipelineCache(),
             1,
             &vkCreatePipelineCI,
             nullptr,
@@ -162,6 +172,9 @@ namespace lve
 
     void LvePipeline::defaultPipelineConfigInfo(LvePipelineConfigInfo& configInfo)
 {
+        configInfo.bindingDescriptions = LveModel::Vertex::getBindingDescriptions();
+        configInfo.attributeDescriptions = LveModel::Vertex::getAttributeDescriptions();
+        
         configInfo.inputAssemblyInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
         configInfo.inputAssemblyInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
         configInfo.inputAssemblyInfo.primitiveRestartEnable = VK_FALSE;
@@ -26,6 +26,13 @@ namespace lve
         VkPipelineDynamicStateCreateInfo    dynamicStateInfo;
         VkRenderPass                        renderPass = nullptr;
         uint32_t                            subpass = 0;
+        
+        std::vector<VkVertexInputBindingDescription>    bindingDescriptions{};
+        std::vector<VkVertexInputAttributeDescription>  attributeDescriptions{};
+        
+        // Specialization constants of the vertex shader. Ignored when vertexSpecializationEntries is empty.
+        std::vector<VkSpecializationMapEntry>   vertexSpecializationEntries{};
+        std::vector<char>                       vertexSpecializationData{};
     };
 
     class LvePipeline
@@ -0,0 +1,121 @@
+#include "lve_staging_pool.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace lve
+{
+    LveStagingPool::LveStagingPool(LveDevice& device, VkDeviceSize capacity)
+    :   _lveDevice{device},
+        _capacity{capacity}
+    {}
+
+    LveStagingPool::~LveStagingPool()
+    {
+        assert(_statistics.bufferCount == _idle.size() && "Staging buffers outlive the staging pool");
+    }
+
+    std::unique_ptr<LveBuffer> LveStagingPool::acquire(VkDeviceSize size)
+    {
+        const VkDeviceSize bufferSize = classSize(size);
+        {
+            std::lock_guard<std::mutex> lock{_mutex};
+            _statistics.acquireCount++;
+            for (size_t i = _idle.size(); i-- > 0;)
+            {
+                if (_idle[i]->getBufferSize() == bufferSize)
+                {
+                    std::unique_ptr<LveBuffer> buffer = std::move(_idle[i]);
+                    _idle.erase(_idle.begin() + i);
+                    _statistics.idleBytes -= bufferSize;
+                    _statistics.reuseCount++;
+                    return buffer;
+                }
+            }
+        }
+
+        // Created outside the lock; the memory allocator has its own.
+        std::unique_ptr<LveBuffer> buffer = std::make_unique<LveBuffer>(
+            _lveDevice,
+            bufferSize,
+            1,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            1,
+            LveMemoryCategory::Staging);
+        if (buffer->map() != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to map staging buffer!");
+        }
+
+        std::lock_guard<std::mutex> lock{_mutex};
+        _statistics.bufferCount++;
+        _statistics.stagingBytes += bufferSize;
+        _statistics.peakStagingBytes = std::max(_statistics.peakStagingBytes, _statistics.stagingBytes);
+        return buffer;
+    }
+
+    void LveStagingPool::release(std::unique_ptr<LveBuffer> buffer)
+    {
+        if (!buffer)
+        {
+            return;
+        }
+        std::lock_guard<std::mutex> lock{_mutex};
+        _statistics.idleBytes += buffer->getBufferSize();
+        _idle.push_back(std::move(buffer));
+        evict(_capacity);
+    }
+
+    void LveStagingPool::setCapacity(VkDeviceSize capacity)
+    {
+        std::lock_guard<std::mutex> lock{_mutex};
+        _capacity = capacity;
+        evict(_capacity);
+    }
+
+    void LveStagingPool::trim()
+    {
+        std::lock_guard<std::mutex> lock{_mutex};
+        evict(0);
+    }
+
+    LveStagingPool::Statistics LveStagingPool::getStatistics() const
+    {
+        std::lock_guard<std::mutex> lock{_mutex};
+        Statistics statistics = _statistics;
+        if (statistics.acquireCount > 0)
+        {
+            statistics.reuseRate =
+                static_cast<float>(statistics.reuseCount) / static_cast<float>(statistics.acquireCount);
+        }
+        return statistics;
+    }
+
+    VkDeviceSize LveStagingPool::classSize(VkDeviceSize size)
+    {
+        VkDeviceSize bufferSize = MIN_CLASS_SIZE;
+        while (bufferSize < size)
+        {
+            bufferSize *= 2;
+        }
+        return bufferSize;
+    }
+
+    // Called with _mutex held.
+    void LveStagingPool::evict(VkDeviceSize capacity)
+    {
+        size_t evicted = 0;
+        while (evicted < _idle.size() && _statistics.idleBytes > capacity)
+        {
+            VkDeviceSize bufferSize = _idle[evicted]->getBufferSize();
+            _statistics.idleBytes -= bufferSize;
+            _statistics.stagingBytes -= bufferSize;
+            _statistics.bufferCount--;
+            evicted++;
+        }
+        _idle.erase(_idle.begin(), _idle.begin() + evicted);
+    }
+}
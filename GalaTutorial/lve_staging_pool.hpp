@@ -0,0 +1,91 @@
+#ifndef lve_staging_pool_hpp
+#define lve_staging_pool_hpp
+
+#pragma once
+
+#include "lve_buffer.hpp"
+#include "lve_device.hpp"
+
+// std
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace lve
+{
+    // Recycles persistently mapped, host coherent TRANSFER_SRC buffers for uploads, so streaming does
+    // not create, allocate and map a staging buffer per upload.
+    //
+    // Buffers come in power of two size classes of at least MIN_CLASS_SIZE bytes. acquire() returns
+    // the most recently released idle buffer of the class, or creates one. Buffers must only be
+    // released once the copies reading them have completed, i.e. after their submission completed. Idle
+    // buffers beyond the capacity are destroyed, least recently released first.
+    //
+    // Thread safe.
+    class LveStagingPool
+    {
+        public:
+
+        static constexpr VkDeviceSize MIN_CLASS_SIZE = 64 * 1024;
+        static constexpr VkDeviceSize DEFAULT_CAPACITY = 64 * 1024 * 1024;
+
+        struct Statistics
+        {
+            uint64_t     acquireCount = 0;
+            uint64_t     reuseCount = 0;
+
+            // Staging buffers that exist, idle or in use, and the most there ever were.
+            uint32_t     bufferCount = 0;
+            VkDeviceSize stagingBytes = 0;
+            VkDeviceSize peakStagingBytes = 0;
+
+            // Bytes of idle buffers kept for reuse.
+            VkDeviceSize idleBytes = 0;
+
+            // Share of acquire() calls served by an idle buffer.
+            float        reuseRate = 0.f;
+        };
+
+        explicit LveStagingPool(LveDevice& device, VkDeviceSize capacity = DEFAULT_CAPACITY);
+
+        // Every acquired buffer must have been released.
+        ~LveStagingPool();
+
+        LveStagingPool(const LveStagingPool&) = delete;
+        LveStagingPool& operator=(const LveStagingPool&) = delete;
+
+        // A mapped buffer of at least size bytes.
+        std::unique_ptr<LveBuffer> acquire(VkDeviceSize size);
+
+        // Returns a buffer from acquire() whose copies have completed.
+        void release(std::unique_ptr<LveBuffer> buffer);
+
+        // Most bytes of idle buffers kept; lowering it destroys idle buffers right away.
+        void setCapacity(VkDeviceSize capacity);
+
+        // Destroys every idle buffer.
+        void trim();
+
+        Statistics getStatistics() const;
+
+        private:
+
+        static VkDeviceSize classSize(VkDeviceSize size);
+
+        // Destroys the least recently released idle buffers until at most capacity bytes are idle.
+        void evict(VkDeviceSize capacity);
+
+        LveDevice&                              _lveDevice;
+        VkDeviceSize                            _capacity;
+
+        mutable std::mutex                      _mutex;
+
+        // Least recently released first.
+        std::vector<std::unique_ptr<LveBuffer>> _idle{};
+
+        Statistics                              _statistics{};
+    };
+}
+
+#endif /* lve_staging_pool_hpp */
@@ -43,6 +43,7 @@ void LveSwapChain::init()
 LveSwapChain::~LveSwapChain() {
     for (auto imageView : swapChainImageViews)
     {
+        device.notifyDestroyed(LveDevice::handleValue(imageView));
         vkDestroyImageView(device.device(), imageView, nullptr);
     }
         swapChainImageViews.clear();
@@ -55,9 +56,10 @@ LveSwapChain::~LveSwapChain() {
 
     for (int i = 0; i < depthImages.size(); i++)
     {
+        device.notifyDestroyed(LveDevice::handleValue(depthImageViews[i]));
         vkDestroyImageView(device.device(), depthImageViews[i], nullptr);
         vkDestroyImage(device.device(), depthImages[i], nullptr);
-        vkFreeMemory(device.device(), depthImageMemorys[i], nullptr);
+        device.memoryAllocator().free(depthImageAllocations[i]);
     }
 
     for (auto framebuffer : swapChainFramebuffers)
@@ -72,7 +74,6 @@ LveSwapChain::~LveSwapChain() {
     {
         vkDestroySemaphore(device.device(), renderFinishedSemaphores[i], nullptr);
         vkDestroySemaphore(device.device(), imageAvailableSemaphores[i], nullptr);
-        vkDestroyFence(device.device(), inFlightFences[i], nullptr);
     }
 }
     
@@ -123,12 +124,8 @@ float LveSwapChain::extentAspectRatio()
     
 VkResult LveSwapChain::acquireNextImage(uint32_t *imageIndex)
 {
-    vkWaitForFences(
-        device.device(),
-        1,
-        &inFlightFences[currentFrame],
-        VK_TRUE,
-        std::numeric_limits<uint64_t>::max());
+    // Waits for exactly this frame's previous submission, not for uploads submitted since.
+    device.wait(inFlightSubmissions[currentFrame]);
 
     VkResult result = vkAcquireNextImageKHR(
         device.device(),
@@ -145,11 +142,7 @@ VkResult LveSwapChain::submitCommandBuffers(
     const VkCommandBuffer *buffers,
     uint32_t *imageIndex)
 {
-    if (imagesInFlight[*imageIndex] != VK_NULL_HANDLE)
-    {
-        vkWaitForFences(device.device(), 1, &imagesInFlight[*imageIndex], VK_TRUE, UINT64_MAX);
-    }
-    imagesInFlight[*imageIndex] = inFlightFences[currentFrame];
+    device.wait(imagesInFlight[*imageIndex]);
 
     VkSubmitInfo submitInfo = {};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
@@ -167,12 +160,9 @@ VkResult LveSwapChain::submitCommandBuffers(
     submitInfo.signalSemaphoreCount = 1;
     submitInfo.pSignalSemaphores = signalSemaphores;
 
-    vkResetFences(device.device(), 1, &inFlightFences[currentFrame]);
-    if (vkQueueSubmit(device.graphicsQueue(), 1, &submitInfo, inFlightFences[currentFrame]) !=
-        VK_SUCCESS)
-    {
-        throw std::runtime_error("failed to submit draw command buffer!");
-    }
+    LveSubmission submission = device.submit(submitInfo);
+    inFlightSubmissions[currentFrame] = submission;
+    imagesInFlight[*imageIndex] = submission;
 //
     VkPresentInfoKHR presentInfo = {};
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -385,7 +375,7 @@ void LveSwapChain::createDepthResources()
     swapChainDepthFormat = depthFormat;
     VkExtent2D swapChainExtent = getSwapChainExtent();
     depthImages.resize(imageCount());
-    depthImageMemorys.resize(imageCount());
+    depthImageAllocations.resize(imageCount());
     depthImageViews.resize(imageCount());
 
     for (int i = 0; i < depthImages.size(); i++)
@@ -410,7 +400,8 @@ void LveSwapChain::createDepthResources()
             imageInfo,
             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
             depthImages[i],
-            depthImageMemorys[i]);
+            depthImageAllocations[i],
+            LveMemoryCategory::DepthImages);
 
         VkImageViewCreateInfo viewInfo{};
         viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -434,16 +425,12 @@ void LveSwapChain::createSyncObjects()
 {
     imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
     renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-    inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
-    imagesInFlight.resize(imageCount(), VK_NULL_HANDLE);
+    inFlightSubmissions.resize(MAX_FRAMES_IN_FLIGHT);
+    imagesInFlight.resize(imageCount());
 
     VkSemaphoreCreateInfo semaphoreInfo = {};
     semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-    VkFenceCreateInfo fenceInfo = {};
-    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
     for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
     {
         if (vkCreateSemaphore(
@@ -455,13 +442,7 @@ void LveSwapChain::createSyncObjects()
                               &semaphoreInfo,
                               nullptr,
                               &renderFinishedSemaphores[i]
-                              ) != VK_SUCCESS ||
-            vkCreateFence(
-                          device.device(),
-                          &fenceInfo,
-                          nullptr,
-                          &inFlightFences[i]
-                         ) != VK_SUCCESS
+                              ) != VK_SUCCESS
         )
         {
             throw std::runtime_error("failed to create synchronization objects for a frame!");
@@ -85,7 +85,7 @@ namespace lve {
         VkRenderPass renderPass;
 
         std::vector<VkImage> depthImages;
-        std::vector<VkDeviceMemory> depthImageMemorys;
+        std::vector<LveAllocation> depthImageAllocations;
         std::vector<VkImageView> depthImageViews;
         std::vector<VkImage> swapChainImages;
         std::vector<VkImageView> swapChainImageViews;
@@ -98,8 +98,10 @@ namespace lve {
 
         std::vector<VkSemaphore> imageAvailableSemaphores;
         std::vector<VkSemaphore> renderFinishedSemaphores;
-        std::vector<VkFence> inFlightFences;
-        std::vector<VkFence> imagesInFlight;
+        
+        // The last submission of each frame in flight and of each swap chain image.
+        std::vector<LveSubmission> inFlightSubmissions;
+        std::vector<LveSubmission> imagesInFlight;
         size_t currentFrame = 0;
     };
 
@@ -0,0 +1,307 @@
+#include "lve_upload_batch.hpp"
+#include "lve_staging_pool.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+
+namespace lve
+{
+    namespace
+    {
+        // Keeps every upload aligned for any vertex or index format.
+        const VkDeviceSize REGION_ALIGNMENT = 16;
+
+        // Where uploaded buffers are read.
+        const VkAccessFlags DST_ACCESS =
+            VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT |
+            VK_ACCESS_INDEX_READ_BIT |
+            VK_ACCESS_UNIFORM_READ_BIT |
+            VK_ACCESS_SHADER_READ_BIT;
+        const VkPipelineStageFlags DST_STAGES =
+            VK_PIPELINE_STAGE_VERTEX_INPUT_BIT |
+            VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+
+        VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+        {
+            return (value + alignment - 1) & ~(alignment - 1);
+        }
+    }
+
+    LveUploadBatch::LveUploadBatch(LveDevice& device, bool useTransferQueue)
+    :   _lveDevice{device},
+        _useTransferQueue{useTransferQueue && device.hasDedicatedTransferQueue()}
+    {}
+
+    LveUploadBatch::~LveUploadBatch()
+    {
+        if (_submitted)
+        {
+            wait();
+        }
+        release();
+    }
+
+    void* LveUploadBatch::reserve(VkBuffer dstBuffer, VkDeviceSize dstOffset, VkDeviceSize size)
+    {
+        assert(!_submitted && "Cannot queue uploads after submit");
+        assert(size > 0 && "Upload size must be greater than zero");
+
+        Block* block = nullptr;
+        if (!_blocks.empty() && alignUp(_blocks.back().used, REGION_ALIGNMENT) + size <= _blocks.back().buffer->getBufferSize())
+        {
+            block = &_blocks.back();
+        }
+        else
+        {
+            _blocks.push_back({_lveDevice.stagingPool().acquire(std::max(size, STAGING_BLOCK_SIZE)), 0});
+            block = &_blocks.back();
+        }
+
+        VkDeviceSize offset = alignUp(block->used, REGION_ALIGNMENT);
+        block->used = offset + size;
+        _stagingSize += size;
+
+        Region region{};
+        region.block = static_cast<uint32_t>(_blocks.size() - 1);
+        region.dstBuffer = dstBuffer;
+        region.copy.srcOffset = offset;
+        region.copy.dstOffset = dstOffset;
+        region.copy.size = size;
+        _regions.push_back(region);
+
+        return static_cast<char*>(block->buffer->getMappedMemory()) + offset;
+    }
+
+    void LveUploadBatch::copy(const void* data, VkDeviceSize size, VkBuffer dstBuffer, VkDeviceSize dstOffset)
+    {
+        memcpy(reserve(dstBuffer, dstOffset, size), data, static_cast<size_t>(size));
+    }
+
+    void LveUploadBatch::submit()
+    {
+        assert(!_submitted && "Upload batch was already submitted");
+        _submitted = true;
+        if (_regions.empty())
+        {
+            _complete = true;
+            release();
+            return;
+        }
+
+        if (!_useTransferQueue)
+        {
+            VkCommandBuffer commandBuffer = _lveDevice.beginSingleTimeCommands();
+            recordCopies(commandBuffer);
+
+            // Later submissions on this queue read the uploaded buffers without further synchronization.
+            VkMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = DST_ACCESS;
+            vkCmdPipelineBarrier(
+                commandBuffer,
+                VK_PIPELINE_STAGE_TRANSFER_BIT,
+                DST_STAGES,
+                0,
+                1,
+                &barrier,
+                0,
+                nullptr,
+                0,
+                nullptr);
+            _submission = _lveDevice.submitSingleTimeCommands(commandBuffer);
+            return;
+        }
+
+        VkSemaphoreCreateInfo semaphoreInfo{};
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        if (vkCreateSemaphore(_lveDevice.device(), &semaphoreInfo, nullptr, &_transferSemaphore) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create upload semaphore!");
+        }
+
+        _transferCommandBuffer = beginTransferCommandBuffer();
+        recordCopies(_transferCommandBuffer);
+        recordOwnershipTransfer(_transferCommandBuffer, true);
+        vkEndCommandBuffer(_transferCommandBuffer);
+
+        VkSubmitInfo transferSubmit{};
+        transferSubmit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        transferSubmit.commandBufferCount = 1;
+        transferSubmit.pCommandBuffers = &_transferCommandBuffer;
+        transferSubmit.signalSemaphoreCount = 1;
+        transferSubmit.pSignalSemaphores = &_transferSemaphore;
+        if (vkQueueSubmit(_lveDevice.transferQueue(), 1, &transferSubmit, VK_NULL_HANDLE) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to submit upload batch to the transfer queue!");
+        }
+
+        VkCommandBuffer commandBuffer = _lveDevice.beginSingleTimeCommands();
+        recordOwnershipTransfer(commandBuffer, false);
+        _submission = _lveDevice.submitSingleTimeCommands(commandBuffer, _transferSemaphore, DST_STAGES);
+    }
+
+    VkCommandBuffer LveUploadBatch::beginTransferCommandBuffer()
+    {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandPool = _lveDevice.getTransferCommandPool();
+        allocInfo.commandBufferCount = 1;
+
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        if (vkAllocateCommandBuffers(_lveDevice.device(), &allocInfo, &commandBuffer) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to allocate upload command buffer!");
+        }
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkBeginCommandBuffer(commandBuffer, &beginInfo);
+        return commandBuffer;
+    }
+
+    // One vkCmdCopyBuffer per staging block and destination buffer.
+    void LveUploadBatch::recordCopies(VkCommandBuffer commandBuffer)
+    {
+        std::stable_sort(_regions.begin(), _regions.end(), [](const Region& a, const Region& b)
+        {
+            if (a.block != b.block)
+            {
+                return a.block < b.block;
+            }
+            return std::less<VkBuffer>{}(a.dstBuffer, b.dstBuffer);
+        });
+        std::vector<VkBufferCopy> copies{};
+        for (size_t first = 0; first < _regions.size();)
+        {
+            size_t last = first;
+            copies.clear();
+            while (last < _regions.size() &&
+                   _regions[last].block == _regions[first].block &&
+                   _regions[last].dstBuffer == _regions[first].dstBuffer)
+            {
+                copies.push_back(_regions[last].copy);
+                last++;
+            }
+            vkCmdCopyBuffer(
+                commandBuffer,
+                _blocks[_regions[first].block].buffer->getBuffer(),
+                _regions[first].dstBuffer,
+                static_cast<uint32_t>(copies.size()),
+                copies.data());
+            first = last;
+        }
+    }
+
+    // The release on the transfer queue makes the copies available; the matching acquire on the
+    // graphics queue makes them visible to vertex input and shaders.
+    void LveUploadBatch::recordOwnershipTransfer(VkCommandBuffer commandBuffer, bool isRelease)
+    {
+        std::vector<VkBuffer> buffers{};
+        for (const Region& region : _regions)
+        {
+            buffers.push_back(region.dstBuffer);
+        }
+        std::sort(buffers.begin(), buffers.end(), std::less<VkBuffer>{});
+        buffers.erase(std::unique(buffers.begin(), buffers.end()), buffers.end());
+
+        std::vector<VkBufferMemoryBarrier> barriers{};
+        for (VkBuffer buffer : buffers)
+        {
+            VkBufferMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            barrier.srcAccessMask = isRelease ? VK_ACCESS_TRANSFER_WRITE_BIT : 0;
+            barrier.dstAccessMask = isRelease ? 0 : DST_ACCESS;
+            barrier.srcQueueFamilyIndex = _lveDevice.transferQueueFamily();
+            barrier.dstQueueFamilyIndex = _lveDevice.graphicsQueueFamily();
+            barrier.buffer = buffer;
+            barrier.offset = 0;
+            barrier.size = VK_WHOLE_SIZE;
+            barriers.push_back(barrier);
+        }
+
+        vkCmdPipelineBarrier(
+            commandBuffer,
+            isRelease ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+            isRelease ? VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT : DST_STAGES,
+            0,
+            0,
+            nullptr,
+            static_cast<uint32_t>(barriers.size()),
+            barriers.data(),
+            0,
+            nullptr);
+    }
+
+    bool LveUploadBatch::isSubmitted() const
+    {
+        return _submitted;
+    }
+
+    bool LveUploadBatch::isComplete()
+    {
+        if (!_complete && _submitted && _lveDevice.isComplete(_submission))
+        {
+            _complete = true;
+            release();
+        }
+        return _complete;
+    }
+
+    void LveUploadBatch::wait()
+    {
+        if (!_submitted)
+        {
+            submit();
+        }
+        if (!_complete)
+        {
+            _lveDevice.wait(_submission);
+            _complete = true;
+            release();
+        }
+    }
+
+    LveSubmission LveUploadBatch::getSubmission() const
+    {
+        return _submission;
+    }
+
+    VkDeviceSize LveUploadBatch::getStagingSize() const
+    {
+        return _stagingSize;
+    }
+
+    uint32_t LveUploadBatch::getCopyCount() const
+    {
+        return static_cast<uint32_t>(_regions.size());
+    }
+
+    // Only called before submit or once the submission has completed.
+    void LveUploadBatch::release()
+    {
+        for (Block& block : _blocks)
+        {
+            _lveDevice.stagingPool().release(std::move(block.buffer));
+        }
+        _blocks.clear();
+        if (_transferCommandBuffer != VK_NULL_HANDLE)
+        {
+            vkFreeCommandBuffers(_lveDevice.device(), _lveDevice.getTransferCommandPool(), 1, &_transferCommandBuffer);
+            _transferCommandBuffer = VK_NULL_HANDLE;
+        }
+        if (_transferSemaphore != VK_NULL_HANDLE)
+        {
+            vkDestroySemaphore(_lveDevice.device(), _transferSemaphore, nullptr);
+            _transferSemaphore = VK_NULL_HANDLE;
+        }
+    }
+}
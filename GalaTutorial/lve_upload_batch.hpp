@@ -0,0 +1,108 @@
+#ifndef lve_upload_batch_hpp
+#define lve_upload_batch_hpp
+
+#pragma once
+
+#include "lve_buffer.hpp"
+#include "lve_device.hpp"
+
+// std
+#include <memory>
+#include <vector>
+
+namespace lve
+{
+    // Collects buffer uploads and performs them with one submission. Data is written into mapped
+    // staging blocks as it is queued; submit() records every copy into one command buffer, followed by
+    // a barrier that makes the copies visible to vertex input and shaders of later submissions, and
+    // submits it with LveDevice::submitSingleTimeCommands(). Nothing blocks until wait() is called or
+    // the batch is destroyed.
+    //
+    // Staging blocks are STAGING_BLOCK_SIZE bytes unless one upload needs more, so a typical scene
+    // uses a single staging buffer. They come from the device's LveStagingPool and go back to it as
+    // soon as the submission is seen complete.
+    //
+    // With useTransferQueue, and a device with a dedicated transfer queue, the copies run there and
+    // end with releasing the destination buffers to the graphics queue family. A second, small
+    // submission on the graphics queue waits for them on a semaphore and acquires the buffers.
+    // Otherwise everything runs on the graphics queue.
+    //
+    // reserve() and copy() may be called from any one thread at a time. submit(), isComplete(),
+    // wait() and destruction use the device's command pools, so they belong on the render thread.
+    class LveUploadBatch
+    {
+        public:
+
+        static constexpr VkDeviceSize STAGING_BLOCK_SIZE = 8 * 1024 * 1024;
+
+        explicit LveUploadBatch(LveDevice& device, bool useTransferQueue = false);
+
+        // Waits for a submitted upload to finish.
+        ~LveUploadBatch();
+
+        LveUploadBatch(const LveUploadBatch&) = delete;
+        LveUploadBatch& operator=(const LveUploadBatch&) = delete;
+
+        // Returns size bytes of staging memory to fill before submit(); their content is copied to
+        // dstBuffer at dstOffset.
+        void* reserve(VkBuffer dstBuffer, VkDeviceSize dstOffset, VkDeviceSize size);
+
+        // reserve() and copy data into the reserved memory.
+        void copy(const void* data, VkDeviceSize size, VkBuffer dstBuffer, VkDeviceSize dstOffset = 0);
+
+        // Records and submits all queued copies. Nothing may be queued afterwards.
+        void submit();
+
+        bool isSubmitted() const;
+
+        // Non blocking completion check.
+        bool isComplete();
+
+        // Submits if needed and blocks until the copies are done.
+        void wait();
+
+        // The graphics queue submission that completes the upload; valid once submitted.
+        LveSubmission getSubmission() const;
+
+        VkDeviceSize getStagingSize() const;
+        uint32_t getCopyCount() const;
+
+        private:
+
+        struct Block
+        {
+            std::unique_ptr<LveBuffer> buffer;
+            VkDeviceSize used;
+        };
+
+        struct Region
+        {
+            uint32_t block;
+            VkBuffer dstBuffer;
+            VkBufferCopy copy;
+        };
+
+        void recordCopies(VkCommandBuffer commandBuffer);
+
+        // Ownership transfer (release or acquire) of every destination buffer to the graphics family.
+        void recordOwnershipTransfer(VkCommandBuffer commandBuffer, bool isRelease);
+
+        VkCommandBuffer beginTransferCommandBuffer();
+
+        void release();
+
+        LveDevice&           _lveDevice;
+        std::vector<Block>   _blocks{};
+        std::vector<Region>  _regions{};
+        VkDeviceSize         _stagingSize = 0;
+
+        bool                 _useTransferQueue;
+        VkCommandBuffer      _transferCommandBuffer = VK_NULL_HANDLE;
+        VkSemaphore          _transferSemaphore = VK_NULL_HANDLE;
+        LveSubmission        _submission{};
+        bool                 _submitted = false;
+        bool                 _complete = false;
+    };
+}
+
+#endif /* lve_upload_batch_hpp */
@@ -0,0 +1,220 @@
+#include "lve_vertex_format.hpp"
+
+#include <glm/gtc/packing.hpp>
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace lve
+{
+    namespace
+    {
+        static_assert(sizeof(LveVertexFormat::CompactVertex) == 20, "CompactVertex must be tightly packed");
+
+        float signNotZero(float value)
+        {
+            return value >= 0.f ? 1.f : -1.f;
+        }
+
+        // Octahedral encoding quantized to snorm16. Of the four snorm values around the exact encoding,
+        // the one whose decoded normal is closest to the input is kept.
+        void encodeNormal(const glm::vec3& normal, int16_t (&out)[2])
+        {
+            glm::vec2 exact = LveVertexFormat::octahedralEncode(normal);
+            float length = glm::length(normal);
+            if (length == 0.f)
+            {
+                out[0] = 0;
+                out[1] = 0;
+                return;
+            }
+            glm::vec3 unit = normal / length;
+
+            const float scale = 32767.f;
+            float bestError = std::numeric_limits<float>::max();
+            for (int i = 0; i < 4; i++)
+            {
+                float x = (i & 1) ? std::ceil(exact.x * scale) : std::floor(exact.x * scale);
+                float y = (i & 2) ? std::ceil(exact.y * scale) : std::floor(exact.y * scale);
+                x = glm::clamp(x, -scale, scale);
+                y = glm::clamp(y, -scale, scale);
+
+                glm::vec3 decoded = LveVertexFormat::octahedralDecode(glm::vec2{x / scale, y / scale});
+                float error = 1.f - glm::dot(decoded, unit);
+                if (error < bestError)
+                {
+                    bestError = error;
+                    out[0] = static_cast<int16_t>(x);
+                    out[1] = static_cast<int16_t>(y);
+                }
+            }
+        }
+    }
+
+    uint32_t LveVertexFormat::stride(LveModel::VertexLayout layout)
+    {
+        return layout == LveModel::VertexLayout::Full ? sizeof(LveModel::Vertex) : sizeof(CompactVertex);
+    }
+
+    std::vector<VkVertexInputBindingDescription> LveVertexFormat::getBindingDescriptions(LveModel::VertexLayout layout)
+    {
+        std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
+        bindingDescriptions[0].binding = 0;
+        bindingDescriptions[0].stride = stride(layout);
+        bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+        return bindingDescriptions;
+    }
+
+    std::vector<VkVertexInputAttributeDescription> LveVertexFormat::getAttributeDescriptions(LveModel::VertexLayout layout)
+    {
+        if (layout == LveModel::VertexLayout::Full)
+        {
+            return LveModel::Vertex::getAttributeDescriptions();
+        }
+
+        // 16 bit three component formats are rarely supported for vertex input, so position uses four.
+        VkFormat positionFormat = layout == LveModel::VertexLayout::CompactHalfPosition
+            ? VK_FORMAT_R16G16B16A16_SFLOAT
+            : VK_FORMAT_R16G16B16A16_UNORM;
+
+        std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
+        attributeDescriptions.push_back(
+            {0, 0, positionFormat, offsetof(CompactVertex, position)});
+        attributeDescriptions.push_back(
+            {1, 0, VK_FORMAT_R8G8B8A8_UNORM, offsetof(CompactVertex, color)});
+        attributeDescriptions.push_back(
+            {2, 0, VK_FORMAT_R16G16_SNORM, offsetof(CompactVertex, normal)});
+        attributeDescriptions.push_back(
+            {3, 0, VK_FORMAT_R16G16_SFLOAT, offsetof(CompactVertex, uv)});
+        return attributeDescriptions;
+    }
+
+    glm::mat4 LveVertexFormat::encode(
+        LveModel::VertexLayout layout,
+        const LveModel::Vertex* vertices,
+        uint32_t vertexCount,
+        std::vector<char>& out)
+    {
+        out.resize(static_cast<size_t>(stride(layout)) * vertexCount);
+        glm::mat4 positionDecode{1.f};
+
+        if (layout == LveModel::VertexLayout::Full)
+        {
+            if (vertexCount > 0)
+            {
+                memcpy(out.data(), vertices, out.size());
+            }
+            return positionDecode;
+        }
+
+        glm::vec3 offset{0.f};
+        glm::vec3 extent{1.f};
+        if (layout == LveModel::VertexLayout::CompactNormalizedPosition && vertexCount > 0)
+        {
+            glm::vec3 minimum = vertices[0].position;
+            glm::vec3 maximum = vertices[0].position;
+            for (uint32_t i = 1; i < vertexCount; i++)
+            {
+                minimum = glm::min(minimum, vertices[i].position);
+                maximum = glm::max(maximum, vertices[i].position);
+            }
+            offset = minimum;
+            extent = maximum - minimum;
+            for (int axis = 0; axis < 3; axis++)
+            {
+                if (extent[axis] <= 0.f)
+                {
+                    extent[axis] = 1.f;
+                }
+            }
+
+            positionDecode[0][0] = extent.x;
+            positionDecode[1][1] = extent.y;
+            positionDecode[2][2] = extent.z;
+            positionDecode[3] = glm::vec4{offset, 1.f};
+        }
+
+        CompactVertex* compact = reinterpret_cast<CompactVertex*>(out.data());
+        for (uint32_t i = 0; i < vertexCount; i++)
+        {
+            const LveModel::Vertex& vertex = vertices[i];
+            CompactVertex& encoded = compact[i];
+
+            for (int axis = 0; axis < 3; axis++)
+            {
+                encoded.position[axis] = layout == LveModel::VertexLayout::CompactHalfPosition
+                    ? glm::packHalf1x16(vertex.position[axis])
+                    : glm::packUnorm1x16((vertex.position[axis] - offset[axis]) / extent[axis]);
+            }
+            encoded.position[3] = 0;
+
+            encodeNormal(vertex.normal, encoded.normal);
+            encoded.color = glm::packUnorm4x8(glm::vec4{vertex.color, 1.f});
+            encoded.uv[0] = glm::packHalf1x16(vertex.uv.x);
+            encoded.uv[1] = glm::packHalf1x16(vertex.uv.y);
+        }
+        return positionDecode;
+    }
+
+    LveModel::Vertex LveVertexFormat::decode(
+        LveModel::VertexLayout layout,
+        const char* encoded,
+        const glm::mat4& positionDecode)
+    {
+        LveModel::Vertex vertex{};
+        if (layout == LveModel::VertexLayout::Full)
+        {
+            memcpy(&vertex, encoded, sizeof(LveModel::Vertex));
+            return vertex;
+        }
+
+        CompactVertex compact{};
+        memcpy(&compact, encoded, sizeof(CompactVertex));
+
+        glm::vec3 position{};
+        for (int axis = 0; axis < 3; axis++)
+        {
+            position[axis] = layout == LveModel::VertexLayout::CompactHalfPosition
+                ? glm::unpackHalf1x16(compact.position[axis])
+                : glm::unpackUnorm1x16(compact.position[axis]);
+        }
+        vertex.position = glm::vec3{positionDecode * glm::vec4{position, 1.f}};
+        vertex.normal = octahedralDecode(glm::vec2{
+            glm::unpackSnorm1x16(static_cast<uint16_t>(compact.normal[0])),
+            glm::unpackSnorm1x16(static_cast<uint16_t>(compact.normal[1]))});
+        vertex.color = glm::vec3{glm::unpackUnorm4x8(compact.color)};
+        vertex.uv = glm::vec2{glm::unpackHalf1x16(compact.uv[0]), glm::unpackHalf1x16(compact.uv[1])};
+        return vertex;
+    }
+
+    glm::vec2 LveVertexFormat::octahedralEncode(const glm::vec3& normal)
+    {
+        float sum = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+        if (sum == 0.f)
+        {
+            return glm::vec2{0.f};
+        }
+
+        glm::vec2 encoded{normal.x / sum, normal.y / sum};
+        if (normal.z < 0.f)
+        {
+            encoded = glm::vec2{
+                (1.f - std::abs(encoded.y)) * signNotZero(encoded.x),
+                (1.f - std::abs(encoded.x)) * signNotZero(encoded.y)};
+        }
+        return encoded;
+    }
+
+    // Same as octahedralDecode() in the vertex shaders.
+    glm::vec3 LveVertexFormat::octahedralDecode(const glm::vec2& encoded)
+    {
+        glm::vec3 normal{encoded.x, encoded.y, 1.f - std::abs(encoded.x) - std::abs(encoded.y)};
+        float t = std::max(-normal.z, 0.f);
+        normal.x += normal.x >= 0.f ? -t : t;
+        normal.y += normal.y >= 0.f ? -t : t;
+        return glm::normalize(normal);
+    }
+}
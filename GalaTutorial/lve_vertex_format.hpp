@@ -0,0 +1,64 @@
+#ifndef lve_vertex_format_hpp
+#define lve_vertex_format_hpp
+
+#pragma once
+
+#include "lve_model.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace lve
+{
+    // GPU side encodings of LveModel::Vertex, selected per model with LveModel::VertexLayout.
+    //
+    // Full is Vertex itself, 44 bytes. The compact layouts are 20 bytes:
+    //   position  4 x 16 bit, either half float or unorm relative to the model's bounds (w unused)
+    //   normal    2 x 16 bit snorm, octahedral encoding
+    //   color     4 x 8 bit unorm (a unused)
+    //   uv        2 x 16 bit half float
+    // The shaders decode the normal when the OCTAHEDRAL_NORMALS specialization constant is set.
+    // Unorm positions are decoded by the matrix returned from encode(), which the caller folds into
+    // the model matrix.
+    class LveVertexFormat
+    {
+        public:
+
+        struct CompactVertex
+        {
+            uint16_t position[4];
+            int16_t  normal[2];
+            uint32_t color;
+            uint16_t uv[2];
+        };
+
+        // Specialization constant ids shared by the shaders that read model vertices.
+        static constexpr uint32_t OCTAHEDRAL_NORMALS_CONSTANT_ID = 0;
+
+        static uint32_t stride(LveModel::VertexLayout layout);
+
+        static std::vector<VkVertexInputBindingDescription> getBindingDescriptions(LveModel::VertexLayout layout);
+        static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions(LveModel::VertexLayout layout);
+
+        // Encodes vertices for layout into out (resized to stride(layout) * vertexCount bytes).
+        // Returns the matrix that maps the stored position to the model space position.
+        static glm::mat4 encode(
+            LveModel::VertexLayout layout,
+            const LveModel::Vertex* vertices,
+            uint32_t vertexCount,
+            std::vector<char>& out);
+
+        // Decodes one encoded vertex; used to measure the encoding error.
+        static LveModel::Vertex decode(
+            LveModel::VertexLayout layout,
+            const char* encoded,
+            const glm::mat4& positionDecode);
+
+        // Unit vector to [-1, 1]^2 and back. A zero vector encodes to (0, 0).
+        static glm::vec2 octahedralEncode(const glm::vec3& normal);
+        static glm::vec3 octahedralDecode(const glm::vec2& encoded);
+    };
+}
+
+#endif /* lve_vertex_format_hpp */
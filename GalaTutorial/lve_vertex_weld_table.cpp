@@ -0,0 +1,282 @@
+#include "lve_vertex_weld_table.hpp"
+
+// std
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace lve
+{
+    namespace
+    {
+        static_assert(
+            sizeof(LveModel::Vertex) == 11 * sizeof(float),
+            "LveVertexWeldTable hashes Vertex as tightly packed floats");
+
+        constexpr size_t VERTEX_WORDS = sizeof(LveModel::Vertex) / sizeof(uint32_t);
+
+        // Word offset of Vertex::color; the epsilon hash replaces the position words with a grid cell.
+        constexpr size_t COLOR_WORD = offsetof(LveModel::Vertex, color) / sizeof(uint32_t);
+
+        void loadWords(const LveModel::Vertex& vertex, uint32_t (&words)[VERTEX_WORDS])
+        {
+            memcpy(words, &vertex, sizeof(LveModel::Vertex));
+            for (uint32_t& word : words)
+            {
+                // -0.f == 0.f, so both must hash the same.
+                if (word == 0x80000000u)
+                {
+                    word = 0;
+                }
+            }
+        }
+
+        uint64_t rotateLeft(uint64_t value, int bits)
+        {
+            return (value << bits) | (value >> (64 - bits));
+        }
+
+        // FxHash over 64 bit words, then the murmur3 finalizer so that both the low bits (slot) and
+        // the high bits (stored tag) depend on every input bit.
+        uint64_t hashWords(const uint32_t* words, size_t count)
+        {
+            const uint64_t seed = 0x517cc1b727220a95ull;
+            uint64_t hash = 0;
+            size_t i = 0;
+            for (; i + 1 < count; i += 2)
+            {
+                uint64_t word = static_cast<uint64_t>(words[i]) | (static_cast<uint64_t>(words[i + 1]) << 32);
+                hash = (rotateLeft(hash, 5) ^ word) * seed;
+            }
+            if (i < count)
+            {
+                hash = (rotateLeft(hash, 5) ^ words[i]) * seed;
+            }
+
+            hash ^= hash >> 33;
+            hash *= 0xff51afd7ed558ccdull;
+            hash ^= hash >> 33;
+            hash *= 0xc4ceb9fe1a85ec53ull;
+            hash ^= hash >> 33;
+            return hash;
+        }
+
+        int32_t cellCoordinate(float value, double cellSize)
+        {
+            double cell = std::floor(value / cellSize);
+            if (std::isnan(cell))
+            {
+                return 0;
+            }
+            if (cell < std::numeric_limits<int32_t>::min())
+            {
+                return std::numeric_limits<int32_t>::min();
+            }
+            if (cell > std::numeric_limits<int32_t>::max())
+            {
+                return std::numeric_limits<int32_t>::max();
+            }
+            return static_cast<int32_t>(cell);
+        }
+    }
+
+    LveVertexWeldTable::LveVertexWeldTable(
+        std::vector<LveModel::Vertex>& vertices,
+        size_t expectedVertexCount,
+        float positionEpsilon)
+    :   _vertices{vertices},
+        _epsilon{positionEpsilon}
+    {
+        // Keep the load factor at or below one half.
+        size_t capacity = 16;
+        while (capacity < expectedVertexCount * 2)
+        {
+            capacity *= 2;
+        }
+        _slots.assign(capacity, Slot{0, EMPTY});
+        _mask = capacity - 1;
+    }
+
+    uint64_t LveVertexWeldTable::hashVertex(const LveModel::Vertex& vertex)
+    {
+        uint32_t words[VERTEX_WORDS];
+        loadWords(vertex, words);
+        return hashWords(words, VERTEX_WORDS);
+    }
+
+    uint32_t LveVertexWeldTable::findOrInsert(const LveModel::Vertex& vertex)
+    {
+        if (_epsilon > 0.f)
+        {
+            return findOrInsertNear(vertex);
+        }
+
+        uint64_t hash = hashVertex(vertex);
+        uint32_t tag = static_cast<uint32_t>(hash >> 32);
+        for (size_t slot = hash & _mask; ; slot = (slot + 1) & _mask)
+        {
+            const Slot& entry = _slots[slot];
+            if (entry.index == EMPTY)
+            {
+                return insert(slot, hash, vertex);
+            }
+            if (entry.hash == tag && _vertices[entry.index] == vertex)
+            {
+                return entry.index;
+            }
+        }
+    }
+
+    // Vertices are keyed by the grid cell of their position, with cells 2 * epsilon wide. Per axis, a
+    // vertex within epsilon of this one is in the same cell or in the neighbour on the side of the
+    // cell this one is closer to, so 8 cells are searched. The home cell is searched first and the
+    // neighbours in a fixed order, so the result only depends on the order of insertion.
+    uint32_t LveVertexWeldTable::findOrInsertNear(const LveModel::Vertex& vertex)
+    {
+        const Cell home = cellOf(vertex.position);
+        const uint64_t homeHash = hashNear(home, vertex);
+        size_t insertSlot = 0;
+
+        const double cellSize = 2.0 * _epsilon;
+        const int32_t sideX = vertex.position.x / cellSize - home.x < 0.5 ? -1 : 1;
+        const int32_t sideY = vertex.position.y / cellSize - home.y < 0.5 ? -1 : 1;
+        const int32_t sideZ = vertex.position.z / cellSize - home.z < 0.5 ? -1 : 1;
+
+        for (int n = 0; n < 8; n++)
+        {
+            Cell cell{
+                home.x + ((n & 1) ? sideX : 0),
+                home.y + ((n & 2) ? sideY : 0),
+                home.z + ((n & 4) ? sideZ : 0)};
+
+            uint64_t hash = (n == 0) ? homeHash : hashNear(cell, vertex);
+            uint32_t tag = static_cast<uint32_t>(hash >> 32);
+
+            for (size_t slot = hash & _mask; ; slot = (slot + 1) & _mask)
+            {
+                const Slot& entry = _slots[slot];
+                if (entry.index == EMPTY)
+                {
+                    if (n == 0)
+                    {
+                        insertSlot = slot;
+                    }
+                    break;
+                }
+                if (entry.hash != tag)
+                {
+                    continue;
+                }
+
+                const LveModel::Vertex& candidate = _vertices[entry.index];
+                Cell candidateCell = cellOf(candidate.position);
+                glm::vec3 delta = glm::abs(candidate.position - vertex.position);
+                if (candidateCell.x == cell.x &&
+                    candidateCell.y == cell.y &&
+                    candidateCell.z == cell.z &&
+                    candidate.color == vertex.color &&
+                    candidate.normal == vertex.normal &&
+                    candidate.uv == vertex.uv &&
+                    delta.x <= _epsilon &&
+                    delta.y <= _epsilon &&
+                    delta.z <= _epsilon)
+                {
+                    return entry.index;
+                }
+            }
+        }
+
+        return insert(insertSlot, homeHash, vertex);
+    }
+
+    LveVertexWeldTable::Cell LveVertexWeldTable::cellOf(const glm::vec3& position) const
+    {
+        return Cell{
+            cellCoordinate(position.x, 2.0 * _epsilon),
+            cellCoordinate(position.y, 2.0 * _epsilon),
+            cellCoordinate(position.z, 2.0 * _epsilon)};
+    }
+
+    uint64_t LveVertexWeldTable::hashNear(const Cell& cell, const LveModel::Vertex& vertex) const
+    {
+        uint32_t words[VERTEX_WORDS];
+        loadWords(vertex, words);
+        words[0] = static_cast<uint32_t>(cell.x);
+        words[1] = static_cast<uint32_t>(cell.y);
+        words[2] = static_cast<uint32_t>(cell.z);
+        static_assert(COLOR_WORD == 3, "position must be the first three words of Vertex");
+        return hashWords(words, VERTEX_WORDS);
+    }
+
+    uint64_t LveVertexWeldTable::slotHash(const LveModel::Vertex& vertex) const
+    {
+        return _epsilon > 0.f ? hashNear(cellOf(vertex.position), vertex) : hashVertex(vertex);
+    }
+
+    uint32_t LveVertexWeldTable::insert(size_t slot, uint64_t hash, const LveModel::Vertex& vertex)
+    {
+        uint32_t index = static_cast<uint32_t>(_vertices.size());
+        _vertices.push_back(vertex);
+        _slots[slot] = Slot{static_cast<uint32_t>(hash >> 32), index};
+
+        if (++_count * 2 > _slots.size())
+        {
+            grow();
+        }
+        return index;
+    }
+
+    void LveVertexWeldTable::grow()
+    {
+        std::vector<Slot> oldSlots = std::move(_slots);
+        _slots.assign(oldSlots.size() * 2, Slot{0, EMPTY});
+        _mask = _slots.size() - 1;
+
+        for (const Slot& entry : oldSlots)
+        {
+            if (entry.index == EMPTY)
+            {
+                continue;
+            }
+            size_t slot = slotHash(_vertices[entry.index]) & _mask;
+            while (_slots[slot].index != EMPTY)
+            {
+                slot = (slot + 1) & _mask;
+            }
+            _slots[slot] = entry;
+        }
+    }
+
+    void LveVertexWeldTable::weld(
+        std::vector<LveModel::Vertex>& vertices,
+        std::vector<uint32_t>& indices,
+        float positionEpsilon)
+    {
+        std::vector<LveModel::Vertex> welded{};
+        LveVertexWeldTable table{welded, vertices.size(), positionEpsilon};
+
+        std::vector<uint32_t> remap(vertices.size());
+        for (size_t i = 0; i < vertices.size(); i++)
+        {
+            remap[i] = table.findOrInsert(vertices[i]);
+        }
+
+        // Drop triangles that collapsed onto a line or a point.
+        size_t kept = 0;
+        for (size_t i = 0; i + 2 < indices.size(); i += 3)
+        {
+            uint32_t a = remap[indices[i + 0]];
+            uint32_t b = remap[indices[i + 1]];
+            uint32_t c = remap[indices[i + 2]];
+            if (a == b || b == c || a == c)
+            {
+                continue;
+            }
+            indices[kept++] = a;
+            indices[kept++] = b;
+            indices[kept++] = c;
+        }
+        indices.resize(kept);
+        vertices.swap(welded);
+    }
+}
@@ -0,0 +1,80 @@
+#ifndef lve_vertex_weld_table_hpp
+#define lve_vertex_weld_table_hpp
+
+#pragma once
+
+#include "lve_model.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace lve
+{
+    // Flat, open addressing (linear probing) table used to deduplicate vertices while loading a model.
+    // Slots hold an index into the caller's vertex array plus 32 bits of the hash, so a probe only
+    // touches the vertex itself when the hash fragment matches.
+    //
+    // With positionEpsilon 0, vertices are merged when they compare equal (same as Vertex::operator==).
+    // With positionEpsilon > 0, vertices are also merged when color, normal and uv are equal and every
+    // position component is within positionEpsilon of an earlier vertex's.
+    class LveVertexWeldTable
+    {
+        public:
+
+        // Unique vertices are appended to vertices, which must outlive the table.
+        LveVertexWeldTable(
+            std::vector<LveModel::Vertex>& vertices,
+            size_t expectedVertexCount,
+            float positionEpsilon = 0.f);
+
+        LveVertexWeldTable(const LveVertexWeldTable& o) = delete;
+        LveVertexWeldTable& operator=(const LveVertexWeldTable& o) = delete;
+
+        // One lookup per call: returns the index of the matching vertex, appending vertex to the
+        // vertex array if there is none.
+        uint32_t findOrInsert(const LveModel::Vertex& vertex);
+
+        // Merges vertices whose positions are within positionEpsilon (see above), keeping the first
+        // vertex of each group, and rewrites indices to match.
+        static void weld(
+            std::vector<LveModel::Vertex>& vertices,
+            std::vector<uint32_t>& indices,
+            float positionEpsilon);
+
+        // Hash of the vertex's bytes, with -0.f treated as 0.f so that equal vertices hash equally.
+        static uint64_t hashVertex(const LveModel::Vertex& vertex);
+
+        private:
+
+        struct Slot
+        {
+            uint32_t hash;
+            uint32_t index;
+        };
+
+        static constexpr uint32_t EMPTY = UINT32_MAX;
+
+        struct Cell
+        {
+            int32_t x;
+            int32_t y;
+            int32_t z;
+        };
+
+        uint32_t findOrInsertNear(const LveModel::Vertex& vertex);
+        Cell cellOf(const glm::vec3& position) const;
+        uint64_t hashNear(const Cell& cell, const LveModel::Vertex& vertex) const;
+        uint64_t slotHash(const LveModel::Vertex& vertex) const;
+        uint32_t insert(size_t slot, uint64_t hash, const LveModel::Vertex& vertex);
+        void grow();
+
+        std::vector<LveModel::Vertex>&  _vertices;
+        std::vector<Slot>               _slots;
+        size_t                          _mask;
+        size_t                          _count = 0;
+        float                           _epsilon;
+    };
+}
+
+#endif /* lve_vertex_weld_table_hpp */
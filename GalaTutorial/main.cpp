@@ -1,9 +1,26 @@
 #include "first_app.hpp"
+#include "lve_benchmarks.hpp"
 #include <iostream>
 #include <cstdlib>
 #include <stdexcept>
+#include <string>
+#include <vector>
 
-int main() {
+int main(int argc, char *argv[]) {
+    
+    // e.g. GalaTutorial mesh-cache /path/to/models
+    if (argc > 1)
+    {
+        try
+        {
+            lve::runBenchmark(std::vector<std::string>(argv + 1, argv + argc));
+        } catch (const std::exception &e)
+        {
+            std::cerr << e.what() << '\n';
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
     
     lve::FirstApp app{};
     
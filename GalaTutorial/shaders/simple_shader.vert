@@ -8,6 +8,9 @@ layout(location = 3) in vec2 uv;
 
 layout(location = 0) out vec3 fragColor;
 
+// Set for the compact vertex layouts, whose normal attribute holds an octahedral encoding in xy.
+layout(constant_id = 0) const bool OCTAHEDRAL_NORMALS = false;
+
 layout(set=0, binding=0) uniform GlobalUbo
 {
     mat4 projectionViewMatrix;
@@ -22,6 +25,15 @@ layout(push_constant) uniform Push{
     
 } push;
 
+vec3 octahedralDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
 void main()
 {
     vec4 positionWorld = push.modelMatrix * vec4(position, 1.0);
@@ -33,7 +45,8 @@ void main()
     //mat3 normalMatrix = transpose(inverse(mat3(push.modelMatrix)));
     //vec3 normalWorldSpace = normalize(normalMatrix * normal);
     
-    vec3 normalWorldSpace = normalize(mat3(push.normalMatrix) * normal);
+    vec3 objectNormal = OCTAHEDRAL_NORMALS ? octahedralDecode(normal.xy) : normal;
+    vec3 normalWorldSpace = normalize(mat3(push.normalMatrix) * objectNormal);
     
     vec3 directionToLight = ubo.lightPosition - positionWorld.xyz;
     float attenuation = 1.0 / dot(directionToLight, directionToLight);
@@ -0,0 +1,20 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout (location = 0) in vec3 fragColor;
+layout (location = 1) in vec2 fragUv;
+layout (location = 2) flat in uint fragTextureIndex;
+layout (location = 0) out vec4 outColor;
+
+// Every texture of the scene; only the elements objects refer to are bound.
+layout(set=1, binding=1) uniform sampler2D textures[];
+
+void main()
+{
+    vec3 color = fragColor;
+    if (fragTextureIndex != 0xFFFFFFFFu)
+    {
+        color *= texture(textures[nonuniformEXT(fragTextureIndex)], fragUv).rgb;
+    }
+    outColor = vec4(color, 1.0);
+}
@@ -0,0 +1,58 @@
+#version 450
+
+// position is an attribure. It takes its value from a vertex buffer.
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 color;
+layout(location = 2) in vec3 normal;
+layout(location = 3) in vec2 uv;
+
+layout(location = 0) out vec3 fragColor;
+
+// Set for the compact vertex layouts, whose normal attribute holds an octahedral encoding in xy.
+layout(constant_id = 0) const bool OCTAHEDRAL_NORMALS = false;
+
+layout(set=0, binding=0) uniform GlobalUbo
+{
+    mat4 projectionViewMatrix;
+    vec4 ambientLightColor;
+    vec3 lightPosition;
+    vec4 lightColor;
+} ubo;
+ 
+// One slot of a per-frame buffer per object, selected by the dynamic offset the set is bound with.
+layout(set=1, binding=0) uniform ObjectUbo
+{
+    mat4 modelMatrix;
+    mat4 normalMatrix;
+    
+    // rgb replaces the vertex color by a weight of a.
+    vec4 color;
+} object;
+
+vec3 octahedralDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+void main()
+{
+    vec4 positionWorld = object.modelMatrix * vec4(position, 1.0);
+    
+    gl_Position = ubo.projectionViewMatrix * positionWorld;
+    
+    vec3 objectNormal = OCTAHEDRAL_NORMALS ? octahedralDecode(normal.xy) : normal;
+    vec3 normalWorldSpace = normalize(mat3(object.normalMatrix) * objectNormal);
+    
+    vec3 directionToLight = ubo.lightPosition - positionWorld.xyz;
+    float attenuation = 1.0 / dot(directionToLight, directionToLight);
+    
+    vec3 lightColor = ubo.lightColor.xyz * ubo.lightColor.w * attenuation;
+    vec3 ambientLight = ubo.ambientLightColor.xyz * ubo.ambientLightColor.w;
+    vec3 diffuseLight = lightColor * max(dot(normalWorldSpace, normalize(directionToLight)),0);
+    
+    fragColor = (diffuseLight + ambientLight) * mix(color, object.color.rgb, object.color.a);
+}
@@ -1,36 +1,71 @@
 #include "simple_render_system.hpp"
+#include "lve_vertex_format.hpp"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 
+#include <algorithm>
 #include <array>
 #include <cassert>
+#include <cmath>
+#include <cstring>
 #include <stdexcept>
 #include <glm/gtc/constants.hpp>
 //
 namespace lve
 {
-    struct SimplePushConstantData
-    {
-        glm::mat4 modelMatrix{1.f};
-        glm::mat4 normalMatrix{1.f};
-    };
+    // Allowed LOD error in normalized device units of half the screen height: about one pixel at 1080p.
+    static constexpr float LOD_ERROR_THRESHOLD = 1.f / 540.f;
     
     SimpleRenderSystem::SimpleRenderSystem(
         LveDevice& device,
         VkRenderPass renderPass,
-        VkDescriptorSetLayout globalSetLayout)
-    :   _lveDevice{device}
+        VkDescriptorSetLayout globalSetLayout,
+        LveBindlessDescriptors* bindlessDescriptors)
+    :   _lveDevice{device},
+        _bindlessDescriptors{bindlessDescriptors}
     {
+        _objectDataIndices.fill(LveBindlessDescriptors::INVALID_INDEX);
+        createObjectDescriptors();
         createPipelineLayout(globalSetLayout);
         createPipeline(renderPass);
     }
 
     SimpleRenderSystem::~SimpleRenderSystem()
     {
+        if (_bindlessDescriptors)
+        {
+            for (uint32_t index : _objectDataIndices)
+            {
+                _bindlessDescriptors->releaseStorageBuffer(index);
+            }
+            vkDestroyPipelineLayout(_lveDevice.device(), _bindlessPipelineLayout, nullptr);
+        }
+        _pushObjectTemplate.reset();
+        if (_pushObjectPipelineLayout != VK_NULL_HANDLE)
+        {
+            vkDestroyPipelineLayout(_lveDevice.device(), _pushObjectPipelineLayout, nullptr);
+        }
+        vkDestroyPipelineLayout(_lveDevice.device(), _objectPipelineLayout, nullptr);
         vkDestroyPipelineLayout(_lveDevice.device(), _vkPipelineLayout, nullptr);
     }
+    
+    void SimpleRenderSystem::createObjectDescriptors()
+    {
+        _objectSetLayout = LveDescriptorSetLayout::Builder(_lveDevice)
+            .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT)
+            .build();
+        
+        // Push descriptor layouts cannot have dynamic bindings; the descriptor points at the slot.
+        if (_lveDevice.supportsPushDescriptors())
+        {
+            _pushObjectSetLayout = LveDescriptorSetLayout::Builder(_lveDevice)
+                .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
+                .setLayoutFlags(VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR)
+                .build();
+        }
+    }
 
     void SimpleRenderSystem::createPipelineLayout(
         VkDescriptorSetLayout globalSetLayout)
@@ -60,59 +95,517 @@ namespace lve
         {
             throw std::runtime_error("failed to create pipeline layout!");
         }
+        
+        // Set 0 is laid out the same in both, so the global set stays bound when switching paths.
+        std::vector<VkDescriptorSetLayout> objectSetLayouts{
+            globalSetLayout,
+            _objectSetLayout->getVkDescriptorSetLayout()};
+        
+        VkPipelineLayoutCreateInfo objectPipelineLayoutCI{};
+        objectPipelineLayoutCI.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        objectPipelineLayoutCI.setLayoutCount = static_cast<uint32_t>(objectSetLayouts.size());
+        objectPipelineLayoutCI.pSetLayouts = objectSetLayouts.data();
+        objectPipelineLayoutCI.pushConstantRangeCount = 0;
+        objectPipelineLayoutCI.pPushConstantRanges = nullptr;
+        if ( vkCreatePipelineLayout(_lveDevice.device(), &objectPipelineLayoutCI, nullptr, &_objectPipelineLayout) != VK_SUCCESS )
+        {
+            throw std::runtime_error("failed to create pipeline layout!");
+        }
+        
+        if (_pushObjectSetLayout)
+        {
+            std::vector<VkDescriptorSetLayout> pushObjectSetLayouts{
+                globalSetLayout,
+                _pushObjectSetLayout->getVkDescriptorSetLayout()};
+            
+            VkPipelineLayoutCreateInfo pushObjectPipelineLayoutCI{};
+            pushObjectPipelineLayoutCI.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+            pushObjectPipelineLayoutCI.setLayoutCount = static_cast<uint32_t>(pushObjectSetLayouts.size());
+            pushObjectPipelineLayoutCI.pSetLayouts = pushObjectSetLayouts.data();
+            if ( vkCreatePipelineLayout(_lveDevice.device(), &pushObjectPipelineLayoutCI, nullptr, &_pushObjectPipelineLayout) != VK_SUCCESS )
+            {
+                throw std::runtime_error("failed to create pipeline layout!");
+            }
+            _pushObjectTemplate = _pushObjectSetLayout->createUpdateTemplate(_pushObjectPipelineLayout, 1);
+        }
+        
+        if (_bindlessDescriptors == nullptr)
+        {
+            return;
+        }
+        
+        VkPushConstantRange bindlessPushConstantRange{};
+        bindlessPushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+        bindlessPushConstantRange.offset = 0;
+        bindlessPushConstantRange.size = sizeof(SimpleBindlessPushConstantData);
+        
+        std::vector<VkDescriptorSetLayout> bindlessSetLayouts{
+            globalSetLayout,
+            _bindlessDescriptors->getSetLayout()};
+        
+        VkPipelineLayoutCreateInfo bindlessPipelineLayoutCI{};
+        bindlessPipelineLayoutCI.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        bindlessPipelineLayoutCI.setLayoutCount = static_cast<uint32_t>(bindlessSetLayouts.size());
+        bindlessPipelineLayoutCI.pSetLayouts = bindlessSetLayouts.data();
+        bindlessPipelineLayoutCI.pushConstantRangeCount = 1;
+        bindlessPipelineLayoutCI.pPushConstantRanges = &bindlessPushConstantRange;
+        if ( vkCreatePipelineLayout(_lveDevice.device(), &bindlessPipelineLayoutCI, nullptr, &_bindlessPipelineLayout) != VK_SUCCESS )
+        {
+            throw std::runtime_error("failed to create pipeline layout!");
+        }
     }
 
     void SimpleRenderSystem::createPipeline(VkRenderPass renderPass)
     {
         assert(_vkPipelineLayout != nullptr && "Cannot create pipeline before pipeline layout.");
         
-        LvePipelineConfigInfo lvePipelineCI {};
-        LvePipeline::defaultPipelineConfigInfo(lvePipelineCI);
+        for (uint32_t layoutIndex = 0; layoutIndex < LveModel::VERTEX_LAYOUT_COUNT; layoutIndex++)
+        {
+            LveModel::VertexLayout layout = static_cast<LveModel::VertexLayout>(layoutIndex);
+            
+            LvePipelineConfigInfo lvePipelineCI {};
+            LvePipeline::defaultPipelineConfigInfo(lvePipelineCI);
+            
+            lvePipelineCI.renderPass = renderPass;
+            
+            lvePipelineCI.bindingDescriptions = LveVertexFormat::getBindingDescriptions(layout);
+            lvePipelineCI.attributeDescriptions = LveVertexFormat::getAttributeDescriptions(layout);
+            
+            // The compact layouts store octahedral normals, decoded in the vertex shader.
+            VkBool32 octahedralNormals = layout == LveModel::VertexLayout::Full ? VK_FALSE : VK_TRUE;
+            lvePipelineCI.vertexSpecializationEntries.push_back(
+                {LveVertexFormat::OCTAHEDRAL_NORMALS_CONSTANT_ID, 0, sizeof(VkBool32)});
+            lvePipelineCI.vertexSpecializationData.resize(sizeof(VkBool32));
+            memcpy(lvePipelineCI.vertexSpecializationData.data(), &octahedralNormals, sizeof(VkBool32));
+            
+            lvePipelineCI.pipelineLayout = _vkPipelineLayout;
+            _lvePipelines[layoutIndex] = std::make_unique<LvePipeline>(
+                _lveDevice,
+                "/Users/flo/LocalDocuments/Projects/VulkanLearning/GalaTutorial/GalaTutorial/shaders/simple_shader.vert.spv",
+                "/Users/flo/LocalDocuments/Projects/VulkanLearning/GalaTutorial/GalaTutorial/shaders/simple_shader.frag.spv",
+                lvePipelineCI
+            );
+            
+            lvePipelineCI.pipelineLayout = _objectPipelineLayout;
+            _objectPipelines[layoutIndex] = std::make_unique<LvePipeline>(
+                _lveDevice,
+                "/Users/flo/LocalDocuments/Projects/VulkanLearning/GalaTutorial/GalaTutorial/shaders/simple_shader_object_ubo.vert.spv",
+                "/Users/flo/LocalDocuments/Projects/VulkanLearning/GalaTutorial/GalaTutorial/shaders/simple_shader.frag.spv",
+                lvePipelineCI
+            );
+            
+            if (_pushObjectPipelineLayout != VK_NULL_HANDLE)
+            {
+                lvePipelineCI.pipelineLayout = _pushObjectPipelineLayout;
+                _pushObjectPipelines[layoutIndex] = std::make_unique<LvePipeline>(
+                    _lveDevice,
+                    "/Users/flo/LocalDocuments/Projects/VulkanLearning/GalaTutorial/GalaTutorial/shaders/simple_shader_object_ubo.vert.spv",
+                    "/Users/flo/LocalDocuments/Projects/VulkanLearning/GalaTutorial/GalaTutorial/shaders/simple_shader.frag.spv",
+                    lvePipelineCI
+                );
+            }
+            
+            if (_bindlessDescriptors)
+            {
+                lvePipelineCI.pipelineLayout = _bindlessPipelineLayout;
+                _bindlessPipelines[layoutIndex] = std::make_unique<LvePipeline>(
+                    _lveDevice,
+                    "/Users/flo/LocalDocuments/Projects/VulkanLearning/GalaTutorial/GalaTutorial/shaders/simple_shader_bindless.vert.spv",
+                    "/Users/flo/LocalDocuments/Projects/VulkanLearning/GalaTutorial/GalaTutorial/shaders/simple_shader_bindless.frag.spv",
+                    lvePipelineCI
+                );
+            }
+        }
+    }
+    
+    void SimpleRenderSystem::reserveObjectSlots(int frameIndex, uint32_t objectCount)
+    {
+        std::unique_ptr<LveBuffer>& buffer = _objectBuffers[frameIndex];
+        if (buffer && buffer->getInstanceCount() >= objectCount)
+        {
+            return;
+        }
         
-        lvePipelineCI.renderPass = renderPass;
+        uint32_t capacity = buffer ? buffer->getInstanceCount() : MIN_OBJECT_CAPACITY;
+        while (capacity < objectCount)
+        {
+            capacity *= 2;
+        }
         
-        lvePipelineCI.pipelineLayout = _vkPipelineLayout;
+        buffer = std::make_unique<LveBuffer>(
+            _lveDevice,
+            sizeof(SimpleObjectUbo),
+            capacity,
+            VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+            _lveDevice.hostWrittenMemoryProperties(),
+            _lveDevice.properties.limits.minUniformBufferOffsetAlignment,
+            LveMemoryCategory::Uniforms);
+        if (buffer->map() != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to map object buffer!");
+        }
+    }
+    
+    void SimpleRenderSystem::reserveObjectData(int frameIndex, uint32_t objectCount)
+    {
+        std::unique_ptr<LveBuffer>& buffer = _objectDataBuffers[frameIndex];
+        if (buffer && buffer->getInstanceCount() >= objectCount)
+        {
+            return;
+        }
         
-        _lvePipeline = std::make_unique<LvePipeline>(
+        uint32_t capacity = buffer ? buffer->getInstanceCount() : MIN_OBJECT_CAPACITY;
+        while (capacity < objectCount)
+        {
+            capacity *= 2;
+        }
+        
+        buffer = std::make_unique<LveBuffer>(
             _lveDevice,
-            "/Users/flo/LocalDocuments/Projects/VulkanLearning/GalaTutorial/GalaTutorial/shaders/simple_shader.vert.spv",
-            "/Users/flo/LocalDocuments/Projects/VulkanLearning/GalaTutorial/GalaTutorial/shaders/simple_shader.frag.spv",
-            lvePipelineCI
-        );
+            sizeof(SimpleObjectData),
+            capacity,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            _lveDevice.hostWrittenMemoryProperties(),
+            1,
+            LveMemoryCategory::Uniforms);
+        if (buffer->map() != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to map object buffer!");
+        }
+        
+        // Only this frame's finished submission read the element, so it is rewritten in place.
+        VkDescriptorBufferInfo bufferInfo = buffer->descriptorInfo();
+        uint32_t& index = _objectDataIndices[frameIndex];
+        if (index == LveBindlessDescriptors::INVALID_INDEX)
+        {
+            index = _bindlessDescriptors->addStorageBuffer(bufferInfo);
+        }
+        else
+        {
+            _bindlessDescriptors->updateStorageBuffer(index, bufferInfo);
+        }
     }
 
     void SimpleRenderSystem::renderGameObjects(
             FrameInfo& frameInfo,
             std::vector<LveGameObject>& gameObjects)
     {
-        _lvePipeline->bind(frameInfo.commandBuffer);
+        const bool dynamicUniform = _objectDataPath == ObjectDataPath::DynamicUniform;
+        const bool bindless = _objectDataPath == ObjectDataPath::Bindless;
+        const bool pushDescriptors = _objectDataPath == ObjectDataPath::PushDescriptors;
+        VkPipelineLayout pipelineLayout = _vkPipelineLayout;
+        auto* pipelines = &_lvePipelines;
+        if (dynamicUniform)
+        {
+            pipelineLayout = _objectPipelineLayout;
+            pipelines = &_objectPipelines;
+        }
+        else if (bindless)
+        {
+            pipelineLayout = _bindlessPipelineLayout;
+            pipelines = &_bindlessPipelines;
+        }
+        else if (pushDescriptors)
+        {
+            pipelineLayout = _pushObjectPipelineLayout;
+            pipelines = &_pushObjectPipelines;
+        }
         
+        LveBuffer* objectBuffer = nullptr;
+        VkDescriptorSet objectSet = VK_NULL_HANDLE;
+        uint32_t objectSlot = 0;
+        if (dynamicUniform)
+        {
+            reserveObjectSlots(frameInfo.frameIndex, static_cast<uint32_t>(gameObjects.size()));
+            objectBuffer = _objectBuffers[frameInfo.frameIndex].get();
+            
+            // The descriptor covers slot 0; the dynamic offset moves it to the object's slot. The set
+            // only changes when the object buffer is replaced, so it comes from the cache.
+            VkDescriptorBufferInfo bufferInfo = objectBuffer->descriptorInfoForIndex(0);
+            LveDescriptorWriter writer{*_objectSetLayout, frameInfo.descriptorCache};
+            writer.writeBuffer(0, &bufferInfo);
+            if (!writer.build(objectSet))
+            {
+                throw std::runtime_error("failed to allocate object descriptor set!");
+            }
+        }
+        else if (bindless)
+        {
+            reserveObjectData(frameInfo.frameIndex, static_cast<uint32_t>(gameObjects.size()));
+            objectBuffer = _objectDataBuffers[frameInfo.frameIndex].get();
+        }
+        else if (pushDescriptors)
+        {
+            reserveObjectSlots(frameInfo.frameIndex, static_cast<uint32_t>(gameObjects.size()));
+            objectBuffer = _objectBuffers[frameInfo.frameIndex].get();
+        }
+        
+        // The bindless set holds every object's data, so the scene needs no other bind.
+        std::array<VkDescriptorSet, 2> sets{
+            frameInfo.globalDescriptorSet,
+            bindless ? _bindlessDescriptors->getSet() : VK_NULL_HANDLE};
         vkCmdBindDescriptorSets(
             frameInfo.commandBuffer,
             VK_PIPELINE_BIND_POINT_GRAPHICS,
-            _vkPipelineLayout,
+            pipelineLayout,
             0,
+            bindless ? 2 : 1,
+            sets.data(),
             1,
-            &frameInfo.globalDescriptorSet,
-            0,
-            nullptr);
+            &frameInfo.globalUboOffset);
+        
+        // Pipelines are only switched when the vertex layout changes.
+        LvePipeline* boundPipeline = nullptr;
+        
+        _lodStatistics = LodStatistics{};
+        _cullingStatistics = CullingStatistics{};
+        
+        const glm::mat4 projectionView = frameInfo.camera.getProjection() * frameInfo.camera.getView();
         
         for (LveGameObject& obj: gameObjects)
         {
-            SimplePushConstantData push{};
-            push.modelMatrix = obj._transformComp.mat4();
-            push.normalMatrix = obj._transformComp.normalMatrix();
-            
-            vkCmdPushConstants(
-                frameInfo.commandBuffer,
-                _vkPipelineLayout,
-                VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-                0,
-                sizeof(SimplePushConstantData),
-                &push);
+            // Models still being streamed in are not drawn yet.
+            if (obj._model == nullptr)
+            {
+                continue;
+            }
+            
+            // Bounds are in model space, so the frustum is moved into model space instead.
+            const glm::mat4 modelMatrix = obj._transformComp.mat4();
+            const LveMeshlets::Frustum frustum = LveMeshlets::Frustum::fromMatrix(projectionView * modelMatrix);
+            
+            uint32_t lod = selectLod(frameInfo.camera, obj);
+            uint32_t triangles = obj._model->getTriangleCount(lod);
+            _cullingStatistics.triangles += triangles;
+            
+            const glm::vec4& sphere = obj._model->getBoundingSphere();
+            if (!frustum.intersectsSphere(glm::vec3{sphere}, sphere.w))
+            {
+                _cullingStatistics.frustumCulledTriangles += triangles;
+                continue;
+            }
+            
+            LvePipeline* pipeline = (*pipelines)[static_cast<uint32_t>(obj._model->getVertexLayout())].get();
+            if (pipeline != boundPipeline)
+            {
+                pipeline->bind(frameInfo.commandBuffer);
+                boundPipeline = pipeline;
+            }
+            
+            if (dynamicUniform || pushDescriptors)
+            {
+                // Objects without a color keep their vertex colors.
+                SimpleObjectUbo objectUbo{};
+                objectUbo.modelMatrix = modelMatrix * obj._model->getPositionDecode();
+                objectUbo.normalMatrix = obj._transformComp.normalMatrix();
+                objectUbo.color = glm::vec4{obj._color, obj._color == glm::vec3{0.f} ? 0.f : 1.f};
+                objectBuffer->writeToIndex(&objectUbo, static_cast<int>(objectSlot));
+                
+                if (pushDescriptors)
+                {
+                    // The template's data is the one buffer info of binding 0.
+                    VkDescriptorBufferInfo bufferInfo = objectBuffer->descriptorInfoForIndex(static_cast<int>(objectSlot));
+                    _pushObjectTemplate->push(frameInfo.commandBuffer, &bufferInfo);
+                }
+                else
+                {
+                    uint32_t dynamicOffset = static_cast<uint32_t>(objectSlot * objectBuffer->getAlignmentSize());
+                    vkCmdBindDescriptorSets(
+                        frameInfo.commandBuffer,
+                        VK_PIPELINE_BIND_POINT_GRAPHICS,
+                        _objectPipelineLayout,
+                        1,
+                        1,
+                        &objectSet,
+                        1,
+                        &dynamicOffset);
+                }
+                objectSlot++;
+            }
+            else if (bindless)
+            {
+                SimpleObjectData objectData{};
+                objectData.modelMatrix = modelMatrix * obj._model->getPositionDecode();
+                objectData.normalMatrix = obj._transformComp.normalMatrix();
+                objectData.color = glm::vec4{obj._color, obj._color == glm::vec3{0.f} ? 0.f : 1.f};
+                objectData.textureIndex = obj._textureIndex;
+                objectBuffer->writeToIndex(&objectData, static_cast<int>(objectSlot));
+                
+                SimpleBindlessPushConstantData push{};
+                push.objectBufferIndex = _objectDataIndices[frameInfo.frameIndex];
+                push.objectIndex = objectSlot;
+                vkCmdPushConstants(
+                    frameInfo.commandBuffer,
+                    _bindlessPipelineLayout,
+                    VK_SHADER_STAGE_VERTEX_BIT,
+                    0,
+                    sizeof(SimpleBindlessPushConstantData),
+                    &push);
+                objectSlot++;
+            }
+            else
+            {
+                SimplePushConstantData push{};
+                push.modelMatrix = modelMatrix * obj._model->getPositionDecode();
+                push.normalMatrix = obj._transformComp.normalMatrix();
+                
+                vkCmdPushConstants(
+                    frameInfo.commandBuffer,
+                    _vkPipelineLayout,
+                    VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+                    0,
+                    sizeof(SimplePushConstantData),
+                    &push);
+            }
+            _lodStatistics.objects[lod]++;
+            _lodStatistics.triangles[lod] += triangles;
+            
             obj._model->bind(frameInfo.commandBuffer);
-            obj._model->draw(frameInfo.commandBuffer);
+            if (_meshletCulling && obj._model->getMeshletCount(lod) > 0)
+            {
+                drawMeshlets(frameInfo, obj, lod, modelMatrix, frustum);
+            }
+            else
+            {
+                obj._model->draw(frameInfo.commandBuffer, lod);
+                _cullingStatistics.drawCalls++;
+            }
+        }
+        
+        // The slots written this frame, as writeToIndex() recorded them.
+        if (objectSlot > 0)
+        {
+            objectBuffer->flushDirty();
+        }
+    }
+    
+    void SimpleRenderSystem::drawMeshlets(
+        FrameInfo& frameInfo,
+        LveGameObject& obj,
+        uint32_t lod,
+        const glm::mat4& modelMatrix,
+        const LveMeshlets::Frustum& frustum)
+    {
+        const LveModel& model = *obj._model;
+        const LveModel::Meshlet* meshlets = model.getMeshlets(lod);
+        const uint32_t meshletCount = model.getMeshletCount(lod);
+        
+        // Cone tests need a camera position; orthographic projections only cull against the frustum.
+        const bool perspective = frameInfo.camera.getProjection()[2][3] != 0.f;
+        const glm::vec3 cameraPosition =
+            glm::vec3{glm::inverse(modelMatrix) * glm::vec4{frameInfo.camera.getPosition(), 1.f}};
+        
+        uint32_t runFirstIndex = 0;
+        uint32_t runIndexCount = 0;
+        for (uint32_t m = 0; m < meshletCount; m++)
+        {
+            const LveModel::Meshlet& meshlet = meshlets[m];
+            bool visible = true;
+            if (!frustum.intersectsSphere(meshlet.center, meshlet.radius))
+            {
+                _cullingStatistics.frustumCulledTriangles += meshlet.indexCount / 3;
+                visible = false;
+            }
+            else if (perspective && LveMeshlets::isBackFacing(meshlet, cameraPosition))
+            {
+                _cullingStatistics.backFacingTriangles += meshlet.indexCount / 3;
+                visible = false;
+            }
+            
+            if (visible && runIndexCount > 0 && runFirstIndex + runIndexCount == meshlet.firstIndex)
+            {
+                runIndexCount += meshlet.indexCount;
+                continue;
+            }
+            if (runIndexCount > 0)
+            {
+                obj._model->drawRange(frameInfo.commandBuffer, runFirstIndex, runIndexCount);
+                _cullingStatistics.drawCalls++;
+                runIndexCount = 0;
+            }
+            if (visible)
+            {
+                runFirstIndex = meshlet.firstIndex;
+                runIndexCount = meshlet.indexCount;
+            }
+        }
+        if (runIndexCount > 0)
+        {
+            obj._model->drawRange(frameInfo.commandBuffer, runFirstIndex, runIndexCount);
+            _cullingStatistics.drawCalls++;
+        }
+    }
+    
+    void SimpleRenderSystem::setMeshletCulling(bool enabled)
+    {
+        _meshletCulling = enabled;
+    }
+    
+    const SimpleRenderSystem::CullingStatistics& SimpleRenderSystem::getCullingStatistics() const
+    {
+        return _cullingStatistics;
+    }
+    
+    void SimpleRenderSystem::setObjectDataPath(ObjectDataPath path)
+    {
+        assert((path != ObjectDataPath::Bindless || _bindlessDescriptors != nullptr) &&
+            "The Bindless path needs bindless descriptors");
+        assert((path != ObjectDataPath::PushDescriptors || _pushObjectTemplate != nullptr) &&
+            "The PushDescriptors path needs push descriptor support");
+        _objectDataPath = path;
+    }
+    
+    SimpleRenderSystem::ObjectDataPath SimpleRenderSystem::getObjectDataPath() const
+    {
+        return _objectDataPath;
+    }
+    
+    void SimpleRenderSystem::setLodBias(float bias)
+    {
+        _lodBias = bias;
+    }
+    
+    const SimpleRenderSystem::LodStatistics& SimpleRenderSystem::getLodStatistics() const
+    {
+        return _lodStatistics;
+    }
+    
+    // A model space error e seen from distance d covers e * scale * proj[1][1] / d of the half screen
+    // height. The distance is measured to the bounding sphere, so a camera inside it gets the finest level.
+    uint32_t SimpleRenderSystem::selectLod(const LveCamera& camera, LveGameObject& obj) const
+    {
+        const LveModel& model = *obj._model;
+        if (model.getLodCount() <= 1)
+        {
+            return 0;
+        }
+        
+        const glm::mat4& projection = camera.getProjection();
+        const glm::vec4& sphere = model.getBoundingSphere();
+        const glm::vec3& scale = obj._transformComp._scale;
+        float maxScale = std::max(std::abs(scale.x), std::max(std::abs(scale.y), std::abs(scale.z)));
+        
+        float unitsToScreen = maxScale * std::abs(projection[1][1]);
+        
+        // Only perspective projections write w from view space z.
+        if (projection[2][3] != 0.f)
+        {
+            glm::vec3 center = glm::vec3{obj._transformComp.mat4() * glm::vec4{glm::vec3{sphere}, 1.f}};
+            float distance = glm::length(center - camera.getPosition()) - sphere.w * maxScale;
+            unitsToScreen /= std::max(distance, 1e-3f);
+        }
+        
+        float allowedError = LOD_ERROR_THRESHOLD * std::exp2(_lodBias);
+        uint32_t lod = 0;
+        for (uint32_t level = 1; level < model.getLodCount(); level++)
+        {
+            if (model.getLod(level).error * unitsToScreen > allowedError)
+            {
+                break;
+            }
+            lod = level;
         }
+        return lod;
     }
 
 }
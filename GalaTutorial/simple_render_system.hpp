@@ -1,24 +1,95 @@
 #ifndef simple_render_system_hpp
 #define simple_render_system_hpp
 
+#include "lve_bindless_descriptors.hpp"
+#include "lve_buffer.hpp"
 #include "lve_camera.hpp"
+#include "lve_descriptors.hpp"
 #include "lve_device.hpp"
 #include "lve_game_object.hpp"
+#include "lve_meshlets.hpp"
 #include "lve_pipeline.hpp"
 #include "lve_frame_info.hpp"
+#include "lve_swap_chain.hpp"
+#include <array>
 #include <memory>
 #include <vector>
 //
 namespace lve
 {
+    // Per-object data of simple_shader.vert, sent as push constants (at most 128 bytes).
+    struct SimplePushConstantData
+    {
+        glm::mat4 modelMatrix{1.f};
+        glm::mat4 normalMatrix{1.f};
+    };
+    
+    // Per-object data of simple_shader_object_ubo.vert, in std140 layout. Not limited by the push
+    // constant size, so it also carries a material color.
+    struct SimpleObjectUbo
+    {
+        glm::mat4 modelMatrix{1.f};
+        glm::mat4 normalMatrix{1.f};
+        
+        // rgb replaces the vertex color by a weight of a.
+        glm::vec4 color{0.f};
+    };
+    
+    // Per-object data of simple_shader_bindless.vert, one element of a std430 storage buffer array.
+    struct SimpleObjectData
+    {
+        glm::mat4 modelMatrix{1.f};
+        glm::mat4 normalMatrix{1.f};
+        
+        // rgb replaces the vertex color by a weight of a.
+        glm::vec4 color{0.f};
+        
+        // Index into the bindless texture array, or LveBindlessDescriptors::INVALID_INDEX.
+        uint32_t  textureIndex = LveBindlessDescriptors::INVALID_INDEX;
+        uint32_t  padding[3]{};
+    };
+    
+    // Selects the object's SimpleObjectData in the bindless storage buffer array.
+    struct SimpleBindlessPushConstantData
+    {
+        uint32_t objectBufferIndex = 0;
+        uint32_t objectIndex = 0;
+    };
+    
     class SimpleRenderSystem
     {
         public:
         
+        // How per-object data reaches the shaders.
+        enum class ObjectDataPath
+        {
+            // SimplePushConstantData pushed before each draw.
+            PushConstants,
+            
+            // SimpleObjectUbo written to a slot of this frame's object buffer; set 1 is bound once per
+            // object with the slot's dynamic offset.
+            DynamicUniform,
+            
+            // SimpleObjectData written to this frame's object buffer, which is an element of the
+            // bindless storage buffer array; sets 0 and 1 are bound once for the whole scene and the
+            // object's indices are pushed before each draw. Needs LveBindlessDescriptors.
+            Bindless,
+            
+            // SimpleObjectUbo written as for DynamicUniform, but set 1 is pushed before each draw
+            // through an update template, so no set is allocated or bound. Needs
+            // LveDevice::supportsPushDescriptors().
+            PushDescriptors
+        };
+        
+        // Objects the first object buffer of each frame holds; it doubles when more are drawn.
+        static constexpr uint32_t MIN_OBJECT_CAPACITY = 256;
+        
+        // Without bindlessDescriptors, the Bindless path is not available.
         SimpleRenderSystem(
             LveDevice &device,
             VkRenderPass renderPass,
-            VkDescriptorSetLayout globalSetLayout);
+            VkDescriptorSetLayout globalSetLayout,
+            LveBindlessDescriptors *bindlessDescriptors = nullptr);
         
         ~SimpleRenderSystem();
         
@@ -28,18 +99,112 @@ namespace lve
         SimpleRenderSystem& operator=(
             const SimpleRenderSystem& o) = delete;
         
+        // Objects and triangles drawn at each level of detail during the last renderGameObjects().
+        struct LodStatistics
+        {
+            std::array<uint32_t, LveModel::MAX_LOD_COUNT> objects{};
+            std::array<uint64_t, LveModel::MAX_LOD_COUNT> triangles{};
+        };
+        
+        // Triangles of the selected levels of detail during the last renderGameObjects(), and how
+        // many of them were culled by whole object or meshlet frustum tests and by meshlet cone tests.
+        struct CullingStatistics
+        {
+            uint64_t triangles = 0;
+            uint64_t frustumCulledTriangles = 0;
+            uint64_t backFacingTriangles = 0;
+            uint32_t drawCalls = 0;
+        };
+        
         void renderGameObjects(
             FrameInfo& frameInfo,
             std::vector<LveGameObject>& gameObjects);
         
+        // Each step of bias doubles the screen space error allowed when choosing a level of detail;
+        // negative values prefer finer levels.
+        void setLodBias(float bias);
+        
+        const LodStatistics& getLodStatistics() const;
+        
+        // Meshlet culling applies to models built with meshlets; on by default.
+        void setMeshletCulling(bool enabled);
+        
+        const CullingStatistics& getCullingStatistics() const;
+        
+        // PushConstants by default. Bindless needs the render system to have bindless descriptors,
+        // PushDescriptors a device that supports them.
+        void setObjectDataPath(ObjectDataPath path);
+        
+        ObjectDataPath getObjectDataPath() const;
+        
         private:
         
         void createPipelineLayout(VkDescriptorSetLayout globalSetLayout);
         void createPipeline(VkRenderPass renderPass);
+        
+        // Layout of set 1; the set itself comes from FrameInfo::descriptorCache. With push
+        // descriptors, also the push descriptor layout of set 1 and its update template.
+        void createObjectDescriptors();
+        
+        // Makes the object buffer of frameIndex hold at least objectCount slots, replacing it when
+        // it is too small. The frame's previous submission must have completed.
+        void reserveObjectSlots(int frameIndex, uint32_t objectCount);
+        
+        // The same for the storage buffer of the Bindless path, whose bindless index stays the same
+        // when it is replaced.
+        void reserveObjectData(int frameIndex, uint32_t objectCount);
+        
+        // Coarsest level of detail whose error projects to at most the allowed screen space error.
+        uint32_t selectLod(const LveCamera& camera, LveGameObject& obj) const;
+        
+        // Draws the meshlets of level lod that pass the frustum and cone tests, merging neighbouring
+        // visible meshlets into one draw.
+        void drawMeshlets(
+            FrameInfo& frameInfo,
+            LveGameObject& obj,
+            uint32_t lod,
+            const glm::mat4& modelMatrix,
+            const LveMeshlets::Frustum& frustum);
     
         LveDevice&                   _lveDevice;
         VkPipelineLayout             _vkPipelineLayout;
-        std::unique_ptr<LvePipeline> _lvePipeline;
+        
+        // One pipeline per LveModel::VertexLayout, indexed by the layout.
+        std::array<std::unique_ptr<LvePipeline>, LveModel::VERTEX_LAYOUT_COUNT> _lvePipelines;
+        
+        // The DynamicUniform path: its pipeline layout has the global set and the object set, and no
+        // push constants.
+        ObjectDataPath               _objectDataPath = ObjectDataPath::PushConstants;
+        VkPipelineLayout             _objectPipelineLayout;
+        std::array<std::unique_ptr<LvePipeline>, LveModel::VERTEX_LAYOUT_COUNT> _objectPipelines;
+        
+        std::unique_ptr<LveDescriptorSetLayout> _objectSetLayout;
+        
+        // The PushDescriptors path: like the DynamicUniform path, with a push descriptor set 1 whose
+        // one binding is written from a VkDescriptorBufferInfo.
+        VkPipelineLayout             _pushObjectPipelineLayout = VK_NULL_HANDLE;
+        std::array<std::unique_ptr<LvePipeline>, LveModel::VERTEX_LAYOUT_COUNT> _pushObjectPipelines;
+        std::unique_ptr<LveDescriptorSetLayout> _pushObjectSetLayout;
+        std::unique_ptr<LveDescriptorUpdateTemplate> _pushObjectTemplate;
+        
+        // Per frame in flight: mapped SimpleObjectUbo slots spaced minUniformBufferOffsetAlignment
+        // apart.
+        std::array<std::unique_ptr<LveBuffer>, LveSwapChain::MAX_FRAMES_IN_FLIGHT> _objectBuffers;
+        
+        // The Bindless path: its pipeline layout has the global set and the bindless set, and
+        // SimpleBindlessPushConstantData. Per frame in flight, a mapped SimpleObjectData array and its
+        // index in the bindless storage buffer array.
+        LveBindlessDescriptors*      _bindlessDescriptors;
+        VkPipelineLayout             _bindlessPipelineLayout = VK_NULL_HANDLE;
+        std::array<std::unique_ptr<LvePipeline>, LveModel::VERTEX_LAYOUT_COUNT> _bindlessPipelines;
+        std::array<std::unique_ptr<LveBuffer>, LveSwapChain::MAX_FRAMES_IN_FLIGHT> _objectDataBuffers;
+        std::array<uint32_t, LveSwapChain::MAX_FRAMES_IN_FLIGHT> _objectDataIndices;
+        
+        float                        _lodBias = 0.f;
+        LodStatistics                _lodStatistics{};
+        
+        bool                         _meshletCulling = true;
+        CullingStatistics            _cullingStatistics{};
         
     };
 }